@@ -0,0 +1,312 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <cpprest/http_client.h>
+
+#include "http_retry.h"
+#include "job_journal.h"
+
+// Limits the request rate to Rate requests per second with bursts of up to Burst requests. When the service
+// throttles, the rate is halved and no request is sent until its Retry-After passed; every successful request
+// then raises the rate again, by one request per second per second, up to the configured rate.
+class TokenBucket
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    TokenBucket(double rate, double burst) :
+        m_maxRate(rate),
+        m_rate(rate),
+        m_burst(std::max(1.0, burst)),
+        m_tokens(std::max(1.0, burst)),
+        m_lastRefill(Clock::now()),
+        m_pausedUntil(Clock::now())
+    {
+    }
+
+    // Blocks until a request may be sent.
+    void Acquire()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (true)
+        {
+            auto now = Clock::now();
+            if (now < m_pausedUntil)
+            {
+                m_changed.wait_until(lock, m_pausedUntil);
+                continue;
+            }
+            Refill(now);
+            if (m_tokens >= 1)
+            {
+                m_tokens -= 1;
+                return;
+            }
+            auto wait = std::chrono::duration<double>((1 - m_tokens) / m_rate);
+            m_changed.wait_for(lock, wait);
+        }
+    }
+
+    // Called for a throttled request.
+    void Backoff(std::chrono::milliseconds retryAfter)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto now = Clock::now();
+        Refill(now);
+        m_rate = std::max(m_minRate, m_rate / 2);
+        m_tokens = 0;
+        m_pausedUntil = std::max(m_pausedUntil, now + std::max(retryAfter, std::chrono::milliseconds(1000)));
+        m_changed.notify_all();
+    }
+
+    // Called for a request that was not throttled.
+    void Success()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        Refill(Clock::now());
+        m_rate = std::min(m_maxRate, m_rate + 1 / m_rate);
+    }
+
+    double Rate() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_rate;
+    }
+
+private:
+    void Refill(Clock::time_point now)
+    {
+        auto elapsed = std::chrono::duration<double>(now - std::max(m_lastRefill, m_pausedUntil)).count();
+        if (elapsed > 0)
+        {
+            m_tokens = std::min(m_burst, m_tokens + elapsed * m_rate);
+        }
+        m_lastRefill = now;
+    }
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_changed;
+    const double m_maxRate;
+    const double m_minRate = 0.1;
+    double m_rate;
+    double m_burst;
+    double m_tokens;
+    Clock::time_point m_lastRefill;
+    Clock::time_point m_pausedUntil;
+};
+
+// Settings of the BulkSubmitter.
+struct BulkSubmitterOptions
+{
+    size_t Concurrency = 16;            // requests in flight at most.
+    double RequestsPerSecond = 10;
+    double Burst = 20;
+    JobJournal* Journal = nullptr;      // records the transcription of every submitted recording, if set.
+};
+
+// Submits a transcription for every recording of a manifest, concurrently and within a request rate limit.
+//
+// All requests go through one http_client, so they reuse its keep-alive connections to the service instead of
+// opening a connection per request. The location of every created transcription is written to the journal as
+// soon as it is known, so a restarted submission skips the recordings submitted before and never pays twice.
+//
+// Creating a transcription is not idempotent, so only responses 429 and 503, with which the service refuses the
+// request, are retried. After a connection failure or another server error the transcription may have been created
+// anyway; such recordings are counted as Uncertain and left out of the journal rather than submitted again, so
+// check the transcriptions of the service for them before submitting them once more.
+class BulkSubmitter
+{
+public:
+    using Options = BulkSubmitterOptions;
+
+    // Creates the request body of the transcription of a recording.
+    using DefinitionFactory = std::function<std::string(const std::string& recordingUrl)>;
+
+    struct Statistics
+    {
+        size_t Submitted = 0;
+        size_t Skipped = 0;         // submitted before, according to the journal, or listed more than once.
+        size_t Failed = 0;          // rejected by the service, e.g. with 400 for an invalid definition.
+        size_t Uncertain = 0;       // no answer or a server error, the transcription may or may not exist.
+        size_t Throttled = 0;       // responses 429 or 503, which were retried.
+        double Seconds = 0;
+    };
+
+    BulkSubmitter(const utility::string_t& transcriptionsUrl, const utility::string_t& subscriptionKey, const Options& options = Options()) :
+        m_client(web::uri(transcriptionsUrl)),
+        m_subscriptionKey(subscriptionKey),
+        m_options(options),
+        m_bucket(options.RequestsPerSecond, options.Burst)
+    {
+    }
+
+    // Reads a manifest with one recording URL per line. Empty lines and lines starting with # are ignored.
+    static std::vector<std::string> ReadManifest(const std::string& fileName)
+    {
+        std::vector<std::string> recordings;
+        std::ifstream manifest(fileName);
+        std::string line;
+        while (std::getline(manifest, line))
+        {
+            line.erase(line.find_last_not_of(" \t\r") + 1);
+            if (!line.empty() && line[0] != '#')
+            {
+                recordings.push_back(line);
+            }
+        }
+        return recordings;
+    }
+
+    // Submits all recordings and returns once every one is submitted or failed. The transcription locations of
+    // this run are available from Jobs() afterwards.
+    Statistics Submit(const std::vector<std::string>& recordings, DefinitionFactory createDefinition)
+    {
+        auto start = std::chrono::steady_clock::now();
+
+        // A recording listed twice in the manifest is submitted once, like one submitted before.
+        std::deque<std::string> pending;
+        std::set<std::string> listed;
+        JournalJob submitted;
+        for (const auto& recording : recordings)
+        {
+            if (!listed.insert(recording).second || m_jobs.count(recording) > 0 ||
+                (m_options.Journal != nullptr && m_options.Journal->FindRecording(recording, &submitted)))
+            {
+                m_statistics.Skipped++;
+            }
+            else
+            {
+                pending.push_back(recording);
+            }
+        }
+
+        std::vector<std::thread> workers;
+        for (size_t i = 0; i < std::min(m_options.Concurrency, pending.size()); i++)
+        {
+            workers.emplace_back([this, &pending, &createDefinition]()
+            {
+                while (true)
+                {
+                    std::string recording;
+                    {
+                        std::lock_guard<std::mutex> lock(m_mutex);
+                        if (pending.empty())
+                        {
+                            return;
+                        }
+                        recording = std::move(pending.front());
+                        pending.pop_front();
+                    }
+                    SubmitRecording(recording, createDefinition(recording));
+                }
+            });
+        }
+        for (auto& worker : workers)
+        {
+            worker.join();
+        }
+
+        m_statistics.Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return m_statistics;
+    }
+
+    // Recording URL to transcription location.
+    const std::map<std::string, utility::string_t>& Jobs() const { return m_jobs; }
+
+    double CurrentRate() const { return m_bucket.Rate(); }
+
+private:
+    void SubmitRecording(const std::string& recording, const std::string& definition)
+    {
+        while (true)
+        {
+            m_bucket.Acquire();
+
+            web::http::http_request request(web::http::methods::POST);
+            request.headers().add(U("Content-Type"), U("application/json"));
+            request.headers().add(U("Ocp-Apim-Subscription-Key"), m_subscriptionKey);
+            request.set_body(definition);
+
+            web::http::status_code statusCode = 0;
+            auto retryAfter = std::chrono::milliseconds(0);
+            utility::string_t location;
+            try
+            {
+                auto response = m_client.request(request).get();
+                statusCode = response.status_code();
+                retryAfter = GetRetryAfter(response.headers());
+                if (response.headers().has(U("Location")))
+                {
+                    location = response.headers()[U("Location")];
+                }
+            }
+            catch (const std::exception&)
+            {
+                statusCode = 0;
+            }
+
+            if (statusCode == web::http::status_codes::Accepted || statusCode == web::http::status_codes::Created)
+            {
+                m_bucket.Success();
+                AddJob(recording, location);
+                return;
+            }
+            if (statusCode == web::http::status_codes::TooManyRequests || statusCode == web::http::status_codes::ServiceUnavailable)
+            {
+                m_bucket.Backoff(retryAfter);
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_statistics.Throttled++;
+                continue;
+            }
+
+            // Client errors other than throttling will not go away by retrying, and after any other failure the
+            // request may have been processed, so retrying could create the transcription twice.
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (statusCode >= 400 && statusCode < 500)
+            {
+                m_statistics.Failed++;
+            }
+            else
+            {
+                m_statistics.Uncertain++;
+            }
+            return;
+        }
+    }
+
+    void AddJob(const std::string& recording, const utility::string_t& location)
+    {
+        // Waits for the journal outside the lock, so the flushes of concurrent submissions are shared.
+        if (m_options.Journal != nullptr)
+        {
+            m_options.Journal->Submitted(recording, utility::conversions::to_utf8string(location));
+        }
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_jobs[recording] = location;
+        m_statistics.Submitted++;
+    }
+
+    web::http::client::http_client m_client;
+    utility::string_t m_subscriptionKey;
+    Options m_options;
+    TokenBucket m_bucket;
+    std::mutex m_mutex;
+    std::map<std::string, utility::string_t> m_jobs;
+    Statistics m_statistics;
+};
@@ -0,0 +1,85 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#pragma once
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <Windows.h>
+
+// Helpers of the files that have to survive a crash of the client or the machine, the JobJournal and the
+// TranscriptIndexStore.
+
+// CRC-32 (IEEE) of data, to detect records that a crash tore.
+inline uint32_t Crc32(const char* data, size_t size)
+{
+    static const auto table = []()
+    {
+        std::vector<uint32_t> entries(256);
+        for (uint32_t i = 0; i < 256; i++)
+        {
+            uint32_t crc = i;
+            for (int bit = 0; bit < 8; bit++)
+            {
+                crc = (crc >> 1) ^ (crc & 1 ? 0xedb88320 : 0);
+            }
+            entries[i] = crc;
+        }
+        return entries;
+    }();
+
+    uint32_t crc = 0xffffffff;
+    for (size_t i = 0; i < size; i++)
+    {
+        crc = table[(crc ^ static_cast<unsigned char>(data[i])) & 0xff] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+inline uint32_t Crc32(const std::string& data)
+{
+    return Crc32(data.data(), data.size());
+}
+
+// Writes all of data at the current position of file.
+inline bool WriteAll(HANDLE file, const std::string& data)
+{
+    size_t offset = 0;
+    while (offset < data.size())
+    {
+        DWORD written = 0;
+        if (!WriteFile(file, data.data() + offset, static_cast<DWORD>(data.size() - offset), &written, nullptr))
+        {
+            return false;
+        }
+        offset += written;
+    }
+    return true;
+}
+
+// Replaces the file with data, so that after a crash it holds either its old or its new content: the data is written
+// to a temporary file and flushed to the disk before it is renamed over the file. Throws if it cannot be written.
+inline void ReplaceFileDurably(const std::string& fileName, const std::string& data)
+{
+    auto temporaryName = fileName + ".writing";
+    auto file = CreateFileA(temporaryName.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        throw std::runtime_error("Cannot create " + temporaryName);
+    }
+    bool written = WriteAll(file, data) && FlushFileBuffers(file);
+    CloseHandle(file);
+    if (!written)
+    {
+        DeleteFileA(temporaryName.c_str());
+        throw std::runtime_error("Cannot write " + temporaryName);
+    }
+    if (!MoveFileExA(temporaryName.c_str(), fileName.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+    {
+        throw std::runtime_error("Cannot replace " + fileName + ", error " + std::to_string(GetLastError()));
+    }
+}
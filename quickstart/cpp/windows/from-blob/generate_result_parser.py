@@ -0,0 +1,249 @@
+#!/usr/bin/env python
+#
+# Copyright (c) Microsoft. All rights reserved.
+# Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+#
+"""Generates transcription_result_v3.h, the classes and parser of the batch transcription result (v3 API), from
+samples/batch/transcriptionresult_v3.schema.json.
+
+Run it again after changing the schema or SKIPPED_MEMBERS:
+    python generate_result_parser.py [schema] [output]
+"""
+
+import json
+import os
+import re
+import sys
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+DEFAULT_SCHEMA = os.path.join(HERE, "..", "..", "..", "..", "samples", "batch", "transcriptionresult_v3.schema.json")
+DEFAULT_OUTPUT = os.path.join(HERE, "transcription_result_v3.h")
+
+# Members the client does not use, by their path of property names. They are left out of the classes and the parser
+# skips their values without materializing them. The ISO 8601 offsets and durations duplicate the *InTicks integers.
+SKIPPED_MEMBERS = [
+    "timestamp",
+    "duration",
+    "recognizedPhrases/offset",
+    "recognizedPhrases/duration",
+    "recognizedPhrases/nBest/words/offset",
+    "recognizedPhrases/nBest/words/duration",
+]
+
+
+def pascal_case(title):
+    """'Duration in ticks' -> 'DurationInTicks', 'Masked ITN' -> 'MaskedITN'."""
+    return "".join(word[:1].upper() + word[1:] for word in re.split(r"[^A-Za-z0-9]+", title) if word)
+
+
+class Member(object):
+    def __init__(self, key, schema, required, class_name):
+        self.key = key
+        self.name = pascal_case(schema.get("title", key))
+        self.schema = schema
+        self.required = required
+        self.item_class = None
+        kind = schema["type"]
+        if kind == "string":
+            self.cpp_type, self.default, self.parse = "std::string", None, "m_cursor.ParseString(&{0})"
+        elif kind == "integer" and schema.get("format") == "int64":
+            if schema.get("minimum", -1) >= 0:
+                self.cpp_type, self.parse = "uint64_t", "m_cursor.ParseUnsigned(&{0})"
+            else:
+                self.cpp_type, self.parse = "int64_t", "m_cursor.ParseInteger(&{0})"
+            self.default = str(schema.get("default", 0))
+        elif kind == "integer":
+            self.cpp_type, self.parse = "int", "m_cursor.ParseInteger(&{0})"
+            self.default = str(schema.get("default", 0))
+        elif kind == "number":
+            self.cpp_type, self.parse = "double", "m_cursor.ParseDouble(&{0})"
+            self.default = repr(float(schema.get("default", 0)))
+        elif kind == "boolean":
+            self.cpp_type, self.parse = "bool", "m_cursor.ParseBoolean(&{0})"
+            self.default = "true" if schema.get("default") else "false"
+        elif kind == "array" and schema["items"]["type"] == "object":
+            self.item_class = item_class_name(self.name, schema["items"])
+            self.cpp_type, self.default, self.parse = "std::vector<%s>" % self.item_class, None, None
+        else:
+            raise ValueError("Unsupported type %s of member %s of %s" % (kind, key, class_name))
+
+
+def item_class_name(member_name, item_schema):
+    """Names the elements of an array after the singular of the array, unless it clashes with one of their members."""
+    name = member_name[:-1] if member_name.endswith("s") else member_name
+    member_names = [pascal_case(schema.get("title", key)) for key, schema in item_schema.get("properties", {}).items()]
+    if name == member_name or name in member_names:
+        name += "Entry"
+    return name
+
+
+class Class(object):
+    def __init__(self, name, schema, path, classes):
+        self.name = name
+        self.members = []
+        required = schema.get("required", [])
+        for key, member_schema in schema.get("properties", {}).items():
+            member_path = path + [key]
+            if "/".join(member_path) in SKIPPED_MEMBERS:
+                continue
+            member = Member(key, member_schema, key in required, name)
+            if member.item_class:
+                Class(member.item_class, member_schema["items"], member_path, classes)
+            self.members.append(member)
+        # Children first, so every class is declared before it is used.
+        classes.append(self)
+
+    def required_members(self):
+        return [member for member in self.members if member.required]
+
+
+def generate_class(cls, out):
+    out.append("class %s" % cls.name)
+    out.append("{")
+    out.append("public:")
+    for member in cls.members:
+        description = member.schema.get("description")
+        if description:
+            out.append("    // %s" % description.replace("\n", " "))
+        if member.default is not None:
+            out.append("    %s %s = %s;" % (member.cpp_type, member.name, member.default))
+        else:
+            out.append("    %s %s;" % (member.cpp_type, member.name))
+    out.append("};")
+    out.append("inline void from_json(const nlohmann::json& j, %s& value) {" % cls.name)
+    for member in cls.members:
+        if member.required:
+            out.append('    j.at("%s").get_to(value.%s);' % (member.key, member.name))
+        else:
+            out.append('    if (j.contains("%s")) j.at("%s").get_to(value.%s);' % (member.key, member.key, member.name))
+    out.append("}")
+    out.append("")
+
+
+def generate_parse_function(cls, out):
+    required = cls.required_members()
+    out.append("    bool Parse(%s* value)" % cls.name)
+    out.append("    {")
+    if required:
+        out.append("        uint32_t found = 0;")
+        out.append("        bool parsed = m_cursor.ParseObject([this, value, &found](std::string_view key)")
+    else:
+        out.append("        return m_cursor.ParseObject([this, value](std::string_view key)")
+    out.append("        {")
+    out.append("            switch (key.size())")
+    out.append("            {")
+    by_length = {}
+    for member in cls.members:
+        by_length.setdefault(len(member.key), []).append(member)
+    for length in sorted(by_length):
+        out.append("            case %d:" % length)
+        for member in by_length[length]:
+            target = "value->%s" % member.name
+            out.append('                if (key == "%s")' % member.key)
+            out.append("                {")
+            if member.required:
+                out.append("                    found |= 0x%x;" % (1 << required.index(member)))
+            if member.item_class:
+                out.append("                    return m_cursor.ParseArray([this, value]()")
+                out.append("                    {")
+                out.append("                        %s.emplace_back();" % target)
+                out.append("                        return Parse(&%s.back());" % target)
+                out.append("                    });")
+            else:
+                out.append("                    return %s;" % member.parse.format(target))
+            out.append("                }")
+        out.append("                break;")
+    out.append("            }")
+    out.append("            return m_cursor.SkipValue();")
+    out.append("        });")
+    if required:
+        names = ", ".join('"%s"' % member.key for member in required)
+        out.append("        return parsed && (found == 0x%x || MissingMember(\"%s\", found, { %s }));"
+                   % ((1 << len(required)) - 1, cls.name, names))
+    out.append("    }")
+    out.append("")
+
+
+def generate(schema, schema_name):
+    classes = []
+    root = Class(pascal_case(schema["title"]), schema, [], classes)
+    if max(len(cls.required_members()) for cls in classes) > 32:
+        raise ValueError("More than 32 required members in one class")
+
+    out = []
+    out.append("//")
+    out.append("// Copyright (c) Microsoft. All rights reserved.")
+    out.append("// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.")
+    out.append("//")
+    out.append("// Generated by generate_result_parser.py from %s, do not edit." % schema_name)
+    out.append("//")
+    out.append("#pragma once")
+    out.append("")
+    out.append("#include <cstdint>")
+    out.append("#include <initializer_list>")
+    out.append("#include <string>")
+    out.append("#include <string_view>")
+    out.append("#include <vector>")
+    out.append("")
+    out.append("#include <nlohmann/json.hpp>")
+    out.append("")
+    out.append('#include "json_cursor.h"')
+    out.append("")
+    out.append("// Result of a batch transcription (v3 API), one document per audio file. Members the client does not use are")
+    out.append("// left out:")
+    for path in SKIPPED_MEMBERS:
+        out.append("//     %s" % path)
+    out.append("")
+    for cls in classes:
+        generate_class(cls, out)
+
+    out.append("// Parses a %s in place with a JsonCursor. Every object is parsed by a function specialized for its" % root.name)
+    out.append("// class, which finds members by the length of the key before comparing it, reads the ticks straight from the")
+    out.append("// digits and skips the values of unknown and left out members without materializing them.")
+    out.append("class %sParser" % root.name)
+    out.append("{")
+    out.append("public:")
+    out.append("    // Parses the body, which is unescaped in place. Returns false if it is malformed, then Error() tells why.")
+    out.append("    bool Parse(std::string& body, %s* result)" % root.name)
+    out.append("    {")
+    out.append("        *result = %s();" % root.name)
+    out.append("        m_cursor = JsonCursor(&body[0], &body[0] + body.size());")
+    out.append("        return Parse(result) && m_cursor.ExpectEnd();")
+    out.append("    }")
+    out.append("")
+    out.append("    const std::string& Error() const { return m_cursor.Error(); }")
+    out.append("")
+    out.append("private:")
+    for cls in classes:
+        generate_parse_function(cls, out)
+    out.append("    bool MissingMember(const char* className, uint32_t found, std::initializer_list<const char*> required)")
+    out.append("    {")
+    out.append("        for (auto key : required)")
+    out.append("        {")
+    out.append("            if ((found & 1) == 0)")
+    out.append("            {")
+    out.append('                return m_cursor.Fail(std::string("Missing member ") + key + " of " + className + ".");')
+    out.append("            }")
+    out.append("            found >>= 1;")
+    out.append("        }")
+    out.append("        return true;")
+    out.append("    }")
+    out.append("")
+    out.append("    JsonCursor m_cursor;")
+    out.append("};")
+    return "\n".join(out) + "\n"
+
+
+def main():
+    schema_file = sys.argv[1] if len(sys.argv) > 1 else DEFAULT_SCHEMA
+    output_file = sys.argv[2] if len(sys.argv) > 2 else DEFAULT_OUTPUT
+    with open(schema_file) as f:
+        schema = json.load(f)
+    text = generate(schema, os.path.basename(schema_file))
+    with open(output_file, "w", newline="\n") as f:
+        f.write(text)
+    print("Generated %s" % output_file)
+
+
+if __name__ == "__main__":
+    main()
@@ -7,14 +7,39 @@
 #include <iostream>
 #include <strstream>
 #include <Windows.h>
+#include <Psapi.h>
 #include <locale>
 #include <codecvt>
 #include <string>
+#include <vector>
+#include <chrono>
+#include <atomic>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <algorithm>
+#include <memory>
+#include <random>
 
 #include <cpprest/http_client.h>
 #include <cpprest/filestream.h>
 #include <nlohmann/json.hpp>
 
+#include "bulk_submitter.h"
+#include "job_journal.h"
+#include "mock_transcription_service.h"
+#include "result_document.h"
+#include "result_fetcher.h"
+#include "streaming_result_parser.h"
+#include "synthetic_results.h"
+#include "transcription_poller.h"
+#include "transcription_result.h"
+#include "transcript_index.h"
+#include "transcript_index_store.h"
+#include "transcription_result_v3.h"
+#include "webhook_receiver.h"
+#include "worker_pool.h"
+
 using namespace std;
 using namespace utility;                    // Common utilities like string conversions
 using namespace web;                        // Common features like URIs.
@@ -29,6 +54,15 @@ const string name = "Simple transcription";
 const string description = "Simple transcription description";
 const string myLocale = "en-US";
 const string recordingsBlobUri = "YourFileUrl";
+const string journalFile = "transcriptions.journal";
+const string indexFile = "transcriptions.index";
+const string_t transcriptionsUrl = U("https://") + region + U(".cris.ai/api/speechtotext/v2.0/Transcriptions/");
+const string_t webhooksUrl = U("https://") + region + U(".api.cognitive.microsoft.com/speechtotext/v3.0/webhooks");
+
+// Set with --webhook to be notified of completed transcriptions instead of polling for them: the URL the embedded
+// listener listens on, and the public URL under which the service reaches it.
+string_t webhookListenUrl;
+string_t webhookCallbackUrl;
 
 class TranscriptionDefinition {
 private:
@@ -119,77 +153,229 @@ void from_json(const nlohmann::json& j, Transcription& t) {
     j.at("status").get_to(t.status);
     t.statusMessage = j.value("statusMessage", "");
 }
-class Result
+// Serializes the output of the threads that fetch results and of the poller, so their lines do not mix.
+mutex consoleMutex;
+
+// Fetches the results of all channels of a transcription and prints them as one conversation, and adds them to
+// the index under the recording and channel. Returns false if a channel could not be fetched.
+bool fetchResults(const map<string, string>& resultsUrls, const string& recording, TranscriptIndex& index)
 {
-public:
-    string Lexical;
-    string ITN;
-    string MaskedITN;
-    string Display;
-};
-void from_json(const nlohmann::json& j, Result& r) {
-    j.at("Lexical").get_to(r.Lexical);
-    j.at("ITN").get_to(r.ITN);
-    j.at("MaskedITN").get_to(r.MaskedITN);
-    j.at("Display").get_to(r.Display);
+    {
+        lock_guard<mutex> lock(consoleMutex);
+        cout << "Fetching the results of " << resultsUrls.size() << " channels of " << recording << endl;
+    }
+
+    // Downloads all channels at the same time, parsing them while they download, and prints their segments merged
+    // into one conversation ordered by offset as they arrive.
+    ResultFetcher fetcher(subscriptionKey);
+    bool fetched = fetcher.Fetch(resultsUrls, [&index, &recording](TimelineSegment& entry)
+    {
+        index.Add(recording + " " + entry.Channel, entry.Segment);
+        const auto& segResult = entry.Segment;
+        lock_guard<mutex> lock(consoleMutex);
+        cout << "[" << recording << " " << entry.Channel << " " << segResult.Offset / 10000000.0 << " s] Status: " << segResult.RecognitionStatus << endl;
+
+        if (!_stricmp(segResult.RecognitionStatus.c_str(), "success") && segResult.NBest.size() > 0)
+        {
+            cout << "Best text result was: '" << segResult.NBest.front().Display << "'" << endl;
+        }
+    });
+
+    lock_guard<mutex> lock(consoleMutex);
+    for (const auto& channel : fetcher.Channels())
+    {
+        cout << channel.Channel << ": " << channel.Segments << " results in " << channel.Seconds << " s";
+        if (!channel.Error.empty())
+        {
+            cout << ", failed: " << channel.Error;
+        }
+        cout << endl;
+    }
+    cout << "Fetched all channels of " << recording << " in " << fetcher.Seconds() << " s" << endl;
+    return fetched;
 }
 
-class NBest : public Result
+// A random secret to sign the webhook notifications with.
+string generateWebhookSecret()
 {
-public:
-    double Confidence;
-};
-void from_json(const nlohmann::json& j, NBest& nb) {
-    j.at("Confidence").get_to(nb.Confidence);
-    j.at("Lexical").get_to(nb.Lexical);
-    j.at("ITN").get_to(nb.ITN);
-    j.at("MaskedITN").get_to(nb.MaskedITN);
-    j.at("Display").get_to(nb.Display);
+    random_device random;
+    string secret;
+    for (int i = 0; i < 32; i++)
+    {
+        secret += "0123456789abcdef"[random() % 16];
+    }
+    return secret;
 }
 
-class SegmentResult
+// Polling intervals when webhooks notify the completions: polling only catches notifications that got lost.
+TranscriptionPoller::Options fallbackPollerOptions()
 {
-public:
-    string RecognitionStatus;
-    ULONG Offset;
-    ULONG Duration;
-    std::list<NBest> NBest;
-};
-void from_json(const nlohmann::json& j, SegmentResult& sr) {
-    j.at("RecognitionStatus").get_to(sr.RecognitionStatus);
-    j.at("Offset").get_to(sr.Offset);
-    j.at("Duration").get_to(sr.Duration);
-    sr.NBest = j.at("NBest").get<list<NBest>>();
+    TranscriptionPoller::Options options;
+    options.InitialInterval = chrono::seconds(30);
+    options.MinInterval = chrono::seconds(30);
+    options.MaxInterval = chrono::minutes(5);
+    return options;
 }
 
-class AudioFileResult
+// Completes every transcription of the journal that is not done: polls those still running and fetches the
+// results of those that succeeded, also when the client stopped before fetching them. With --webhook, the
+// transcriptions are polled as soon as the service notifies their completion, and otherwise rarely.
+void completeTranscriptions(JobJournal& journal)
 {
-public:
-    string AudioFileName;
-    std::list<SegmentResult> SegmentResults;
-    std::list<Result> CombinedResults;
-};
-void from_json(const nlohmann::json& j, AudioFileResult& arf) {
-    j.at("AudioFileName").get_to(arf.AudioFileName);
-    arf.SegmentResults = j.at("SegmentResults").get<list<SegmentResult>>();
-    arf.CombinedResults = j.at("CombinedResults").get<list<Result>>();
-}
+    TranscriptIndexStore index(indexFile);
+    if (index.GetStatistics().Lost)
+    {
+        cout << "The index " << indexFile << " could not be read, it is rebuilt from the results of all transcriptions." << endl;
+    }
 
-class RootObject {
-public:
-    std::list<AudioFileResult> AudioFileResults;
-};
-void from_json(const nlohmann::json& j, RootObject& r) {
-    r.AudioFileResults = j.at("AudioFileResults").get<list<AudioFileResult>>();
+    // Results are fetched on their own threads, so downloading them never holds up polling the other
+    // transcriptions. Each transcription is indexed on its own until all its channels arrived, so a failed fetch,
+    // which the next run repeats, leaves the index as it was. A job is only journaled as fetched once its results
+    // are flushed to the log of the index: a fetched job is never fetched again, so results indexed only in memory
+    // would be missing from the index for good after a crash.
+    mutex indexMutex;
+    WorkerPool fetchers(4);
+    auto fetch = [&journal, &index, &indexMutex, &fetchers](const string& location, const string& recording, const map<string, string>& resultsUrls)
+    {
+        fetchers.Post([&journal, &index, &indexMutex, location, recording, resultsUrls]()
+        {
+            try
+            {
+                TranscriptIndex fetchedIndex;
+                if (fetchResults(resultsUrls, recording, fetchedIndex))
+                {
+                    lock_guard<mutex> lock(indexMutex);
+                    index.Add(fetchedIndex);
+                    journal.Fetched(location);
+                }
+            }
+            catch (const exception& e)
+            {
+                lock_guard<mutex> lock(consoleMutex);
+                cout << "Fetching the results of " << location << " failed: " << e.what() << endl;
+            }
+        });
+    };
+
+    bool webhook = !webhookListenUrl.empty();
+    TranscriptionPoller poller(subscriptionKey, webhook ? fallbackPollerOptions() : TranscriptionPoller::Options());
+    auto pendingJobs = journal.PendingJobs(index.GetStatistics().Lost);
+
+    // The notifications link the v3 URL of a transcription, which is matched with its v2 location by id.
+    map<string, string_t> locationsById;
+    for (const auto& job : pendingJobs)
+    {
+        locationsById[TranscriptionIdFromUrl(job.Location)] = utility::conversions::to_string_t(job.Location);
+    }
+    unique_ptr<WebhookReceiver> receiver;
+    if (webhook)
+    {
+        receiver = make_unique<WebhookReceiver>(webhookListenUrl, generateWebhookSecret(), [&poller, &locationsById](const string& transcriptionUrl)
+        {
+            auto it = locationsById.find(TranscriptionIdFromUrl(transcriptionUrl));
+            if (it != locationsById.end())
+            {
+                poller.PollNow(it->second);
+            }
+        });
+        receiver->Register(webhooksUrl, webhookCallbackUrl, subscriptionKey);
+        cout << "Registered a webhook for " << utility::conversions::to_utf8string(webhookCallbackUrl) << endl;
+    }
+
+    for (const auto& job : pendingJobs)
+    {
+        if (job.Status == "Succeeded")
+        {
+            {
+                lock_guard<mutex> lock(consoleMutex);
+                cout << "Transcription " << job.Location << " has completed before." << endl;
+            }
+            fetch(job.Location, job.Recording, nlohmann::json::parse(job.ResultsUrls).get<map<string, string>>());
+            continue;
+        }
+
+        // Polls the status until the transcription completed, with intervals adapting to its progress.
+        poller.Add(utility::conversions::to_string_t(job.Location), [&journal, &fetch, recording = job.Recording](const string_t& location, const nlohmann::json& statusJSON)
+        {
+            lock_guard<mutex> lock(consoleMutex);
+            if (statusJSON.is_null())
+            {
+                cout << "Fetching the transcription status failed repeatedly, giving up." << endl;
+                return;
+            }
+
+            Transcription transcriptionStatus = statusJSON;
+            auto jobLocation = utility::conversions::to_utf8string(location);
+            journal.StatusReceived(jobLocation, transcriptionStatus.status,
+                statusJSON.contains("resultsUrls") ? statusJSON["resultsUrls"].dump() : "");
+
+            if (!_stricmp(transcriptionStatus.status.c_str(), "Failed"))
+            {
+                cout << "Transcription has failed " << transcriptionStatus.statusMessage << endl;
+            }
+            else if (!_stricmp(transcriptionStatus.status.c_str(), "Succeeded"))
+            {
+                cout << "Success!" << endl;
+                cout << "Transcription has completed." << endl;
+                fetch(jobLocation, recording, transcriptionStatus.resultsUrls);
+            }
+            else if (!_stricmp(transcriptionStatus.status.c_str(), "Running"))
+            {
+                cout << "Transcription is running." << endl;
+            }
+            else if (!_stricmp(transcriptionStatus.status.c_str(), "NotStarted"))
+            {
+                cout << "Transcription has not started." << endl;
+            }
+        });
+    }
+    poller.Run();
+    fetchers.Wait();
+
+    cout << "Polled the transcription status " << poller.PollCount() << " times." << endl;
+    if (receiver)
+    {
+        cout << "Received " << receiver->GetStatistics().Notifications << " webhook notifications." << endl;
+    }
+
+    auto statistics = index.Index().GetStatistics();
+    cout << "Indexed " << statistics.Segments << " segments of " << statistics.Files << " channels." << endl;
 }
 
+// Prints the recordings and times at which the phrase was said, from the index of the fetched results.
+void searchIndex(const string& phrase, const string& indexFileName)
+{
+    TranscriptIndex index;
+    if (!TranscriptIndexStore::Read(indexFileName, &index))
+    {
+        cout << "There is no readable index " << indexFileName << " yet, it is written when results are fetched." << endl;
+        return;
+    }
+    auto start = chrono::steady_clock::now();
+    auto hits = index.Search(phrase);
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+    for (const auto& hit : hits)
+    {
+        cout << hit.File << " at " << hit.Offset / 10000000.0 << " s" << endl;
+    }
+    cout << hits.size() << " segments found in " << elapsed.count() * 1000 << " ms" << endl;
+}
 
 void recognizeSpeech()
 {
     std::wstring_convert<std::codecvt_utf8_utf16<wchar_t >> converter;
 
-    utility::string_t service_url = U("https://") + region + U(".cris.ai/api/speechtotext/v2.0/Transcriptions/");
-    uri u(service_url);
+    // A transcription submitted by an interrupted run is resumed instead of submitted (and paid for) again.
+    JobJournal journal(journalFile);
+    JournalJob job;
+    if (journal.FindRecording(recordingsBlobUri, &job))
+    {
+        cout << "The recording was submitted before, resuming." << endl;
+        completeTranscriptions(journal);
+        return;
+    }
+
+    uri u(transcriptionsUrl);
 
     http_client c(u);
     http_request msg(methods::POST);
@@ -214,96 +400,565 @@ void recognizeSpeech()
     string_t transcriptionLocation = response.headers()[U("location")];
 
     cout << "Transcription status is located at " << converter.to_bytes(transcriptionLocation) << endl;
+    journal.Submitted(recordingsBlobUri, converter.to_bytes(transcriptionLocation));
+
+    completeTranscriptions(journal);
+}
+
+#ifdef COUNT_ALLOCATIONS
+// Counts heap allocations, for the result parser benchmark. Replacing the global operator new costs every allocation
+// of the program, so it is only built with COUNT_ALLOCATIONS defined, e.g. in the preprocessor definitions of a
+// separate benchmark configuration.
+static atomic<size_t> allocationCount(0);
+
+void* operator new(size_t size)
+{
+    allocationCount++;
+    if (void* memory = malloc(size > 0 ? size : 1))
+    {
+        return memory;
+    }
+    throw bad_alloc();
+}
+
+void operator delete(void* memory) noexcept
+{
+    free(memory);
+}
+#endif
+
+// Compares the result parsers on a synthetic result: the streaming parser, the in-place ResultDocument and
+// nlohmann::json with the RootObject model, by time and growth of the peak working set, and by heap allocations if
+// built with COUNT_ALLOCATIONS.
+void benchmarkResultParser(size_t segmentCount)
+{
+    auto result = GenerateSyntheticResult(segmentCount);
+    cout << "Parsing a result of " << segmentCount << " segments, " << result.size() / (1024 * 1024) << " MB." << endl;
 
-    http_client statusCheckClient(transcriptionLocation);
-    http_request statusCheckMessage(methods::GET);
-    statusCheckMessage.headers().add(U("Ocp-Apim-Subscription-Key"), subscriptionKey);
+    auto peakWorkingSet = []()
+    {
+        PROCESS_MEMORY_COUNTERS counters = {};
+        GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+        return static_cast<double>(counters.PeakWorkingSetSize) / (1024 * 1024);
+    };
 
-    bool completed = false;
+    // Runs the parsers with the smallest footprint first, as the peak working set never shrinks.
+    auto measure = [&peakWorkingSet](const char* name, function<size_t()> parse)
+    {
+        auto peakBefore = peakWorkingSet();
+#ifdef COUNT_ALLOCATIONS
+        auto allocationsBefore = allocationCount.load();
+#endif
+        auto start = chrono::steady_clock::now();
+        auto segments = parse();
+        chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+        cout << name << segments << " segments in " << elapsed.count() << " s, ";
+#ifdef COUNT_ALLOCATIONS
+        cout << allocationCount - allocationsBefore << " allocations, ";
+#endif
+        cout << "peak working set +" << peakWorkingSet() - peakBefore << " MB" << endl;
+    };
 
-    while (!completed)
+    measure("Streaming parser: ", [&result]()
     {
-        auto statusResponse = statusCheckClient.request(statusCheckMessage).get();
-        auto statusResponseCode = statusResponse.status_code();
+        size_t segments = 0;
+        StreamingResultParser parser([&segments](const string&, SegmentResult&) { segments++; });
+        const size_t chunkSize = 64 * 1024;
+        for (size_t offset = 0; offset < result.size(); offset += chunkSize)
+        {
+            parser.Feed(result.data() + offset, min(chunkSize, result.size() - offset));
+        }
+        parser.Finish();
+        return segments;
+    });
 
-        if (statusResponseCode != status_codes::OK)
+    // The document takes over its body, which is copied beforehand to keep the copy out of the measurement.
+    string body = result;
+    measure("Result document:  ", [&body]()
+    {
+        ResultDocument document;
+        document.Parse(move(body));
+        size_t segments = 0;
+        for (const auto& audioFile : document.AudioFileResults())
         {
-            cout << "Fetching the transcription returned unexpected http code " << statusResponseCode << endl;
-            return;
+            segments += audioFile.SegmentResults.size();
         }
+        return segments;
+    });
+
+    measure("JSON document:    ", [&result]()
+    {
+        RootObject root = nlohmann::json::parse(result);
+        return root.AudioFileResults.front().SegmentResults.size();
+    });
+
+    // The same phrases in the v3 format, with the parser generated from the schema against the JSON document.
+    auto resultV3 = GenerateSyntheticResultV3(segmentCount);
+    cout << "Parsing a v3 result of " << segmentCount << " phrases, " << resultV3.size() / (1024 * 1024) << " MB." << endl;
+
+    string bodyV3 = resultV3;
+    measure("Generated parser: ", [&bodyV3]()
+    {
+        TranscriptionResult transcription;
+        TranscriptionResultParser parser;
+        parser.Parse(bodyV3, &transcription);
+        return transcription.RecognizedPhrases.size();
+    });
+
+    measure("JSON document:    ", [&resultV3]()
+    {
+        TranscriptionResult transcription = nlohmann::json::parse(resultV3);
+        return transcription.RecognizedPhrases.size();
+    });
+}
+
+// Submits a transcription for every recording listed in the manifest and completes them. The journal records
+// the submitted transcriptions, so running it again after an interruption only submits the remaining recordings.
+void submitManifest(const string& manifestFile, const string& journalFileName)
+{
+    auto recordings = BulkSubmitter::ReadManifest(manifestFile);
+    cout << "Submitting " << recordings.size() << " recordings." << endl;
+
+    JobJournal journal(journalFileName);
+    BulkSubmitter::Options options;
+    options.Journal = &journal;
+    BulkSubmitter submitter(transcriptionsUrl, subscriptionKey, options);
+    auto statistics = submitter.Submit(recordings, [](const string& recordingUrl)
+    {
+        nlohmann::json definition = TranscriptionDefinition::Create(name, description, myLocale, recordingUrl);
+        return definition.dump();
+    });
+
+    cout << "Submitted " << statistics.Submitted << ", skipped " << statistics.Skipped << " submitted before or listed twice, "
+        << statistics.Failed << " failed, in " << statistics.Seconds << " s." << endl;
+    if (statistics.Uncertain > 0)
+    {
+        cout << statistics.Uncertain << " recordings got no answer or a server error and were not resubmitted, "
+            << "check the transcriptions of the service for them before submitting them again." << endl;
+    }
 
-        auto body = statusResponse.extract_string().get();
-        auto statusJSON = nlohmann::json::parse(body);
-        Transcription transcriptionStatus = statusJSON;
+    completeTranscriptions(journal);
+}
+
+// Measures the journal with concurrent jobs that each record a submission, two status updates and a fetch,
+// and how long it takes to open the journal again.
+void benchmarkJournal(size_t jobCount)
+{
+    const string fileName = "benchmark.journal";
+    DeleteFileA(fileName.c_str());
+    const size_t threadCount = 16;
 
-        if (!_stricmp(transcriptionStatus.status.c_str(), "Failed"))
+    JobJournal::Statistics statistics;
+    auto start = chrono::steady_clock::now();
+    {
+        JobJournal journal(fileName);
+        vector<thread> threads;
+        for (size_t t = 0; t < threadCount; t++)
         {
-            completed = true;
-            cout << "Transcription has failed " << transcriptionStatus.statusMessage << endl;
+            threads.emplace_back([&journal, t, jobCount, threadCount]()
+            {
+                for (size_t i = t; i < jobCount; i += threadCount)
+                {
+                    auto location = "https://localhost/api/speechtotext/v2.0/Transcriptions/" + to_string(i);
+                    journal.Submitted("https://localhost/recordings/" + to_string(i) + ".wav", location);
+                    journal.StatusReceived(location, "Running");
+                    journal.StatusReceived(location, "Succeeded", "{\"channel_0\":\"https://localhost/results/" + to_string(i) + ".json\"}");
+                    journal.Fetched(location);
+                }
+            });
         }
-        else if (!_stricmp(transcriptionStatus.status.c_str(), "Succeeded"))
+        for (auto& t : threads)
         {
-            completed = true;
-            cout << "Success!" << endl;
-            string result = transcriptionStatus.resultsUrls["channel_0"];
-            cout << "Transcription has completed. Results are at " << result << endl;
-            cout << "Fetching results" << endl;
+            t.join();
+        }
+        journal.Sync();
+        statistics = journal.GetStatistics();
+    }
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+
+    start = chrono::steady_clock::now();
+    size_t pending;
+    {
+        JobJournal journal(fileName);
+        pending = journal.PendingJobs().size();
+    }
+    chrono::duration<double> reopen = chrono::steady_clock::now() - start;
+
+    cout << jobCount << " jobs, " << statistics.Records << " records in " << elapsed.count() << " s: "
+        << statistics.Records / elapsed.count() << " records/s, " << statistics.Flushes << " flushes, "
+        << statistics.Compactions << " compactions, journal " << statistics.FileBytes / 1024 << " KB" << endl;
+    cout << "Reopened in " << reopen.count() << " s, " << pending << " jobs pending" << endl;
+    DeleteFileA(fileName.c_str());
+}
 
-            http_client result_client(converter.from_bytes(result));
-            http_request resultMessage(methods::GET);
-            resultMessage.headers().add(U("Ocp-Apim-Subscription-Key"), subscriptionKey);
+// Measures the submission rate against a local mock service, once without and once with a service rate limit.
+void benchmarkSubmission(size_t count)
+{
+    vector<string> recordings;
+    for (size_t i = 0; i < count; i++)
+    {
+        recordings.push_back("https://localhost/recordings/" + to_string(i) + ".wav");
+    }
+    auto definition = [](const string& recordingUrl)
+    {
+        nlohmann::json definition = TranscriptionDefinition::Create(name, description, myLocale, recordingUrl);
+        return definition.dump();
+    };
 
-            auto resultResponse = result_client.request(resultMessage).get();
+    for (double serviceLimit : { 0.0, 200.0 })
+    {
+        MockTranscriptionService::Options serviceOptions;
+        serviceOptions.RequestsPerSecond = serviceLimit;
+        MockTranscriptionService service(U("http://localhost:5000/"), serviceOptions);
+
+        BulkSubmitter::Options options;
+        options.Concurrency = 32;
+        options.RequestsPerSecond = serviceLimit > 0 ? serviceLimit * 2 : 1e6;
+        options.Burst = options.Concurrency;
+        BulkSubmitter submitter(service.TranscriptionsUrl(), subscriptionKey, options);
+        auto statistics = submitter.Submit(recordings, definition);
+
+        cout << (serviceLimit > 0 ? "Service limit " + to_string(static_cast<int>(serviceLimit)) + "/s: " : string("No service limit: "))
+            << statistics.Submitted << " submitted in " << statistics.Seconds << " s, "
+            << statistics.Submitted / statistics.Seconds << " submissions/s, " << statistics.Throttled << " throttled, "
+            << statistics.Failed << " failed, " << statistics.Uncertain << " uncertain, final rate limit " << submitter.CurrentRate() << "/s" << endl;
+    }
+}
 
-            auto responseCode = resultResponse.status_code();
+// Load tests the whole flow against the local mock service: submits the transcriptions, polls them until they
+// complete and fetches and parses the results of every channel, with injected errors and failures.
+void benchmarkService(size_t jobCount)
+{
+    MockTranscriptionService::Options serviceOptions;
+    serviceOptions.QueueDelay = chrono::seconds(2);
+    serviceOptions.ProcessingDelay = chrono::seconds(10);
+    serviceOptions.ErrorRate = 0.02;
+    serviceOptions.FailureRate = 0.02;
+    serviceOptions.Channels = 2;
+    serviceOptions.PhrasesPerChannel = 2000;
+    MockTranscriptionService service(U("http://localhost:5000/"), serviceOptions);
+
+    vector<string> recordings;
+    for (size_t i = 0; i < jobCount; i++)
+    {
+        recordings.push_back("https://localhost/recordings/" + to_string(i) + ".wav");
+    }
 
-            if (responseCode != status_codes::OK)
+    auto start = chrono::steady_clock::now();
+    BulkSubmitter submitter(service.TranscriptionsUrl(), subscriptionKey);
+    auto submission = submitter.Submit(recordings, [](const string& recordingUrl)
+    {
+        nlohmann::json definition = TranscriptionDefinition::Create(name, description, myLocale, recordingUrl);
+        return definition.dump();
+    });
+
+    size_t succeeded = 0, failed = 0, gaveUp = 0;
+    atomic<size_t> fetchFailed{ 0 }, segments{ 0 };
+    mutex fetchSecondsMutex;
+    double fetchSeconds = 0;
+    WorkerPool fetchers(8);
+    TranscriptionPoller poller(subscriptionKey);
+    for (const auto& job : submitter.Jobs())
+    {
+        poller.Add(job.second, [&](const string_t&, const nlohmann::json& status)
+        {
+            if (status.is_null())
             {
-                cout << "Fetching the transcription returned unexpected http code " << responseCode << endl;
+                gaveUp++;
                 return;
             }
+            auto state = status.value("status", "");
+            if (state == "Failed")
+            {
+                failed++;
+            }
+            else if (state == "Succeeded")
+            {
+                succeeded++;
+                fetchers.Post([&, resultsUrls = status["resultsUrls"].get<map<string, string>>()]()
+                {
+                    ResultFetcher fetcher(subscriptionKey);
+                    if (!fetcher.Fetch(resultsUrls, [&segments](TimelineSegment&) { segments++; }))
+                    {
+                        fetchFailed++;
+                    }
+                    lock_guard<mutex> lock(fetchSecondsMutex);
+                    fetchSeconds += fetcher.Seconds();
+                });
+            }
+        });
+    }
+    poller.Run();
+    fetchers.Wait();
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+
+    auto serviceStatistics = service.GetStatistics();
+    cout << "Submitted " << submission.Submitted << " of " << jobCount << " in " << submission.Seconds << " s, "
+        << submission.Throttled << " throttled, " << submission.Failed << " failed, " << submission.Uncertain << " uncertain" << endl;
+    cout << succeeded << " succeeded, " << failed << " failed, " << gaveUp << " given up, in " << elapsed.count() << " s" << endl;
+    cout << poller.PollCount() << " status polls, " << static_cast<double>(poller.PollCount()) / max<size_t>(jobCount, 1) << " per transcription" << endl;
+    cout << "Fetched " << segments << " segments, " << serviceStatistics.ResultBytes / (1024 * 1024) << " MB, in "
+        << fetchSeconds << " s, " << fetchFailed << " fetches failed" << endl;
+    cout << "The service injected " << serviceStatistics.InjectedErrors << " errors" << endl;
+}
 
-            auto resultBody = resultResponse.extract_string().get();
-
-            nlohmann::json resultJSON = nlohmann::json::parse(resultBody);
-            RootObject root = resultJSON;
+// Measures how long after a transcription completed its results start to be fetched, once polling with adaptive
+// intervals, and once notified by webhooks with polling every 30 s as a fallback, of which a few are lost.
+void benchmarkWebhook(size_t jobCount)
+{
+    for (bool webhook : { false, true })
+    {
+        MockTranscriptionService::Options serviceOptions;
+        serviceOptions.QueueDelay = chrono::seconds(2);
+        serviceOptions.ProcessingDelay = chrono::seconds(10);
+        serviceOptions.PhrasesPerChannel = 100;
+        serviceOptions.WebhookLossRate = 0.02;
+        MockTranscriptionService service(U("http://localhost:5000/"), serviceOptions);
+
+        vector<string> recordings;
+        for (size_t i = 0; i < jobCount; i++)
+        {
+            recordings.push_back("https://localhost/recordings/" + to_string(i) + ".wav");
+        }
+        BulkSubmitter submitter(service.TranscriptionsUrl(), subscriptionKey);
+        submitter.Submit(recordings, [](const string& recordingUrl)
+        {
+            nlohmann::json definition = TranscriptionDefinition::Create(name, description, myLocale, recordingUrl);
+            return definition.dump();
+        });
 
-            for (AudioFileResult af : root.AudioFileResults)
+        TranscriptionPoller poller(subscriptionKey, webhook ? fallbackPollerOptions() : TranscriptionPoller::Options());
+        map<string, string_t> locationsById;
+        for (const auto& job : submitter.Jobs())
+        {
+            locationsById[TranscriptionIdFromUrl(utility::conversions::to_utf8string(job.second))] = job.second;
+        }
+        unique_ptr<WebhookReceiver> receiver;
+        if (webhook)
+        {
+            const string_t callbackUrl = U("http://localhost:5001/webhook/");
+            receiver = make_unique<WebhookReceiver>(callbackUrl, generateWebhookSecret(), [&poller, &locationsById](const string& transcriptionUrl)
             {
-                cout << "There were " << af.SegmentResults.size() << " results in " << af.AudioFileName << endl;
-
-                for (SegmentResult segResult : af.SegmentResults)
+                auto it = locationsById.find(TranscriptionIdFromUrl(transcriptionUrl));
+                if (it != locationsById.end())
                 {
-                    cout << "Status: " << segResult.RecognitionStatus << endl;
+                    poller.PollNow(it->second);
+                }
+            });
+            receiver->Register(service.WebhooksUrl(), callbackUrl, subscriptionKey);
+        }
 
-                    if (!_stricmp(segResult.RecognitionStatus.c_str(), "success") && segResult.NBest.size() > 0)
+        // Fetched on other threads, so that fetching does not delay noticing the next completions.
+        vector<double> latencies;
+        atomic<size_t> fetchFailed{ 0 };
+        WorkerPool fetchers(8);
+        for (const auto& job : locationsById)
+        {
+            poller.Add(job.second, [&](const string_t& location, const nlohmann::json& status)
+            {
+                if (status.is_null() || status.value("status", "") != "Succeeded")
+                {
+                    return;
+                }
+                latencies.push_back(chrono::duration<double>(chrono::steady_clock::now() - service.CompletionTime(location)).count());
+                fetchers.Post([&, resultsUrls = status["resultsUrls"].get<map<string, string>>()]()
+                {
+                    ResultFetcher fetcher(subscriptionKey);
+                    if (!fetcher.Fetch(resultsUrls, [](TimelineSegment&) {}))
                     {
-                        cout << "Best text result was: '" << segResult.NBest.front().Display << "'" << endl;
+                        fetchFailed++;
                     }
-                }
-            }
+                });
+            });
         }
-        else if (!_stricmp(transcriptionStatus.status.c_str(), "Running"))
+        poller.Run();
+        fetchers.Wait();
+
+        sort(latencies.begin(), latencies.end());
+        auto percentile = [&latencies](double p) { return latencies.empty() ? 0 : latencies[static_cast<size_t>(p * (latencies.size() - 1))]; };
+        double mean = 0;
+        for (auto latency : latencies)
+        {
+            mean += latency / latencies.size();
+        }
+        cout << (webhook ? "Webhooks: " : "Polling:  ") << latencies.size() << " fetched, completion to fetch mean " << mean
+            << " s, median " << percentile(0.5) << " s, 95th percentile " << percentile(0.95) << " s, max " << percentile(1)
+            << " s; " << poller.PollCount() << " status polls";
+        if (receiver)
         {
-            cout << "Transcription is running." << endl;
+            cout << ", " << receiver->GetStatistics().Notifications << " notifications, " << service.GetStatistics().LostNotifications << " lost";
         }
-        else if (!_stricmp(transcriptionStatus.status.c_str(), "NotStarted"))
+        cout << ", " << fetchFailed << " fetches failed" << endl;
+    }
+}
+
+// Measures building the index from a large corpus of synthetic conversations, and the latency of term queries of
+// common to rare words and of phrase queries taken from the corpus. The two channels of every conversation are added
+// alternately, like fetchResults adds the merged timeline, and every sampled phrase must be found in its channel.
+void benchmarkIndex(size_t segmentCount)
+{
+    const size_t segmentsPerFile = 500;
+    SyntheticCorpus corpus(100000);
+    TranscriptIndex index;
+    vector<string> phrases;
+    vector<pair<string, uint64_t>> phraseSources;
+    size_t textBytes = 0;
+    chrono::duration<double> buildTime(0);
+    mt19937 random(1);
+    for (size_t file = 0; file * segmentsPerFile < segmentCount; file++)
+    {
+        auto recording = "https://localhost/recordings/" + to_string(file) + ".wav";
+        size_t channel = 0;
+        for (const auto& phrase : corpus.GeneratePhrases(min(segmentsPerFile, segmentCount - file * segmentsPerFile)))
         {
-            cout << "Transcription has not started." << endl;
+            auto fileName = recording + " channel_" + to_string(channel++ % 2);
+            SegmentResult segment;
+            segment.RecognitionStatus = "Success";
+            segment.Offset = phrase.Offset;
+            segment.Duration = phrase.Duration;
+            segment.NBest.emplace_back();
+            segment.NBest.back().Lexical = phrase.Text;
+            textBytes += phrase.Text.size();
+
+            auto start = chrono::steady_clock::now();
+            index.Add(fileName, segment);
+            buildTime += chrono::steady_clock::now() - start;
+
+            // Samples phrases of two and three words to query.
+            if (phrases.size() < 200 && random() % 1000 == 0)
+            {
+                size_t words = 2 + phrases.size() % 2;
+                size_t first = random() % (phrase.Words.size() - words + 1);
+                string text;
+                for (size_t i = first; i < first + words; i++)
+                {
+                    text += (i > first ? " " : "") + phrase.Words[i].first;
+                }
+                phrases.push_back(text);
+                phraseSources.emplace_back(fileName, phrase.Offset);
+            }
         }
+    }
 
-        if (!completed) {
-            Sleep(5000);
+    size_t misplaced = 0;
+    for (size_t i = 0; i < phrases.size(); i++)
+    {
+        auto hits = index.Search(phrases[i]);
+        if (none_of(hits.begin(), hits.end(), [&source = phraseSources[i]](const TranscriptHit& hit)
+            {
+                return hit.File == source.first && hit.Offset == source.second;
+            }))
+        {
+            cout << "\"" << phrases[i] << "\" of " << phraseSources[i].first << " @" << phraseSources[i].second << " was not found there." << endl;
+            misplaced++;
         }
+    }
+    if (misplaced > 0)
+    {
+        throw runtime_error(to_string(misplaced) + " of " + to_string(phrases.size()) + " phrases were not found where they were added.");
+    }
+
+    auto statistics = index.GetStatistics();
+    cout << "Indexed " << statistics.Segments << " segments, " << statistics.Occurrences << " words, " << textBytes / (1024 * 1024)
+        << " MB of text in " << buildTime.count() << " s: " << statistics.Segments / buildTime.count() << " segments/s, "
+        << textBytes / buildTime.count() / (1024 * 1024) << " MB/s" << endl;
+    cout << statistics.Terms << " terms, postings " << statistics.PostingBytes / (1024 * 1024) << " MB, "
+        << 100.0 * statistics.PostingBytes / textBytes << "% of the text" << endl;
 
+    auto measure = [&index](const string& label, const vector<string>& queries)
+    {
+        const int repetitions = 10;
+        size_t hits = 0;
+        auto start = chrono::steady_clock::now();
+        for (int i = 0; i < repetitions; i++)
+        {
+            for (const auto& query : queries)
+            {
+                hits += index.Search(query).size();
+            }
+        }
+        chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+        cout << label << elapsed.count() * 1e6 / (repetitions * queries.size()) << " us per query, "
+            << hits / (repetitions * queries.size()) << " hits on average" << endl;
+    };
+    for (size_t rank : { 0, 10, 100, 1000, 10000 })
+    {
+        measure("Term of rank " + to_string(rank) + ": ", { corpus.Word(rank) });
     }
+    measure("Phrases:         ", phrases);
+
+    const string fileName = "benchmark.index";
+    auto start = chrono::steady_clock::now();
+    index.Save(fileName);
+    chrono::duration<double> saved = chrono::steady_clock::now() - start;
+    start = chrono::steady_clock::now();
+    TranscriptIndex loaded;
+    loaded.Load(fileName);
+    chrono::duration<double> loadedTime = chrono::steady_clock::now() - start;
+    cout << "Saved in " << saved.count() << " s, loaded in " << loadedTime.count() << " s" << endl;
+    DeleteFileA(fileName.c_str());
 }
 
-int wmain()
+// Run with --benchmark-parser [segments] to compare the v2 and v3 result parsers instead of transcribing, which also
+// counts heap allocations when built with COUNT_ALLOCATIONS,
+// with --submit <manifest> [journal] to submit a transcription for every recording URL in the manifest,
+// with --benchmark-submit [count] to measure the submission rate against a local mock service,
+// with --benchmark-service [jobs] to load test submitting, polling and fetching against the mock service,
+// with --benchmark-journal [jobs] to measure the job journal,
+// with --benchmark-webhook [jobs] to compare the completion to fetch latency of polling and webhooks,
+// with --search <phrase> [index] to find where the fetched results mention the phrase,
+// or with --benchmark-index [segments] to measure building and querying the index.
+// Put --webhook <listenUrl> <callbackUrl> first to be notified of completed transcriptions by a webhook.
+int wmain(int argc, wchar_t* argv[])
 {
     try
     {
-        recognizeSpeech();
+        std::wstring_convert<std::codecvt_utf8_utf16<wchar_t>> converter;
+        if (argc > 3 && wstring(argv[1]) == L"--webhook")
+        {
+            webhookListenUrl = argv[2];
+            webhookCallbackUrl = argv[3];
+            argv[3] = argv[0];
+            argv += 3;
+            argc -= 3;
+        }
+
+        if (argc > 1 && wstring(argv[1]) == L"--benchmark-parser")
+        {
+            benchmarkResultParser(argc > 2 ? stoul(argv[2]) : 10000);
+        }
+        else if (argc > 2 && wstring(argv[1]) == L"--submit")
+        {
+            submitManifest(converter.to_bytes(argv[2]), argc > 3 ? converter.to_bytes(argv[3]) : journalFile);
+        }
+        else if (argc > 1 && wstring(argv[1]) == L"--benchmark-service")
+        {
+            benchmarkService(argc > 2 ? stoul(argv[2]) : 100);
+        }
+        else if (argc > 1 && wstring(argv[1]) == L"--benchmark-journal")
+        {
+            benchmarkJournal(argc > 2 ? stoul(argv[2]) : 100000);
+        }
+        else if (argc > 1 && wstring(argv[1]) == L"--benchmark-submit")
+        {
+            benchmarkSubmission(argc > 2 ? stoul(argv[2]) : 2000);
+        }
+        else if (argc > 1 && wstring(argv[1]) == L"--benchmark-webhook")
+        {
+            benchmarkWebhook(argc > 2 ? stoul(argv[2]) : 100);
+        }
+        else if (argc > 2 && wstring(argv[1]) == L"--search")
+        {
+            searchIndex(converter.to_bytes(argv[2]), argc > 3 ? converter.to_bytes(argv[3]) : indexFile);
+        }
+        else if (argc > 1 && wstring(argv[1]) == L"--benchmark-index")
+        {
+            benchmarkIndex(argc > 2 ? stoul(argv[2]) : 1000000);
+        }
+        else
+        {
+            recognizeSpeech();
+        }
     }
     catch (exception e)
     {
@@ -313,4 +968,3 @@ int wmain()
     cin.get();
     return 0;
 }
-
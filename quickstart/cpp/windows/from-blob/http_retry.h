@@ -0,0 +1,29 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#pragma once
+
+#include <chrono>
+#include <exception>
+#include <string>
+
+#include <cpprest/http_client.h>
+
+// Retry-After in seconds, or 0 if the header is missing. The HTTP date form is not used by the service and is ignored.
+inline std::chrono::milliseconds GetRetryAfter(const web::http::http_headers& headers)
+{
+    auto it = headers.find(U("Retry-After"));
+    if (it == headers.end())
+    {
+        return std::chrono::milliseconds(0);
+    }
+    try
+    {
+        return std::chrono::seconds(std::stoi(it->second));
+    }
+    catch (const std::exception&)
+    {
+        return std::chrono::milliseconds(0);
+    }
+}
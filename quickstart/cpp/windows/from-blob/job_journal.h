@@ -0,0 +1,481 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <Windows.h>
+
+#include "durable_file.h"
+
+// State of a transcription job, as recorded in the JobJournal.
+struct JournalJob
+{
+    std::string Recording;
+    std::string Location;       // empty once the job is done and compacted.
+    std::string Status;         // last status received, empty before the first.
+    std::string ResultsUrls;    // JSON object of the result channels, once succeeded.
+    bool Fetched = false;       // the results were fetched, nothing is left to do.
+};
+
+// Settings of the JobJournal.
+struct JobJournalOptions
+{
+    std::chrono::milliseconds SyncInterval = std::chrono::milliseconds(100);  // status updates are flushed within it.
+    size_t CompactionMinRecords = 10000;    // the journal is not compacted below this many records...
+    double CompactionRatio = 2;             // ...nor while it has less than this many records per job.
+};
+
+// An append-only journal of the submitted transcriptions, their status and whether their results were fetched,
+// so a restarted client resumes polling and fetching instead of submitting (and paying for) the audio again.
+//
+// Every record is one line with a CRC-32 of its content. A crash can only tear the last lines, which fail the
+// check when the journal is opened and are cut off. Records are written and flushed to the disk by a background
+// thread in batches: callers that must not lose a record (a submission, a completed fetch) wait for the flush of
+// their batch, which all records appended during the previous flush share, while status updates do not wait at all.
+//
+// When the journal holds many more records than jobs, it is rewritten with one record per job into a new file
+// that replaces it atomically. Done jobs shrink to their recording, which is all that is needed to never submit
+// it again, so the journal stays small across millions of jobs.
+class JobJournal
+{
+public:
+    using Options = JobJournalOptions;
+
+    struct Statistics
+    {
+        uint64_t Records = 0;
+        uint64_t Flushes = 0;
+        uint64_t Compactions = 0;
+        uint64_t TornBytes = 0;     // cut off when the journal was opened.
+        uint64_t FileBytes = 0;
+    };
+
+    explicit JobJournal(const std::string& fileName, const Options& options = Options()) :
+        m_fileName(fileName),
+        m_options(options)
+    {
+        auto validBytes = Replay();
+        m_file = OpenFile(m_fileName, OPEN_ALWAYS);
+        LARGE_INTEGER size;
+        size.QuadPart = static_cast<LONGLONG>(validBytes);
+        if (!SetFilePointerEx(m_file, size, nullptr, FILE_BEGIN) || !SetEndOfFile(m_file))
+        {
+            CloseHandle(m_file);
+            throw std::runtime_error("Cannot truncate the journal " + m_fileName);
+        }
+        m_statistics.FileBytes = validBytes;
+        m_writer = std::thread(&JobJournal::Run, this);
+    }
+
+    ~JobJournal()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+        }
+        m_changed.notify_all();
+        m_writer.join();
+        CloseHandle(m_file);
+    }
+
+    // Records a created transcription. Returns once the record is on the disk.
+    void Submitted(const std::string& recording, const std::string& location)
+    {
+        Append({ "S", recording, location }, true);
+    }
+
+    // Records a status of a transcription, with its result channels once it succeeded.
+    void StatusReceived(const std::string& location, const std::string& status, const std::string& resultsUrls = "")
+    {
+        Append({ "T", location, status, resultsUrls }, false);
+    }
+
+    // Records that the results of a transcription were fetched. Returns once the record is on the disk.
+    void Fetched(const std::string& location)
+    {
+        Append({ "F", location }, true);
+    }
+
+    // Waits until all records are on the disk.
+    void Sync()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        auto sequence = m_appended;
+        m_waiters++;
+        m_changed.notify_all();
+        m_changed.wait(lock, [this, sequence]() { return m_durable >= sequence || !m_error.empty(); });
+        m_waiters--;
+        ThrowIfFailed();
+    }
+
+    bool FindRecording(const std::string& recording, JournalJob* job) const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_recordings.find(recording);
+        if (it == m_recordings.end())
+        {
+            return false;
+        }
+        *job = m_jobs[it->second];
+        return true;
+    }
+
+    // The jobs that are not done yet. With refetch, also those whose results were fetched before, e.g. to rebuild
+    // an index of the results that was lost.
+    std::vector<JournalJob> PendingJobs(bool refetch = false) const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::vector<JournalJob> pending;
+        for (const auto& job : m_jobs)
+        {
+            if (!IsDone(job) || (refetch && job.Fetched))
+            {
+                pending.push_back(job);
+            }
+        }
+        return pending;
+    }
+
+    Statistics GetStatistics() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_statistics;
+    }
+
+private:
+    static bool IsDone(const JournalJob& job)
+    {
+        return job.Fetched || job.Status == "Failed";
+    }
+
+    void Append(const std::vector<std::string>& fields, bool waitForDisk)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        ThrowIfFailed();
+        Apply(fields);
+        m_pending += Encode(fields);
+        auto sequence = ++m_appended;
+        m_statistics.Records++;
+        m_changed.notify_all();
+        if (waitForDisk)
+        {
+            m_waiters++;
+            m_changed.wait(lock, [this, sequence]() { return m_durable >= sequence || !m_error.empty(); });
+            m_waiters--;
+            ThrowIfFailed();
+        }
+    }
+
+    // Applies a record to the jobs. Records of unknown transcriptions are ignored.
+    void Apply(const std::vector<std::string>& fields)
+    {
+        const auto& type = fields[0];
+        if ((type == "S" || type == "J") && fields.size() >= 3)
+        {
+            size_t index;
+            auto it = m_recordings.find(fields[1]);
+            if (it == m_recordings.end())
+            {
+                index = m_jobs.size();
+                m_jobs.emplace_back();
+                m_recordings[fields[1]] = index;
+            }
+            else if (type == "S" && m_jobs[it->second].Location == fields[2])
+            {
+                // Written once more after a compaction that already included it.
+                return;
+            }
+            else
+            {
+                // A recording submitted again gets the new transcription.
+                index = it->second;
+                m_locations.erase(m_jobs[index].Location);
+                m_jobs[index] = JournalJob();
+            }
+            auto& job = m_jobs[index];
+            job.Recording = fields[1];
+            job.Location = fields[2];
+            if (type == "J" && fields.size() >= 6)
+            {
+                job.Status = fields[3];
+                job.ResultsUrls = fields[4];
+                job.Fetched = fields[5] == "1";
+            }
+            if (!job.Location.empty())
+            {
+                m_locations[job.Location] = index;
+            }
+            return;
+        }
+        if (fields.size() < 2)
+        {
+            return;
+        }
+        auto it = m_locations.find(fields[1]);
+        if (it == m_locations.end())
+        {
+            return;
+        }
+        auto& job = m_jobs[it->second];
+        if (type == "T" && fields.size() >= 4)
+        {
+            job.Status = fields[2];
+            if (!fields[3].empty())
+            {
+                job.ResultsUrls = fields[3];
+            }
+        }
+        else if (type == "F")
+        {
+            job.Fetched = true;
+        }
+    }
+
+    // Reads the journal into the jobs and returns the length of its valid part.
+    uint64_t Replay()
+    {
+        std::ifstream file(m_fileName, std::ios::binary);
+        std::string line;
+        uint64_t validBytes = 0;
+        uint64_t totalBytes = 0;
+        while (std::getline(file, line))
+        {
+            totalBytes += line.size() + 1;
+            std::vector<std::string> fields;
+            if (file.eof() || !Decode(line, &fields))
+            {
+                // A torn record, everything after it was written later and cannot be trusted either.
+                break;
+            }
+            Apply(fields);
+            validBytes = totalBytes;
+            m_recordsInFile++;
+        }
+        file.clear();
+        file.seekg(0, std::ios::end);
+        auto fileBytes = file.tellg();
+        m_statistics.TornBytes = fileBytes > 0 ? static_cast<uint64_t>(fileBytes) - validBytes : 0;
+        return validBytes;
+    }
+
+    // Writes the records appended meanwhile, in batches, until the journal is closed.
+    void Run()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (true)
+        {
+            m_changed.wait(lock, [this]() { return !m_pending.empty() || m_stopping; });
+            if (m_pending.empty())
+            {
+                break;
+            }
+
+            // Nobody waits for status updates, which are collected for a while to share a flush. Records that are
+            // waited for are written right away, and those appended during a flush share the next one.
+            m_changed.wait_for(lock, m_options.SyncInterval, [this]() { return m_waiters > 0 || m_stopping; });
+
+            std::string batch;
+            batch.swap(m_pending);
+            auto sequence = m_appended;
+            auto records = m_appended - m_durable;
+            lock.unlock();
+            bool written = WriteAll(m_file, batch) && FlushFileBuffers(m_file);
+            lock.lock();
+
+            if (!written)
+            {
+                m_error = "Cannot write the journal " + m_fileName;
+                m_changed.notify_all();
+                break;
+            }
+            m_durable = sequence;
+            m_recordsInFile += records;
+            m_statistics.Flushes++;
+            m_statistics.FileBytes += batch.size();
+            if (m_recordsInFile >= m_options.CompactionMinRecords && m_recordsInFile > m_options.CompactionRatio * m_jobs.size())
+            {
+                try
+                {
+                    Compact();
+                }
+                catch (const std::exception& e)
+                {
+                    m_error = e.what();
+                    m_changed.notify_all();
+                    break;
+                }
+            }
+            m_changed.notify_all();
+        }
+    }
+
+    // Rewrites the journal with one record per job. Called with the lock held, after all records were written.
+    void Compact()
+    {
+        std::string snapshot;
+        for (const auto& job : m_jobs)
+        {
+            if (IsDone(job))
+            {
+                snapshot += Encode({ "J", job.Recording, "", job.Status, "", "1" });
+            }
+            else
+            {
+                snapshot += Encode({ "J", job.Recording, job.Location, job.Status, job.ResultsUrls, job.Fetched ? "1" : "0" });
+            }
+        }
+
+        auto compactedName = m_fileName + ".compacting";
+        auto compacted = OpenFile(compactedName, CREATE_ALWAYS);
+        bool written = WriteAll(compacted, snapshot) && FlushFileBuffers(compacted);
+        CloseHandle(compacted);
+        if (!written)
+        {
+            // The journal is still complete, compaction is tried again later.
+            DeleteFileA(compactedName.c_str());
+            return;
+        }
+
+        CloseHandle(m_file);
+        if (!MoveFileExA(compactedName.c_str(), m_fileName.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+        {
+            DeleteFileA(compactedName.c_str());
+        }
+        else
+        {
+            // Done jobs are only needed to recognize their recordings.
+            m_locations.clear();
+            for (size_t index = 0; index < m_jobs.size(); index++)
+            {
+                auto& job = m_jobs[index];
+                if (IsDone(job))
+                {
+                    job.Location.clear();
+                    job.ResultsUrls.clear();
+                }
+                else
+                {
+                    m_locations[job.Location] = index;
+                }
+            }
+            m_recordsInFile = m_jobs.size();
+            m_statistics.FileBytes = snapshot.size();
+            m_statistics.Compactions++;
+        }
+
+        m_file = OpenFile(m_fileName, OPEN_ALWAYS);
+        LARGE_INTEGER end = {};
+        SetFilePointerEx(m_file, end, nullptr, FILE_END);
+    }
+
+    // A record is "<crc32> <fields separated by tabs>\n", with tabs, line breaks and backslashes escaped.
+    static std::string Encode(const std::vector<std::string>& fields)
+    {
+        std::string content;
+        for (size_t i = 0; i < fields.size(); i++)
+        {
+            if (i > 0)
+            {
+                content += '\t';
+            }
+            for (char c : fields[i])
+            {
+                switch (c)
+                {
+                case '\t': content += "\\t"; break;
+                case '\n': content += "\\n"; break;
+                case '\r': content += "\\r"; break;
+                case '\\': content += "\\\\"; break;
+                default: content += c; break;
+                }
+            }
+        }
+        char checksum[10];
+        snprintf(checksum, sizeof(checksum), "%08x ", Crc32(content));
+        return checksum + content + "\n";
+    }
+
+    static bool Decode(const std::string& line, std::vector<std::string>* fields)
+    {
+        if (line.size() < 10 || line[8] != ' ')
+        {
+            return false;
+        }
+        auto content = line.substr(9);
+        char checksum[9];
+        snprintf(checksum, sizeof(checksum), "%08x", Crc32(content));
+        if (line.compare(0, 8, checksum) != 0)
+        {
+            return false;
+        }
+
+        fields->assign(1, std::string());
+        for (size_t i = 0; i < content.size(); i++)
+        {
+            char c = content[i];
+            if (c == '\t')
+            {
+                fields->emplace_back();
+            }
+            else if (c == '\\' && i + 1 < content.size())
+            {
+                c = content[++i];
+                fields->back() += c == 't' ? '\t' : c == 'n' ? '\n' : c == 'r' ? '\r' : c;
+            }
+            else
+            {
+                fields->back() += c;
+            }
+        }
+        return true;
+    }
+
+    static HANDLE OpenFile(const std::string& fileName, DWORD disposition)
+    {
+        auto file = CreateFileA(fileName.c_str(), GENERIC_WRITE, FILE_SHARE_READ, nullptr, disposition, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+        {
+            throw std::runtime_error("Cannot open the journal " + fileName);
+        }
+        return file;
+    }
+
+    void ThrowIfFailed() const
+    {
+        if (!m_error.empty())
+        {
+            throw std::runtime_error(m_error);
+        }
+    }
+
+    std::string m_fileName;
+    Options m_options;
+    HANDLE m_file;
+    std::thread m_writer;
+    mutable std::mutex m_mutex;
+    std::condition_variable m_changed;
+    std::vector<JournalJob> m_jobs;
+    std::map<std::string, size_t> m_recordings;     // index of the job in m_jobs.
+    std::map<std::string, size_t> m_locations;
+    std::string m_pending;                          // records not written yet.
+    uint64_t m_appended = 0;                        // sequence number of the last record appended.
+    uint64_t m_durable = 0;                         // sequence number of the last record on the disk.
+    uint64_t m_recordsInFile = 0;
+    size_t m_waiters = 0;                           // callers waiting for their records to be on the disk.
+    bool m_stopping = false;
+    std::string m_error;
+    Statistics m_statistics;
+};
@@ -0,0 +1,399 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+
+// Reads a JSON document in place, for parsers that know the shape of the document: they ask for the value they
+// expect next, and skip everything else without looking into it beyond its extent.
+//
+// Escaped strings are unescaped within the buffer, which never makes them longer, so strings are returned as views
+// into it. The buffer must be followed by a null character, like the one of a std::string.
+class JsonCursor
+{
+public:
+    JsonCursor() = default;
+    JsonCursor(char* begin, char* end) : m_begin(begin), m_position(begin), m_end(end) {}
+
+    // Calls onMember(key) for every member, which parses or skips the value.
+    template<class MemberHandler>
+    bool ParseObject(MemberHandler onMember)
+    {
+        if (!Expect('{'))
+        {
+            return false;
+        }
+        SkipWhitespace();
+        if (m_position < m_end && *m_position == '}')
+        {
+            m_position++;
+            return true;
+        }
+        while (true)
+        {
+            std::string_view key;
+            if (!ParseString(&key) || !Expect(':') || !onMember(key))
+            {
+                return false;
+            }
+            SkipWhitespace();
+            if (m_position < m_end && *m_position == ',')
+            {
+                m_position++;
+                continue;
+            }
+            return Expect('}');
+        }
+    }
+
+    // Calls onElement() for every element, which parses it.
+    template<class ElementHandler>
+    bool ParseArray(ElementHandler onElement)
+    {
+        if (!Expect('['))
+        {
+            return false;
+        }
+        SkipWhitespace();
+        if (m_position < m_end && *m_position == ']')
+        {
+            m_position++;
+            return true;
+        }
+        while (true)
+        {
+            if (!onElement())
+            {
+                return false;
+            }
+            SkipWhitespace();
+            if (m_position < m_end && *m_position == ',')
+            {
+                m_position++;
+                continue;
+            }
+            return Expect(']');
+        }
+    }
+
+    // Parses a string, or null as an empty string.
+    bool ParseString(std::string_view* value)
+    {
+        SkipWhitespace();
+        if (IsLiteral("null"))
+        {
+            *value = std::string_view();
+            return true;
+        }
+        if (!Expect('"'))
+        {
+            return false;
+        }
+
+        char* start = m_position;
+        char* write = m_position;
+        while (m_position < m_end)
+        {
+            char c = *m_position++;
+            if (c == '"')
+            {
+                *value = std::string_view(start, write - start);
+                return true;
+            }
+            if (c != '\\')
+            {
+                *write++ = c;
+                continue;
+            }
+            if (m_position >= m_end)
+            {
+                break;
+            }
+            switch (c = *m_position++)
+            {
+            case 'b': *write++ = '\b'; break;
+            case 'f': *write++ = '\f'; break;
+            case 'n': *write++ = '\n'; break;
+            case 'r': *write++ = '\r'; break;
+            case 't': *write++ = '\t'; break;
+            case 'u':
+                if (!UnescapeUnicode(&write))
+                {
+                    return false;
+                }
+                break;
+            default: *write++ = c; break;   // '"', '\\' and '/'
+            }
+        }
+        return Fail("Unterminated string.");
+    }
+
+    bool ParseString(std::string* value)
+    {
+        std::string_view view;
+        if (!ParseString(&view))
+        {
+            return false;
+        }
+        value->assign(view.data(), view.size());
+        return true;
+    }
+
+    // Integers, like ticks, are accumulated directly from the digits. Other numbers fall back to strtod.
+    bool ParseUnsigned(uint64_t* value)
+    {
+        SkipWhitespace();
+        char* start = m_position;
+        uint64_t result = 0;
+        while (m_position < m_end && *m_position >= '0' && *m_position <= '9')
+        {
+            result = result * 10 + (*m_position++ - '0');
+        }
+        if (m_position < m_end && (*m_position == '.' || *m_position == 'e' || *m_position == 'E' || *m_position == '-'))
+        {
+            m_position = start;
+            double number;
+            if (!ParseDouble(&number))
+            {
+                return false;
+            }
+            result = number > 0 ? static_cast<uint64_t>(number) : 0;
+        }
+        else if (m_position == start)
+        {
+            return Fail("Expected a number.");
+        }
+        *value = result;
+        return true;
+    }
+
+    template<class Integer>
+    bool ParseInteger(Integer* value)
+    {
+        SkipWhitespace();
+        bool negative = m_position < m_end && *m_position == '-';
+        if (negative)
+        {
+            m_position++;
+        }
+        uint64_t magnitude;
+        if (!ParseUnsigned(&magnitude))
+        {
+            return false;
+        }
+        *value = static_cast<Integer>(negative ? 0 - magnitude : magnitude);
+        return true;
+    }
+
+    // strtod stops at the null character after the buffer at the latest.
+    bool ParseDouble(double* value)
+    {
+        SkipWhitespace();
+        char* end;
+        *value = std::strtod(m_position, &end);
+        if (end == m_position)
+        {
+            return Fail("Expected a number.");
+        }
+        m_position = end;
+        return true;
+    }
+
+    bool ParseBoolean(bool* value)
+    {
+        SkipWhitespace();
+        if (IsLiteral("true"))
+        {
+            *value = true;
+            return true;
+        }
+        if (IsLiteral("false"))
+        {
+            *value = false;
+            return true;
+        }
+        return Fail("Expected true or false.");
+    }
+
+    // Skips a value of any type.
+    bool SkipValue()
+    {
+        SkipWhitespace();
+        if (m_position >= m_end)
+        {
+            return Fail("Unexpected end of the document.");
+        }
+        char c = *m_position;
+        if (c == '"')
+        {
+            std::string_view ignored;
+            return ParseString(&ignored);
+        }
+        if (c != '{' && c != '[')
+        {
+            // Number, true, false or null.
+            while (m_position < m_end && *m_position != ',' && *m_position != '}' && *m_position != ']' && !IsWhitespace(*m_position))
+            {
+                m_position++;
+            }
+            return true;
+        }
+
+        size_t depth = 0;
+        while (m_position < m_end)
+        {
+            c = *m_position++;
+            if (c == '{' || c == '[')
+            {
+                depth++;
+            }
+            else if (c == '}' || c == ']')
+            {
+                if (--depth == 0)
+                {
+                    return true;
+                }
+            }
+            else if (c == '"')
+            {
+                // Scans to the closing quote, stepping over escaped characters.
+                while (m_position < m_end && *m_position != '"')
+                {
+                    m_position += *m_position == '\\' ? 2 : 1;
+                }
+                m_position++;
+            }
+        }
+        return Fail("Unexpected end of the document.");
+    }
+
+    // Checks that nothing but whitespace follows the document.
+    bool ExpectEnd()
+    {
+        SkipWhitespace();
+        return m_position == m_end || Fail("Unexpected data after the document.");
+    }
+
+    // Records the first error with the offset it occurred at. Always returns false.
+    bool Fail(const std::string& message)
+    {
+        if (m_error.empty())
+        {
+            m_error = message + " At offset " + std::to_string(m_position - m_begin) + ".";
+        }
+        return false;
+    }
+
+    const std::string& Error() const { return m_error; }
+
+private:
+    // Decodes the digits of a \u escape, and of a following low surrogate, as UTF-8.
+    bool UnescapeUnicode(char** write)
+    {
+        uint32_t codePoint;
+        if (!ParseHex4(&codePoint))
+        {
+            return false;
+        }
+        if (codePoint >= 0xd800 && codePoint <= 0xdbff && m_end - m_position >= 6 && m_position[0] == '\\' && m_position[1] == 'u')
+        {
+            m_position += 2;
+            uint32_t low;
+            if (!ParseHex4(&low))
+            {
+                return false;
+            }
+            codePoint = 0x10000 + ((codePoint - 0xd800) << 10) + (low - 0xdc00);
+        }
+
+        char*& out = *write;
+        if (codePoint < 0x80)
+        {
+            *out++ = static_cast<char>(codePoint);
+        }
+        else if (codePoint < 0x800)
+        {
+            *out++ = static_cast<char>(0xc0 | (codePoint >> 6));
+            *out++ = static_cast<char>(0x80 | (codePoint & 0x3f));
+        }
+        else if (codePoint < 0x10000)
+        {
+            *out++ = static_cast<char>(0xe0 | (codePoint >> 12));
+            *out++ = static_cast<char>(0x80 | ((codePoint >> 6) & 0x3f));
+            *out++ = static_cast<char>(0x80 | (codePoint & 0x3f));
+        }
+        else
+        {
+            *out++ = static_cast<char>(0xf0 | (codePoint >> 18));
+            *out++ = static_cast<char>(0x80 | ((codePoint >> 12) & 0x3f));
+            *out++ = static_cast<char>(0x80 | ((codePoint >> 6) & 0x3f));
+            *out++ = static_cast<char>(0x80 | (codePoint & 0x3f));
+        }
+        return true;
+    }
+
+    bool ParseHex4(uint32_t* value)
+    {
+        if (m_end - m_position < 4)
+        {
+            return Fail("Truncated unicode escape.");
+        }
+        *value = 0;
+        for (int i = 0; i < 4; i++)
+        {
+            char c = *m_position++;
+            uint32_t digit = c >= '0' && c <= '9' ? c - '0' : (c | 0x20) >= 'a' && (c | 0x20) <= 'f' ? (c | 0x20) - 'a' + 10 : 16;
+            if (digit > 15)
+            {
+                return Fail("Invalid unicode escape.");
+            }
+            *value = *value * 16 + digit;
+        }
+        return true;
+    }
+
+    bool IsLiteral(const char* literal)
+    {
+        auto length = std::char_traits<char>::length(literal);
+        if (static_cast<size_t>(m_end - m_position) >= length && std::char_traits<char>::compare(m_position, literal, length) == 0)
+        {
+            m_position += length;
+            return true;
+        }
+        return false;
+    }
+
+    static bool IsWhitespace(char c)
+    {
+        return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+    }
+
+    void SkipWhitespace()
+    {
+        while (m_position < m_end && IsWhitespace(*m_position))
+        {
+            m_position++;
+        }
+    }
+
+    bool Expect(char c)
+    {
+        SkipWhitespace();
+        if (m_position < m_end && *m_position == c)
+        {
+            m_position++;
+            return true;
+        }
+        return Fail(std::string("Expected '") + c + "'.");
+    }
+
+    char* m_begin = nullptr;
+    char* m_position = nullptr;
+    char* m_end = nullptr;
+    std::string m_error;
+};
@@ -0,0 +1,522 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <cpprest/http_listener.h>
+#include <nlohmann/json.hpp>
+
+#include "synthetic_results.h"
+#include "webhook_receiver.h"
+
+// Format of the results served by the MockTranscriptionService.
+enum class MockResultFormat
+{
+    V2,     // AudioFileResults, as parsed by the transcription_result.h model.
+    V3      // recognizedPhrases, as in samples/batch/transcriptionresult_v3.schema.json.
+};
+
+// Settings of the MockTranscriptionService.
+struct MockTranscriptionServiceOptions
+{
+    double RequestsPerSecond = 0;   // requests beyond this rate are rejected with 429, unlimited if 0.
+    int RetryAfterSeconds = 1;
+
+    // A transcription is NotStarted for QueueDelay, then Running for ProcessingDelay. Both are scaled by a random
+    // factor in [1 - DelayJitter, 1 + DelayJitter] per transcription.
+    std::chrono::milliseconds QueueDelay = std::chrono::seconds(1);
+    std::chrono::milliseconds ProcessingDelay = std::chrono::seconds(5);
+    double DelayJitter = 0.5;
+
+    double ErrorRate = 0;           // fraction of requests answered with 500 or 503, to exercise retries.
+    double FailureRate = 0;         // fraction of transcriptions that end Failed.
+
+    size_t Channels = 1;
+    size_t PhrasesPerChannel = 1000;
+    MockResultFormat ResultFormat = MockResultFormat::V3;
+
+    // Registered webhooks are notified this long after a transcription completed. A fraction of the notifications
+    // is lost, to exercise the client's fallback polling.
+    std::chrono::milliseconds WebhookDelay = std::chrono::milliseconds(0);
+    double WebhookLossRate = 0;
+};
+
+// A local stand-in for the batch transcription REST API (v2), to load test the client without the service.
+// It implements creating a transcription, polling its status and downloading its results:
+//
+//     POST api/speechtotext/v2.0/Transcriptions/        202 with the Location of the transcription
+//     GET  api/speechtotext/v2.0/Transcriptions/{id}    the transcription, NotStarted, Running, then Succeeded or Failed
+//     GET  results/{id}/{channel}                       the generated result of a channel
+//     POST api/speechtotext/v3.0/webhooks               registers a webhook after a challenge of its URL, 201
+//     DELETE api/speechtotext/v3.0/webhooks/{id}        deletes a webhook
+//
+// Registered webhooks are notified of every completed transcription with a signed TranscriptionCompletion event,
+// sent by a thread that waits for the completion times.
+//
+// Requests above a rate limit are answered 429 with Retry-After, and a fraction of all requests fail with 500 or 503
+// to exercise the client's retries. The results are generated once per channel and served to all transcriptions.
+//
+// The listener uses HTTP.sys, which needs a URL reservation for the listen URL when not running as administrator:
+//     netsh http add urlacl url=http://+:5000/ user=Everyone
+class MockTranscriptionService
+{
+public:
+    using Options = MockTranscriptionServiceOptions;
+
+    struct Statistics
+    {
+        size_t Created = 0;
+        size_t StatusRequests = 0;
+        size_t ResultRequests = 0;
+        size_t ResultBytes = 0;
+        size_t Throttled = 0;
+        size_t InjectedErrors = 0;
+        size_t Notifications = 0;
+        size_t LostNotifications = 0;
+    };
+
+    MockTranscriptionService(const utility::string_t& listenUrl, const Options& options = Options()) :
+        m_baseUrl(listenUrl),
+        m_listener(web::uri(listenUrl)),
+        m_options(options),
+        m_random(std::random_device()()),
+        m_windowStart(Clock::now()),
+        m_results(options.Channels)
+    {
+        m_listener.support([this](web::http::http_request request) { Handle(request); });
+        m_listener.open().wait();
+        m_notifier = std::thread(&MockTranscriptionService::Notify, this);
+    }
+
+    ~MockTranscriptionService()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+            m_notificationDue.notify_one();
+        }
+        m_notifier.join();
+        m_listener.close().wait();
+    }
+
+    // The URL of the transcriptions collection, for the client.
+    utility::string_t TranscriptionsUrl() const
+    {
+        return m_baseUrl + U("api/speechtotext/v2.0/Transcriptions/");
+    }
+
+    // The URL of the webhooks collection, for the WebhookReceiver.
+    utility::string_t WebhooksUrl() const
+    {
+        return m_baseUrl + U("api/speechtotext/v3.0/webhooks");
+    }
+
+    // When the transcription at location completed, or will complete, to measure how long the client takes to
+    // notice. The epoch if there is no such transcription.
+    std::chrono::steady_clock::time_point CompletionTime(const utility::string_t& location) const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_transcriptions.find(TranscriptionIdFromUrl(utility::conversions::to_utf8string(location)));
+        return it == m_transcriptions.end() ? Clock::time_point() : it->second.Completed;
+    }
+
+    Statistics GetStatistics() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_statistics;
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Transcription
+    {
+        std::string Name;
+        std::string RecordingsUrl;
+        Clock::time_point Created;
+        Clock::time_point Started;
+        Clock::time_point Completed;
+        bool Fails;
+    };
+
+    struct Webhook
+    {
+        std::string Secret;
+        std::shared_ptr<web::http::client::http_client> Client;
+    };
+
+    struct Notification
+    {
+        Clock::time_point Due;
+        std::string TranscriptionId;
+
+        bool operator>(const Notification& other) const { return Due > other.Due; }
+    };
+
+    void Handle(web::http::http_request request)
+    {
+        if (IsThrottled())
+        {
+            web::http::http_response response(web::http::status_codes::TooManyRequests);
+            response.headers().add(U("Retry-After"), utility::conversions::to_string_t(std::to_string(m_options.RetryAfterSeconds)));
+            request.reply(response);
+            return;
+        }
+        if (InjectError(request))
+        {
+            return;
+        }
+
+        auto path = web::uri::split_path(request.relative_uri().path());
+        if (request.method() == web::http::methods::POST && path.size() == 4 && IsTranscriptionsPath(path))
+        {
+            HandleCreate(request);
+        }
+        else if (request.method() == web::http::methods::GET && path.size() == 5 && IsTranscriptionsPath(path))
+        {
+            HandleStatus(request, utility::conversions::to_utf8string(path[4]));
+        }
+        else if (request.method() == web::http::methods::GET && path.size() == 3 && path[0] == U("results"))
+        {
+            HandleResult(request, utility::conversions::to_utf8string(path[1]), utility::conversions::to_utf8string(path[2]));
+        }
+        else if (request.method() == web::http::methods::POST && path.size() == 4 && IsWebhooksPath(path))
+        {
+            HandleRegisterWebhook(request);
+        }
+        else if (request.method() == web::http::methods::DEL && path.size() == 5 && IsWebhooksPath(path))
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            bool deleted = m_webhooks.erase(utility::conversions::to_utf8string(path[4])) > 0;
+            request.reply(deleted ? web::http::status_codes::NoContent : web::http::status_codes::NotFound);
+        }
+        else
+        {
+            request.reply(web::http::status_codes::NotFound);
+        }
+    }
+
+    static bool IsTranscriptionsPath(const std::vector<utility::string_t>& path)
+    {
+        return path[0] == U("api") && path[1] == U("speechtotext") && path[2] == U("v2.0") && path[3] == U("Transcriptions");
+    }
+
+    static bool IsWebhooksPath(const std::vector<utility::string_t>& path)
+    {
+        return path[0] == U("api") && path[1] == U("speechtotext") && path[2] == U("v3.0") && path[3] == U("webhooks");
+    }
+
+    void HandleCreate(web::http::http_request request)
+    {
+        nlohmann::json definition;
+        try
+        {
+            definition = nlohmann::json::parse(request.extract_utf8string(true).get());
+        }
+        catch (const std::exception&)
+        {
+            request.reply(web::http::status_codes::BadRequest);
+            return;
+        }
+
+        std::string id;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            std::uniform_real_distribution<double> jitter(1 - m_options.DelayJitter, 1 + m_options.DelayJitter);
+            std::uniform_real_distribution<double> chance(0, 1);
+
+            Transcription transcription;
+            transcription.Name = definition.value("name", "");
+            transcription.RecordingsUrl = definition.value("recordingsurl", "");
+            transcription.Created = Clock::now();
+            transcription.Started = transcription.Created + Scale(m_options.QueueDelay, jitter(m_random));
+            transcription.Completed = transcription.Started + Scale(m_options.ProcessingDelay, jitter(m_random));
+            transcription.Fails = chance(m_random) < m_options.FailureRate;
+
+            id = std::to_string(++m_statistics.Created);
+            m_transcriptions[id] = transcription;
+            m_notifications.push(Notification{ transcription.Completed + m_options.WebhookDelay, id });
+            m_notificationDue.notify_one();
+        }
+
+        web::http::http_response response(web::http::status_codes::Accepted);
+        response.headers().add(U("Location"), TranscriptionsUrl() + utility::conversions::to_string_t(id));
+        request.reply(response);
+    }
+
+    void HandleStatus(web::http::http_request request, const std::string& id)
+    {
+        Transcription transcription;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_statistics.StatusRequests++;
+            auto it = m_transcriptions.find(id);
+            if (it == m_transcriptions.end())
+            {
+                request.reply(web::http::status_codes::NotFound);
+                return;
+            }
+            transcription = it->second;
+        }
+
+        auto now = Clock::now();
+        std::string status = now < transcription.Started ? "NotStarted" : now < transcription.Completed ? "Running"
+            : transcription.Fails ? "Failed" : "Succeeded";
+
+        nlohmann::json resultsUrls = nlohmann::json::object();
+        if (status == "Succeeded")
+        {
+            for (size_t channel = 0; channel < m_options.Channels; channel++)
+            {
+                resultsUrls["channel_" + std::to_string(channel)] = utility::conversions::to_utf8string(m_baseUrl)
+                    + "results/" + id + "/" + std::to_string(channel);
+            }
+        }
+
+        nlohmann::json body = {
+            { "id", id },
+            { "name", transcription.Name },
+            { "description", "" },
+            { "locale", "en-US" },
+            { "recordingsUrl", transcription.RecordingsUrl },
+            { "createdDateTime", "2020-06-16T09:30:21Z" },
+            { "lastActionDateTime", "2020-06-16T09:30:21Z" },
+            { "status", status },
+            { "statusMessage", status == "Failed" ? "The mock service failed this transcription." : "" },
+            { "resultsUrls", resultsUrls }
+        };
+        request.reply(web::http::status_codes::OK, body.dump(), "application/json");
+    }
+
+    void HandleResult(web::http::http_request request, const std::string& id, const std::string& channelText)
+    {
+        size_t channel = std::strtoul(channelText.c_str(), nullptr, 10);
+        std::shared_ptr<const std::string> result;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_transcriptions.count(id) == 0 || channel >= m_results.size())
+            {
+                request.reply(web::http::status_codes::NotFound);
+                return;
+            }
+            // Generated on first use, which may take a while for large results, and shared by all transcriptions.
+            if (!m_results[channel])
+            {
+                m_results[channel] = std::make_shared<const std::string>(m_options.ResultFormat == MockResultFormat::V2
+                    ? GenerateSyntheticResult(m_options.PhrasesPerChannel, 3, channel)
+                    : GenerateSyntheticResultV3(m_options.PhrasesPerChannel, 3, channel));
+            }
+            result = m_results[channel];
+            m_statistics.ResultRequests++;
+            m_statistics.ResultBytes += result->size();
+        }
+        request.reply(web::http::status_codes::OK, *result, "application/json");
+    }
+
+    // Challenges the URL of the webhook before registering it: the URL must answer with the validation token.
+    void HandleRegisterWebhook(web::http::http_request request)
+    {
+        nlohmann::json definition;
+        try
+        {
+            definition = nlohmann::json::parse(request.extract_utf8string(true).get());
+        }
+        catch (const std::exception&)
+        {
+            request.reply(web::http::status_codes::BadRequest);
+            return;
+        }
+
+        auto webUrl = utility::conversions::to_string_t(definition.value("webUrl", ""));
+        Webhook webhook;
+        webhook.Secret = definition.contains("properties") ? definition["properties"].value("secret", "") : "";
+        std::string token;
+        try
+        {
+            webhook.Client = std::make_shared<web::http::client::http_client>(webUrl);
+            std::lock_guard<std::mutex> lock(m_mutex);
+            token = std::to_string(m_random());
+        }
+        catch (const std::exception&)
+        {
+            request.reply(web::http::status_codes::BadRequest, "The webUrl is invalid.", "text/plain");
+            return;
+        }
+
+        web::http::http_request challenge(web::http::methods::POST);
+        challenge.set_request_uri(web::uri_builder().append_query(U("validationToken"), utility::conversions::to_string_t(token)).to_uri());
+        challenge.headers().add(U("X-MicrosoftSpeechServices-Event"), U("challenge"));
+        webhook.Client->request(challenge).then([this, request, webhook, token](pplx::task<web::http::http_response> task)
+        {
+            bool validated = false;
+            try
+            {
+                auto response = task.get();
+                validated = response.status_code() == web::http::status_codes::OK && response.extract_utf8string(true).get() == token;
+            }
+            catch (const std::exception&)
+            {
+            }
+            if (!validated)
+            {
+                request.reply(web::http::status_codes::BadRequest, "The webUrl did not answer the challenge.", "text/plain");
+                return;
+            }
+
+            std::string id;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                id = std::to_string(++m_webhookCount);
+                m_webhooks[id] = webhook;
+            }
+            web::http::http_response response(web::http::status_codes::Created);
+            response.headers().add(U("Location"), WebhooksUrl() + U("/") + utility::conversions::to_string_t(id));
+            request.reply(response);
+        });
+    }
+
+    // Sends the notifications when they are due. Deliveries are not retried, a lost one is left to the polling.
+    void Notify()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (!m_stopping)
+        {
+            if (m_notifications.empty())
+            {
+                m_notificationDue.wait(lock, [this]() { return m_stopping || !m_notifications.empty(); });
+                continue;
+            }
+            auto due = m_notifications.top().Due;
+            if (Clock::now() < due)
+            {
+                m_notificationDue.wait_until(lock, due, [this, due]() { return m_stopping || m_notifications.top().Due < due; });
+                continue;
+            }
+
+            auto id = m_notifications.top().TranscriptionId;
+            m_notifications.pop();
+            if (m_webhooks.empty())
+            {
+                continue;
+            }
+            std::uniform_real_distribution<double> chance(0, 1);
+            if (chance(m_random) < m_options.WebhookLossRate)
+            {
+                m_statistics.LostNotifications++;
+                continue;
+            }
+
+            nlohmann::json body = {
+                { "self", utility::conversions::to_utf8string(m_baseUrl) + "api/speechtotext/v3.0/transcriptions/" + id },
+                { "invocationId", std::to_string(m_statistics.Notifications) }
+            };
+            auto text = body.dump();
+            for (const auto& webhook : m_webhooks)
+            {
+                web::http::http_request request(web::http::methods::POST);
+                request.headers().add(U("X-MicrosoftSpeechServices-Event"), U("TranscriptionCompletion"));
+                if (!webhook.second.Secret.empty())
+                {
+                    request.headers().add(U("X-MicrosoftSpeechServices-Signature"),
+                        utility::conversions::to_string_t(ComputeWebhookSignature(text, webhook.second.Secret)));
+                }
+                request.set_body(text, "application/json");
+                m_statistics.Notifications++;
+                webhook.second.Client->request(request).then([](pplx::task<web::http::http_response> task)
+                {
+                    try
+                    {
+                        task.get();
+                    }
+                    catch (const std::exception&)
+                    {
+                    }
+                });
+            }
+        }
+    }
+
+    // Counts the requests in windows of one second.
+    bool IsThrottled()
+    {
+        if (m_options.RequestsPerSecond <= 0)
+        {
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto now = Clock::now();
+        if (now - m_windowStart >= std::chrono::seconds(1))
+        {
+            m_windowStart = now;
+            m_windowRequests = 0;
+        }
+        if (++m_windowRequests > m_options.RequestsPerSecond)
+        {
+            m_statistics.Throttled++;
+            return true;
+        }
+        return false;
+    }
+
+    // Answers a random fraction of the requests with 500, or 503 with Retry-After.
+    bool InjectError(const web::http::http_request& request)
+    {
+        if (m_options.ErrorRate <= 0)
+        {
+            return false;
+        }
+        bool unavailable;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            std::uniform_real_distribution<double> chance(0, 1);
+            if (chance(m_random) >= m_options.ErrorRate)
+            {
+                return false;
+            }
+            unavailable = chance(m_random) < 0.5;
+            m_statistics.InjectedErrors++;
+        }
+
+        web::http::http_response response(unavailable ? web::http::status_codes::ServiceUnavailable : web::http::status_codes::InternalError);
+        if (unavailable)
+        {
+            response.headers().add(U("Retry-After"), utility::conversions::to_string_t(std::to_string(m_options.RetryAfterSeconds)));
+        }
+        request.reply(response);
+        return true;
+    }
+
+    static std::chrono::milliseconds Scale(std::chrono::milliseconds delay, double factor)
+    {
+        return std::chrono::milliseconds(static_cast<int64_t>(delay.count() * factor));
+    }
+
+    utility::string_t m_baseUrl;
+    web::http::experimental::listener::http_listener m_listener;
+    Options m_options;
+    mutable std::mutex m_mutex;
+    std::mt19937 m_random;
+    Clock::time_point m_windowStart;
+    size_t m_windowRequests = 0;
+    std::map<std::string, Transcription> m_transcriptions;
+    std::vector<std::shared_ptr<const std::string>> m_results;
+    std::map<std::string, Webhook> m_webhooks;
+    size_t m_webhookCount = 0;
+    std::priority_queue<Notification, std::vector<Notification>, std::greater<Notification>> m_notifications;
+    std::condition_variable m_notificationDue;
+    bool m_stopping = false;
+    std::thread m_notifier;
+    Statistics m_statistics;
+};
@@ -0,0 +1,223 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "json_cursor.h"
+
+// A contiguous, read-only range of elements owned by a ResultDocument.
+template<class T>
+class ResultRange
+{
+public:
+    ResultRange() = default;
+    ResultRange(const T* first, size_t size) : m_first(first), m_size(size) {}
+
+    const T* begin() const { return m_first; }
+    const T* end() const { return m_first + m_size; }
+    size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+    const T& front() const { return m_first[0]; }
+    const T& operator[](size_t index) const { return m_first[index]; }
+
+private:
+    const T* m_first = nullptr;
+    size_t m_size = 0;
+};
+
+// Views of the batch transcription result (v2 API). The strings point into the body kept by the ResultDocument
+// and are only valid as long as it lives.
+struct ResultTextView
+{
+    std::string_view Lexical;
+    std::string_view ITN;
+    std::string_view MaskedITN;
+    std::string_view Display;
+};
+
+struct NBestView : ResultTextView
+{
+    double Confidence = 0;
+};
+
+struct SegmentResultView
+{
+    std::string_view RecognitionStatus;
+    uint64_t Offset = 0;     // in ticks of 100 nanoseconds.
+    uint64_t Duration = 0;
+    ResultRange<NBestView> NBest;
+};
+
+struct AudioFileResultView
+{
+    std::string_view AudioFileName;
+    ResultRange<SegmentResultView> SegmentResults;
+    ResultRange<ResultTextView> CombinedResults;
+};
+
+// A batch transcription result parsed in place. The document keeps the response body, unescapes strings within it
+// and stores all elements of a kind in one vector, so parsing allocates a handful of times instead of once per string
+// and list node, and iterating the results copies nothing.
+class ResultDocument
+{
+public:
+    ResultDocument() = default;
+    ResultDocument(const ResultDocument&) = delete;
+    ResultDocument& operator=(const ResultDocument&) = delete;
+
+    // Parses the body, which the document takes over. Returns false if it is malformed, then Error() tells why.
+    bool Parse(std::string body)
+    {
+        m_body = std::move(body);
+        m_audioFiles.clear();
+        m_segments.clear();
+        m_nbests.clear();
+        m_combined.clear();
+        m_cursor = JsonCursor(&m_body[0], &m_body[0] + m_body.size());
+
+        // Rough estimates from the size of typical segments, to avoid most reallocations.
+        m_segments.reserve(m_body.size() / 2048 + 1);
+        m_nbests.reserve(m_body.size() / 512 + 1);
+
+        bool parsed = m_cursor.ParseObject([this](std::string_view key)
+        {
+            if (key == "AudioFileResults")
+            {
+                return m_cursor.ParseArray([this]() { return ParseAudioFile(); });
+            }
+            return m_cursor.SkipValue();
+        }) && m_cursor.ExpectEnd();
+        if (!parsed)
+        {
+            m_audioFiles.clear();
+            return false;
+        }
+
+        // The children of every element are stored consecutively in document order, which gives their ranges now
+        // that the vectors will not move anymore.
+        size_t segment = 0, nbest = 0, combined = 0;
+        for (auto& audioFile : m_audioFiles)
+        {
+            audioFile.SegmentResults = ResultRange<SegmentResultView>(m_segments.data() + segment, audioFile.SegmentResults.size());
+            audioFile.CombinedResults = ResultRange<ResultTextView>(m_combined.data() + combined, audioFile.CombinedResults.size());
+            segment += audioFile.SegmentResults.size();
+            combined += audioFile.CombinedResults.size();
+        }
+        for (auto& segmentResult : m_segments)
+        {
+            segmentResult.NBest = ResultRange<NBestView>(m_nbests.data() + nbest, segmentResult.NBest.size());
+            nbest += segmentResult.NBest.size();
+        }
+        return true;
+    }
+
+    ResultRange<AudioFileResultView> AudioFileResults() const
+    {
+        return ResultRange<AudioFileResultView>(m_audioFiles.data(), m_audioFiles.size());
+    }
+
+    const std::string& Error() const { return m_cursor.Error(); }
+
+private:
+    bool ParseAudioFile()
+    {
+        AudioFileResultView audioFile;
+        auto firstSegment = m_segments.size();
+        auto firstCombined = m_combined.size();
+        bool parsed = m_cursor.ParseObject([this, &audioFile](std::string_view key)
+        {
+            if (key == "AudioFileName")
+            {
+                return m_cursor.ParseString(&audioFile.AudioFileName);
+            }
+            if (key == "SegmentResults")
+            {
+                return m_cursor.ParseArray([this]() { return ParseSegment(); });
+            }
+            if (key == "CombinedResults")
+            {
+                return m_cursor.ParseArray([this]()
+                {
+                    m_combined.emplace_back();
+                    return ParseText(&m_combined.back());
+                });
+            }
+            return m_cursor.SkipValue();
+        });
+        // Only the sizes are known until parsing completed.
+        audioFile.SegmentResults = ResultRange<SegmentResultView>(nullptr, m_segments.size() - firstSegment);
+        audioFile.CombinedResults = ResultRange<ResultTextView>(nullptr, m_combined.size() - firstCombined);
+        m_audioFiles.push_back(audioFile);
+        return parsed;
+    }
+
+    bool ParseSegment()
+    {
+        SegmentResultView segment;
+        auto firstNBest = m_nbests.size();
+        bool parsed = m_cursor.ParseObject([this, &segment](std::string_view key)
+        {
+            if (key == "RecognitionStatus")
+            {
+                return m_cursor.ParseString(&segment.RecognitionStatus);
+            }
+            if (key == "Offset")
+            {
+                return m_cursor.ParseUnsigned(&segment.Offset);
+            }
+            if (key == "Duration")
+            {
+                return m_cursor.ParseUnsigned(&segment.Duration);
+            }
+            if (key == "NBest")
+            {
+                return m_cursor.ParseArray([this]()
+                {
+                    m_nbests.emplace_back();
+                    return ParseText(&m_nbests.back());
+                });
+            }
+            return m_cursor.SkipValue();
+        });
+        segment.NBest = ResultRange<NBestView>(nullptr, m_nbests.size() - firstNBest);
+        m_segments.push_back(segment);
+        return parsed;
+    }
+
+    // Parses a combined result, or an NBest entry with its confidence.
+    template<class Text>
+    bool ParseText(Text* text)
+    {
+        return m_cursor.ParseObject([this, text](std::string_view key)
+        {
+            if (key == "Lexical") return m_cursor.ParseString(&text->Lexical);
+            if (key == "ITN") return m_cursor.ParseString(&text->ITN);
+            if (key == "MaskedITN") return m_cursor.ParseString(&text->MaskedITN);
+            if (key == "Display") return m_cursor.ParseString(&text->Display);
+            return ParseConfidence(text, key);
+        });
+    }
+
+    bool ParseConfidence(NBestView* nbest, std::string_view key)
+    {
+        return key == "Confidence" ? m_cursor.ParseDouble(&nbest->Confidence) : m_cursor.SkipValue();
+    }
+
+    bool ParseConfidence(ResultTextView*, std::string_view)
+    {
+        return m_cursor.SkipValue();
+    }
+
+    std::string m_body;
+    std::vector<AudioFileResultView> m_audioFiles;
+    std::vector<SegmentResultView> m_segments;
+    std::vector<NBestView> m_nbests;
+    std::vector<ResultTextView> m_combined;
+    JsonCursor m_cursor;
+};
@@ -0,0 +1,343 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <cpprest/http_client.h>
+
+#include "streaming_result_parser.h"
+#include "transcription_result.h"
+#include "transcription_result_v3.h"
+
+// A segment of the merged timeline of all channels.
+struct TimelineSegment
+{
+    std::string Channel;        // key of the channel in resultsUrls, e.g. "channel_1".
+    std::string AudioFileName;
+    SegmentResult Segment;
+};
+
+// Fetches the results of all channels of a transcription, e.g. both sides of a stereo call recording, and merges
+// them into one timeline ordered by offset while they download.
+//
+// Every channel is downloaded on its own thread and parsed while it downloads, so the wall time is that of the
+// largest channel rather than the sum of all. Each thread hands its segments to the caller's thread through a small
+// bounded queue, where a k-way merge on the heads of the queues picks the segment with the smallest offset, with
+// log(channels) comparisons per segment. A channel that gets ahead of the others waits until the merge catches up,
+// so at most QueueCapacity segments per channel are held in memory however large the results are. The merge relies
+// on the service writing the segments of a channel in offset order; a segment out of order is emitted late.
+//
+// Results in the v2 format (AudioFileResults) are parsed while they download. Results in the v3 format
+// (recognizedPhrases) are parsed by the generated TranscriptionResultParser once downloaded, and their phrases are
+// converted to segments.
+class ResultFetcher
+{
+public:
+    struct ChannelStatistics
+    {
+        std::string Channel;
+        size_t Segments = 0;
+        double Seconds = 0;
+        std::string Error;      // empty if the channel was fetched and parsed.
+    };
+
+    // Called on the thread of Fetch with every segment of the merged timeline.
+    using SegmentHandler = std::function<void(TimelineSegment& segment)>;
+
+    static constexpr size_t QueueCapacity = 256;
+
+    explicit ResultFetcher(const utility::string_t& subscriptionKey) : m_subscriptionKey(subscriptionKey) {}
+
+    // Fetches every channel of resultsUrls. Returns false if any channel failed, Channels() tells which; the
+    // segments handed to onSegment until then are not taken back.
+    bool Fetch(const std::map<std::string, std::string>& resultsUrls, const SegmentHandler& onSegment)
+    {
+        auto start = std::chrono::steady_clock::now();
+        std::vector<ChannelQueue> queues(resultsUrls.size());
+        m_channels.assign(resultsUrls.size(), ChannelStatistics());
+
+        std::vector<std::thread> downloads;
+        size_t index = 0;
+        for (const auto& channel : resultsUrls)
+        {
+            m_channels[index].Channel = channel.first;
+            downloads.emplace_back(&ResultFetcher::FetchChannel, this, channel.second, &queues[index], &m_channels[index]);
+            index++;
+        }
+        try
+        {
+            Merge(queues, onSegment);
+        }
+        catch (...)
+        {
+            // The downloads must not wait for a merge that is gone.
+            for (auto& queue : queues)
+            {
+                std::lock_guard<std::mutex> lock(queue.Mutex);
+                queue.Abandoned = true;
+                queue.Changed.notify_all();
+            }
+            for (auto& download : downloads)
+            {
+                download.join();
+            }
+            throw;
+        }
+        for (auto& download : downloads)
+        {
+            download.join();
+        }
+        m_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return std::all_of(m_channels.begin(), m_channels.end(), [](const ChannelStatistics& channel) { return channel.Error.empty(); });
+    }
+
+    const std::vector<ChannelStatistics>& Channels() const { return m_channels; }
+
+    // Wall time of the last Fetch, including the handling of the segments.
+    double Seconds() const { return m_seconds; }
+
+private:
+    // Segments of one channel on their way from its download thread to the merge.
+    struct ChannelQueue
+    {
+        std::mutex Mutex;
+        std::condition_variable Changed;
+        std::deque<TimelineSegment> Segments;
+        bool Done = false;          // the download thread has put its last segment.
+        bool Abandoned = false;     // the merge stopped, segments are dropped.
+    };
+
+    // Hands the segments of all channels to onSegment by offset, as soon as every channel that has not ended has a
+    // segment queued. Segments with equal offsets keep the order of the channels.
+    static void Merge(std::vector<ChannelQueue>& queues, const SegmentHandler& onSegment)
+    {
+        struct Head
+        {
+            uint64_t Offset;
+            size_t Channel;
+
+            bool operator>(const Head& other) const
+            {
+                return Offset != other.Offset ? Offset > other.Offset : Channel > other.Channel;
+            }
+        };
+
+        std::priority_queue<Head, std::vector<Head>, std::greater<Head>> heads;
+        // Waits for the next segment of a channel, and puts it among the heads unless the channel ended.
+        auto pushHead = [&queues, &heads](size_t channel)
+        {
+            auto& queue = queues[channel];
+            std::unique_lock<std::mutex> lock(queue.Mutex);
+            queue.Changed.wait(lock, [&queue]() { return !queue.Segments.empty() || queue.Done; });
+            if (!queue.Segments.empty())
+            {
+                heads.push(Head{ queue.Segments.front().Segment.Offset, channel });
+            }
+        };
+
+        for (size_t channel = 0; channel < queues.size(); channel++)
+        {
+            pushHead(channel);
+        }
+        while (!heads.empty())
+        {
+            auto head = heads.top();
+            heads.pop();
+            auto& queue = queues[head.Channel];
+            TimelineSegment segment;
+            {
+                std::lock_guard<std::mutex> lock(queue.Mutex);
+                segment = std::move(queue.Segments.front());
+                queue.Segments.pop_front();
+                queue.Changed.notify_all();
+            }
+            onSegment(segment);
+            pushHead(head.Channel);
+        }
+    }
+
+    // Downloads and parses a channel, retrying server errors and failed connections a few times. A retry skips the
+    // segments that were queued by the attempts before.
+    void FetchChannel(const std::string& url, ChannelQueue* queue, ChannelStatistics* statistics)
+    {
+        auto start = std::chrono::steady_clock::now();
+        size_t queued = 0;
+        const int maxAttempts = 4;
+        for (int attempt = 1; attempt <= maxAttempts; attempt++)
+        {
+            statistics->Error.clear();
+            bool retry = false;
+            size_t parsed = 0;
+            auto enqueue = [queue, statistics, &queued, &parsed](const std::string& audioFileName, SegmentResult& segment)
+            {
+                if (parsed++ < queued)
+                {
+                    return;
+                }
+                std::unique_lock<std::mutex> lock(queue->Mutex);
+                queue->Changed.wait(lock, [queue]() { return queue->Segments.size() < QueueCapacity || queue->Abandoned; });
+                if (!queue->Abandoned)
+                {
+                    queue->Segments.push_back(TimelineSegment{ statistics->Channel, audioFileName, std::move(segment) });
+                    queue->Changed.notify_all();
+                }
+                queued++;
+            };
+
+            try
+            {
+                web::uri location(utility::conversions::to_string_t(url));
+                web::http::client::http_client client(location.authority());
+                web::http::http_request request(web::http::methods::GET);
+                request.set_request_uri(location.resource());
+                request.headers().add(U("Ocp-Apim-Subscription-Key"), m_subscriptionKey);
+
+                auto response = client.request(request).get();
+                if (response.status_code() != web::http::status_codes::OK)
+                {
+                    statistics->Error = "Unexpected http code " + std::to_string(response.status_code());
+                    retry = response.status_code() >= 500 || response.status_code() == web::http::status_codes::TooManyRequests;
+                }
+                else
+                {
+                    StreamingResultParser parser(enqueue);
+
+                    // The start of the body is kept until it tells the format, since a read may return only a few bytes.
+                    auto body = response.body().streambuf();
+                    std::vector<char> chunk(64 * 1024);
+                    std::string document;
+                    size_t read;
+                    bool detected = false, streaming = false, wellFormed = true;
+                    while (wellFormed && !IsAbandoned(queue) && (read = body.getn(reinterpret_cast<uint8_t*>(chunk.data()), chunk.size()).get()) > 0)
+                    {
+                        if (streaming)
+                        {
+                            wellFormed = parser.Feed(chunk.data(), read);
+                            continue;
+                        }
+                        document.append(chunk.data(), read);
+                        if (!detected && (detected = DetectFormat(&document, &streaming)) && streaming)
+                        {
+                            wellFormed = parser.Feed(document.data(), document.size());
+                            document.clear();
+                        }
+                    }
+
+                    if (IsAbandoned(queue))
+                    {
+                        statistics->Error = "Abandoned.";
+                    }
+                    else if (!streaming)
+                    {
+                        ParseV3Result(document, enqueue, statistics);
+                    }
+                    else if (!parser.Finish())
+                    {
+                        statistics->Error = "Malformed result: " + parser.Error();
+                    }
+                }
+            }
+            catch (const std::exception& e)
+            {
+                statistics->Error = e.what();
+                retry = true;
+            }
+
+            if (!retry || attempt == maxAttempts || IsAbandoned(queue))
+            {
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(500 << attempt));
+        }
+        statistics->Segments = queued;
+        statistics->Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        std::lock_guard<std::mutex> lock(queue->Mutex);
+        queue->Done = true;
+        queue->Changed.notify_all();
+    }
+
+    static bool IsAbandoned(ChannelQueue* queue)
+    {
+        std::lock_guard<std::mutex> lock(queue->Mutex);
+        return queue->Abandoned;
+    }
+
+    // Tells from the start of a result whether it is in the v2 format, where the service writes AudioFileResults
+    // first, which it never writes in v3 results. Returns false while the start could still be either, and removes a
+    // byte order mark, which neither parser expects.
+    static bool DetectFormat(std::string* start, bool* v2)
+    {
+        const std::string_view byteOrderMark = "\xEF\xBB\xBF";
+        const std::string_view v2Key = "\"AudioFileResults\"";
+        if (byteOrderMark.compare(0, std::min(start->size(), byteOrderMark.size()), *start, 0, byteOrderMark.size()) == 0)
+        {
+            if (start->size() < byteOrderMark.size())
+            {
+                return false;
+            }
+            start->erase(0, byteOrderMark.size());
+        }
+
+        auto key = start->find_first_not_of(" \t\r\n{");
+        if (key == std::string::npos)
+        {
+            return false;
+        }
+        auto available = std::min(start->size() - key, v2Key.size());
+        if (start->compare(key, available, v2Key, 0, available) == 0 && available < v2Key.size())
+        {
+            return false;
+        }
+        *v2 = available == v2Key.size() && start->compare(key, available, v2Key) == 0;
+        return true;
+    }
+
+    void ParseV3Result(std::string& document, const StreamingResultParser::SegmentHandler& onSegment, ChannelStatistics* statistics)
+    {
+        TranscriptionResult result;
+        TranscriptionResultParser parser;
+        if (!parser.Parse(document, &result))
+        {
+            statistics->Error = "Malformed result: " + parser.Error();
+            return;
+        }
+
+        for (auto& phrase : result.RecognizedPhrases)
+        {
+            SegmentResult segment;
+            segment.RecognitionStatus = std::move(phrase.RecognitionStatus);
+            segment.Offset = phrase.OffsetInTicks;
+            segment.Duration = phrase.DurationInTicks;
+            for (auto& entry : phrase.NBest)
+            {
+                NBest nbest;
+                nbest.Confidence = entry.Confidence;
+                nbest.Lexical = std::move(entry.Lexical);
+                nbest.ITN = std::move(entry.ITN);
+                nbest.MaskedITN = std::move(entry.MaskedITN);
+                nbest.Display = std::move(entry.Display);
+                segment.NBest.push_back(std::move(nbest));
+            }
+            onSegment(result.Source, segment);
+        }
+    }
+
+    utility::string_t m_subscriptionKey;
+    std::vector<ChannelStatistics> m_channels;
+    double m_seconds = 0;
+};
@@ -0,0 +1,428 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "transcription_result.h"
+
+// An incremental JSON tokenizer. The document is fed in chunks of any size, e.g. as they arrive from the network,
+// and the handler is called for every token. Tokens split across chunks are reassembled, so memory use is bounded
+// by the longest string or number, not by the document.
+//
+// The handler implements StartObject(), EndObject(), StartArray(), EndArray(), Key(const std::string&),
+// String(const std::string&), Number(const std::string&) with the number's text, Boolean(bool) and Null().
+template<class Handler>
+class JsonPushParser
+{
+public:
+    explicit JsonPushParser(Handler& handler) : m_handler(handler) {}
+
+    // Parses the next chunk. Returns false on malformed JSON, then Error() tells why.
+    bool Feed(const char* data, size_t size)
+    {
+        for (size_t i = 0; i < size && m_error.empty(); i++)
+        {
+            Next(data[i]);
+        }
+        return m_error.empty();
+    }
+
+    // Completes the document. Returns false if it is incomplete or malformed.
+    bool Finish()
+    {
+        if (m_state == State::Number || m_state == State::Literal)
+        {
+            EndScalar();
+        }
+        if (m_error.empty() && (!m_containers.empty() || !m_hasRoot))
+        {
+            m_error = "Unexpected end of the document.";
+        }
+        return m_error.empty();
+    }
+
+    const std::string& Error() const { return m_error; }
+    uint64_t Position() const { return m_position; }
+
+private:
+    enum class State { Value, String, Escape, Unicode, Number, Literal };
+
+    void Next(char c)
+    {
+        m_position++;
+        switch (m_state)
+        {
+        case State::String:
+            if (c == '"')
+            {
+                m_state = State::Value;
+                EndString();
+            }
+            else if (c == '\\')
+            {
+                m_state = State::Escape;
+            }
+            else
+            {
+                m_token += c;
+            }
+            return;
+
+        case State::Escape:
+            m_state = State::String;
+            switch (c)
+            {
+            case 'b': m_token += '\b'; break;
+            case 'f': m_token += '\f'; break;
+            case 'n': m_token += '\n'; break;
+            case 'r': m_token += '\r'; break;
+            case 't': m_token += '\t'; break;
+            case 'u': m_state = State::Unicode; m_unicodeDigits = 0; m_codeUnit = 0; break;
+            default: m_token += c; break;   // '"', '\\' and '/'
+            }
+            return;
+
+        case State::Unicode:
+            m_codeUnit = m_codeUnit * 16 + HexValue(c);
+            if (++m_unicodeDigits == 4)
+            {
+                m_state = State::String;
+                AppendCodeUnit(m_codeUnit);
+            }
+            return;
+
+        case State::Number:
+        case State::Literal:
+            if ((c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || c == '.' || c == '-' || c == '+' || c == 'E')
+            {
+                m_token += c;
+                return;
+            }
+            EndScalar();
+            if (!m_error.empty())
+            {
+                return;
+            }
+            break;  // the character after the scalar is structural or whitespace.
+
+        case State::Value:
+            break;
+        }
+
+        switch (c)
+        {
+        case ' ': case '\t': case '\r': case '\n':
+            return;
+        case '{':
+            BeginValue();
+            m_containers.push_back(true);
+            m_expectKey = true;
+            m_handler.StartObject();
+            return;
+        case '[':
+            BeginValue();
+            m_containers.push_back(false);
+            m_handler.StartArray();
+            return;
+        case '}':
+        case ']':
+            if (m_containers.empty() || m_containers.back() != (c == '}'))
+            {
+                m_error = "Unbalanced brackets.";
+                return;
+            }
+            m_containers.pop_back();
+            m_expectKey = false;
+            if (c == '}')
+            {
+                m_handler.EndObject();
+            }
+            else
+            {
+                m_handler.EndArray();
+            }
+            return;
+        case ',':
+            m_expectKey = !m_containers.empty() && m_containers.back();
+            return;
+        case ':':
+            return;
+        case '"':
+            m_isKey = m_expectKey;
+            if (!m_isKey)
+            {
+                BeginValue();
+            }
+            m_expectKey = false;
+            m_token.clear();
+            m_state = State::String;
+            return;
+        default:
+            BeginValue();
+            m_token.assign(1, c);
+            m_state = (c == '-' || (c >= '0' && c <= '9')) ? State::Number : State::Literal;
+            return;
+        }
+    }
+
+    void BeginValue()
+    {
+        if (m_containers.empty())
+        {
+            if (m_hasRoot)
+            {
+                m_error = "Unexpected data after the document.";
+            }
+            m_hasRoot = true;
+        }
+    }
+
+    void EndString()
+    {
+        if (m_isKey)
+        {
+            m_handler.Key(m_token);
+        }
+        else
+        {
+            m_handler.String(m_token);
+        }
+    }
+
+    void EndScalar()
+    {
+        m_state = State::Value;
+        if (m_token == "true" || m_token == "false")
+        {
+            m_handler.Boolean(m_token == "true");
+        }
+        else if (m_token == "null")
+        {
+            m_handler.Null();
+        }
+        else if (m_token[0] == '-' || (m_token[0] >= '0' && m_token[0] <= '9'))
+        {
+            m_handler.Number(m_token);
+        }
+        else
+        {
+            m_error = "Invalid literal '" + m_token + "'.";
+        }
+    }
+
+    static uint32_t HexValue(char c)
+    {
+        return c <= '9' ? c - '0' : (c | 0x20) - 'a' + 10;
+    }
+
+    // Appends a UTF-16 code unit as UTF-8, combining surrogate pairs.
+    void AppendCodeUnit(uint32_t unit)
+    {
+        if (unit >= 0xd800 && unit <= 0xdbff)
+        {
+            m_highSurrogate = unit;
+            return;
+        }
+        uint32_t codePoint = unit;
+        if (unit >= 0xdc00 && unit <= 0xdfff && m_highSurrogate != 0)
+        {
+            codePoint = 0x10000 + ((m_highSurrogate - 0xd800) << 10) + (unit - 0xdc00);
+        }
+        m_highSurrogate = 0;
+
+        if (codePoint < 0x80)
+        {
+            m_token += static_cast<char>(codePoint);
+        }
+        else if (codePoint < 0x800)
+        {
+            m_token += static_cast<char>(0xc0 | (codePoint >> 6));
+            m_token += static_cast<char>(0x80 | (codePoint & 0x3f));
+        }
+        else if (codePoint < 0x10000)
+        {
+            m_token += static_cast<char>(0xe0 | (codePoint >> 12));
+            m_token += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3f));
+            m_token += static_cast<char>(0x80 | (codePoint & 0x3f));
+        }
+        else
+        {
+            m_token += static_cast<char>(0xf0 | (codePoint >> 18));
+            m_token += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3f));
+            m_token += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3f));
+            m_token += static_cast<char>(0x80 | (codePoint & 0x3f));
+        }
+    }
+
+    Handler& m_handler;
+    State m_state = State::Value;
+    std::vector<bool> m_containers;     // true for objects, false for arrays.
+    std::string m_token;
+    bool m_expectKey = false;
+    bool m_isKey = false;
+    bool m_hasRoot = false;
+    uint32_t m_unicodeDigits = 0;
+    uint32_t m_codeUnit = 0;
+    uint32_t m_highSurrogate = 0;
+    uint64_t m_position = 0;
+    std::string m_error;
+};
+
+// Parses a batch transcription result while it is downloaded, handing every segment to a callback as soon as
+// it is complete instead of building the whole document. Only the current segment is held in memory.
+// Fields not in the result model are skipped. Segments are reported with the AudioFileName that precedes them
+// in the document, which is where the service writes it.
+class StreamingResultParser
+{
+public:
+    using SegmentHandler = std::function<void(const std::string& audioFileName, SegmentResult& segment)>;
+    using CombinedResultHandler = std::function<void(const std::string& audioFileName, Result& result)>;
+
+    explicit StreamingResultParser(SegmentHandler onSegment, CombinedResultHandler onCombinedResult = nullptr) :
+        m_onSegment(std::move(onSegment)),
+        m_onCombinedResult(std::move(onCombinedResult)),
+        m_parser(*this)
+    {
+    }
+
+    bool Feed(const char* data, size_t size) { return m_parser.Feed(data, size); }
+    bool Finish() { return m_parser.Finish(); }
+    const std::string& Error() const { return m_parser.Error(); }
+    uint64_t SegmentCount() const { return m_segmentCount; }
+
+    // Tokenizer callbacks.
+    void StartObject() { Push(true); }
+    void StartArray() { Push(false); }
+    void Key(const std::string& key) { m_key = key; }
+    void Boolean(bool) {}
+    void Null() {}
+
+    void EndObject()
+    {
+        switch (m_contexts.back())
+        {
+        case Context::Segment:
+            m_segmentCount++;
+            m_onSegment(m_audioFileName, m_segment);
+            m_segment = SegmentResult();
+            break;
+        case Context::NBest:
+            m_segment.NBest.push_back(std::move(m_nbest));
+            m_nbest = NBest();
+            break;
+        case Context::Combined:
+            if (m_onCombinedResult)
+            {
+                m_onCombinedResult(m_audioFileName, m_combined);
+            }
+            m_combined = Result();
+            break;
+        default:
+            break;
+        }
+        m_contexts.pop_back();
+    }
+
+    void EndArray()
+    {
+        m_contexts.pop_back();
+    }
+
+    void String(const std::string& value)
+    {
+        switch (m_contexts.back())
+        {
+        case Context::AudioFile:
+            if (m_key == "AudioFileName")
+            {
+                m_audioFileName = value;
+            }
+            break;
+        case Context::Segment:
+            if (m_key == "RecognitionStatus")
+            {
+                m_segment.RecognitionStatus = value;
+            }
+            break;
+        case Context::NBest:
+            SetText(m_nbest, value);
+            break;
+        case Context::Combined:
+            SetText(m_combined, value);
+            break;
+        default:
+            break;
+        }
+    }
+
+    void Number(const std::string& text)
+    {
+        if (m_contexts.back() == Context::Segment)
+        {
+            if (m_key == "Offset")
+            {
+                m_segment.Offset = std::strtoull(text.c_str(), nullptr, 10);
+            }
+            else if (m_key == "Duration")
+            {
+                m_segment.Duration = std::strtoull(text.c_str(), nullptr, 10);
+            }
+        }
+        else if (m_contexts.back() == Context::NBest && m_key == "Confidence")
+        {
+            m_nbest.Confidence = std::strtod(text.c_str(), nullptr);
+        }
+    }
+
+private:
+    // Where in the result model the current object or array is.
+    enum class Context { Root, AudioFiles, AudioFile, Segments, Segment, NBests, NBest, CombinedResults, Combined, Skip };
+
+    void Push(bool isObject)
+    {
+        auto context = Context::Skip;
+        if (m_contexts.empty())
+        {
+            context = isObject ? Context::Root : Context::Skip;
+        }
+        else
+        {
+            auto parent = m_contexts.back();
+            if (parent == Context::Root && !isObject && m_key == "AudioFileResults") context = Context::AudioFiles;
+            else if (parent == Context::AudioFiles && isObject) context = Context::AudioFile;
+            else if (parent == Context::AudioFile && !isObject && m_key == "SegmentResults") context = Context::Segments;
+            else if (parent == Context::AudioFile && !isObject && m_key == "CombinedResults") context = Context::CombinedResults;
+            else if (parent == Context::Segments && isObject) context = Context::Segment;
+            else if (parent == Context::Segment && !isObject && m_key == "NBest") context = Context::NBests;
+            else if (parent == Context::NBests && isObject) context = Context::NBest;
+            else if (parent == Context::CombinedResults && isObject) context = Context::Combined;
+        }
+        m_contexts.push_back(context);
+    }
+
+    void SetText(Result& result, const std::string& value)
+    {
+        if (m_key == "Lexical") result.Lexical = value;
+        else if (m_key == "ITN") result.ITN = value;
+        else if (m_key == "MaskedITN") result.MaskedITN = value;
+        else if (m_key == "Display") result.Display = value;
+    }
+
+    SegmentHandler m_onSegment;
+    CombinedResultHandler m_onCombinedResult;
+    JsonPushParser<StreamingResultParser> m_parser;
+    std::vector<Context> m_contexts;
+    std::string m_key;
+    std::string m_audioFileName;
+    SegmentResult m_segment;
+    NBest m_nbest;
+    Result m_combined;
+    uint64_t m_segmentCount = 0;
+};
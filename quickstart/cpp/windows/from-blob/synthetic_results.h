@@ -0,0 +1,209 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+// A generated phrase with word level timestamps, in ticks of 100 nanoseconds.
+struct SyntheticPhrase
+{
+    std::string Text;
+    uint64_t Offset;
+    uint64_t Duration;
+    std::vector<std::pair<std::string, uint64_t>> Words;    // word and its offset, each word lasts WordDuration.
+
+    static const uint64_t WordDuration = 3000000;
+};
+
+// Generates phrases of random words with plausible timing. The phrases of different channels get different words
+// and start at different offsets, so the channels of a conversation interleave.
+inline std::vector<SyntheticPhrase> GenerateSyntheticPhrases(size_t phraseCount, size_t channel = 0)
+{
+    static const char* const words[] = { "the", "speech", "service", "transcribes", "audio", "files", "in", "batches",
+        "of", "many", "hours", "and", "returns", "one", "result", "per", "channel", "with", "timestamps", "for", "every", "word" };
+    std::mt19937 random(static_cast<unsigned>(channel + 1));
+    std::uniform_int_distribution<size_t> wordIndex(0, sizeof(words) / sizeof(words[0]) - 1);
+    std::uniform_int_distribution<size_t> wordCount(5, 25);
+
+    std::vector<SyntheticPhrase> phrases(phraseCount);
+    uint64_t offset = channel * 25000000;
+    for (auto& phrase : phrases)
+    {
+        phrase.Offset = offset;
+        auto count = wordCount(random);
+        for (size_t i = 0; i < count; i++)
+        {
+            std::string word = words[wordIndex(random)];
+            phrase.Text += (i > 0 ? " " : "") + word;
+            phrase.Words.emplace_back(word, offset);
+            offset += 3500000;
+        }
+        phrase.Duration = offset - phrase.Offset;
+        offset += 5000000;
+    }
+    return phrases;
+}
+
+// Generates phrases of pseudo words whose frequencies follow Zipf's law like natural language, where a few words
+// are very common and most are rare, to benchmark search over many transcriptions.
+class SyntheticCorpus
+{
+public:
+    SyntheticCorpus(size_t vocabularySize, unsigned seed = 1) : m_random(seed)
+    {
+        static const char* const syllables[] = { "ka", "lo", "mi", "ne", "ru", "sa", "to", "vi", "ber", "dan", "gor", "hel",
+            "jun", "pol", "tri", "wes" };
+        const size_t syllableCount = sizeof(syllables) / sizeof(syllables[0]);
+        std::vector<double> weights(vocabularySize);
+        for (size_t rank = 0; rank < vocabularySize; rank++)
+        {
+            std::string word;
+            for (size_t n = rank + 1; n > 0; n /= syllableCount)
+            {
+                word += syllables[n % syllableCount];
+            }
+            m_words.push_back(word);
+            weights[rank] = 1.0 / (rank + 1);
+        }
+        m_rank = std::discrete_distribution<size_t>(weights.begin(), weights.end());
+    }
+
+    // The word of the given frequency rank, 0 being the most frequent.
+    const std::string& Word(size_t rank) const { return m_words[rank]; }
+
+    // Generates the phrases of a conversation, with their offsets in ticks.
+    std::vector<SyntheticPhrase> GeneratePhrases(size_t phraseCount)
+    {
+        std::uniform_int_distribution<size_t> wordCount(5, 25);
+        std::vector<SyntheticPhrase> phrases(phraseCount);
+        uint64_t offset = 0;
+        for (auto& phrase : phrases)
+        {
+            phrase.Offset = offset;
+            auto count = wordCount(m_random);
+            for (size_t i = 0; i < count; i++)
+            {
+                const auto& word = m_words[m_rank(m_random)];
+                phrase.Text += (i > 0 ? " " : "") + word;
+                phrase.Words.emplace_back(word, offset);
+                offset += 3500000;
+            }
+            phrase.Duration = offset - phrase.Offset;
+            offset += 5000000;
+        }
+        return phrases;
+    }
+
+private:
+    std::vector<std::string> m_words;
+    std::discrete_distribution<size_t> m_rank;
+    std::mt19937 m_random;
+};
+
+// Formats ticks as ISO 8601 duration, e.g. PT1M23.45S.
+inline std::string FormatTicksAsDuration(uint64_t ticks)
+{
+    auto hundredths = ticks / 100000;
+    auto minutes = hundredths / 6000;
+    char text[64];
+    if (minutes >= 60)
+    {
+        snprintf(text, sizeof(text), "PT%lluH%lluM%llu.%02lluS", (unsigned long long)(minutes / 60), (unsigned long long)(minutes % 60),
+            (unsigned long long)(hundredths % 6000 / 100), (unsigned long long)(hundredths % 100));
+    }
+    else if (minutes > 0)
+    {
+        snprintf(text, sizeof(text), "PT%lluM%llu.%02lluS", (unsigned long long)minutes, (unsigned long long)(hundredths % 6000 / 100),
+            (unsigned long long)(hundredths % 100));
+    }
+    else
+    {
+        snprintf(text, sizeof(text), "PT%llu.%02lluS", (unsigned long long)(hundredths / 100), (unsigned long long)(hundredths % 100));
+    }
+    return text;
+}
+
+// Generates a batch transcription result (v2 API) with the given number of segments, shaped like the service's
+// output with word level timestamps, to measure result parsing without a transcription.
+inline std::string GenerateSyntheticResult(size_t segmentCount, size_t nbestCount = 3, size_t channel = 0)
+{
+    std::string json = "{\"AudioFileResults\":[{\"AudioFileName\":\"Channel." + std::to_string(channel)
+        + ".wav\",\"AudioFileUrl\":null,\"SegmentResults\":[";
+    std::string combined;
+    auto phrases = GenerateSyntheticPhrases(segmentCount, channel);
+    for (size_t segment = 0; segment < phrases.size(); segment++)
+    {
+        const auto& phrase = phrases[segment];
+        std::string wordsJson;
+        for (size_t i = 0; i < phrase.Words.size(); i++)
+        {
+            wordsJson += std::string(i > 0 ? "," : "") + "{\"Word\":\"" + phrase.Words[i].first + "\",\"Offset\":"
+                + std::to_string(phrase.Words[i].second) + ",\"Duration\":" + std::to_string(SyntheticPhrase::WordDuration)
+                + ",\"Confidence\":0.9}";
+        }
+
+        json += std::string(segment > 0 ? "," : "") + "{\"RecognitionStatus\":\"Success\",\"ChannelNumber\":null,"
+            "\"Offset\":" + std::to_string(phrase.Offset) + ",\"Duration\":" + std::to_string(phrase.Duration) + ",\"NBest\":[";
+        for (size_t n = 0; n < nbestCount; n++)
+        {
+            json += std::string(n > 0 ? "," : "") + "{\"Confidence\":" + std::to_string(0.95 - n * 0.1)
+                + ",\"Lexical\":\"" + phrase.Text + "\",\"ITN\":\"" + phrase.Text + "\",\"MaskedITN\":\"" + phrase.Text
+                + "\",\"Display\":\"" + phrase.Text + ".\",\"Words\":[" + wordsJson + "]}";
+        }
+        json += "]}";
+        combined += (segment > 0 ? " " : "") + phrase.Text + ".";
+    }
+    json += "],\"CombinedResults\":[{\"ChannelNumber\":null,\"Lexical\":\"" + combined + "\",\"ITN\":\"" + combined
+        + "\",\"MaskedITN\":\"" + combined + "\",\"Display\":\"" + combined + "\"}]}]}";
+    return json;
+}
+
+// Generates a transcription result of one channel in the v3 format of samples/batch/transcriptionresult_v3.schema.json,
+// with word level timestamps.
+inline std::string GenerateSyntheticResultV3(size_t phraseCount, size_t nbestCount = 3, size_t channel = 0)
+{
+    auto phrases = GenerateSyntheticPhrases(phraseCount, channel);
+    uint64_t totalDuration = phrases.empty() ? 0 : phrases.back().Offset + phrases.back().Duration;
+    auto channelText = std::to_string(channel);
+
+    std::string json = "{\"source\":\"https://localhost/recordings/channel" + channelText + ".wav\",\"timestamp\":\"2020-06-16T09:30:21Z\","
+        "\"durationInTicks\":" + std::to_string(totalDuration) + ",\"duration\":\"" + FormatTicksAsDuration(totalDuration) + "\",";
+
+    std::string combined;
+    std::string phrasesJson;
+    for (size_t index = 0; index < phrases.size(); index++)
+    {
+        const auto& phrase = phrases[index];
+        std::string wordsJson;
+        for (size_t i = 0; i < phrase.Words.size(); i++)
+        {
+            wordsJson += std::string(i > 0 ? "," : "") + "{\"word\":\"" + phrase.Words[i].first + "\",\"offset\":\""
+                + FormatTicksAsDuration(phrase.Words[i].second) + "\",\"duration\":\"" + FormatTicksAsDuration(SyntheticPhrase::WordDuration)
+                + "\",\"offsetInTicks\":" + std::to_string(phrase.Words[i].second) + ",\"durationInTicks\":"
+                + std::to_string(SyntheticPhrase::WordDuration) + ",\"confidence\":0.9}";
+        }
+
+        phrasesJson += std::string(index > 0 ? "," : "") + "{\"recognitionStatus\":\"Success\",\"channel\":" + channelText
+            + ",\"offset\":\"" + FormatTicksAsDuration(phrase.Offset) + "\",\"duration\":\"" + FormatTicksAsDuration(phrase.Duration)
+            + "\",\"offsetInTicks\":" + std::to_string(phrase.Offset) + ",\"durationInTicks\":" + std::to_string(phrase.Duration)
+            + ",\"nBest\":[";
+        for (size_t n = 0; n < nbestCount; n++)
+        {
+            phrasesJson += std::string(n > 0 ? "," : "") + "{\"confidence\":" + std::to_string(0.95 - n * 0.1)
+                + ",\"lexical\":\"" + phrase.Text + "\",\"itn\":\"" + phrase.Text + "\",\"maskedITN\":\"" + phrase.Text
+                + "\",\"display\":\"" + phrase.Text + ".\",\"words\":[" + wordsJson + "]}";
+        }
+        phrasesJson += "]}";
+        combined += (index > 0 ? " " : "") + phrase.Text + ".";
+    }
+
+    json += "\"combinedRecognizedPhrases\":[{\"channel\":" + channelText + ",\"lexical\":\"" + combined + "\",\"itn\":\"" + combined
+        + "\",\"maskedITN\":\"" + combined + "\",\"display\":\"" + combined + "\"}],\"recognizedPhrases\":[" + phrasesJson + "]}";
+    return json;
+}
@@ -0,0 +1,494 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <Windows.h>
+
+#include "durable_file.h"
+#include "transcription_result.h"
+
+// A segment that contains the searched term or phrase.
+struct TranscriptHit
+{
+    std::string_view File;      // the audio file, valid as long as the index lives.
+    uint64_t Offset;            // in ticks of 100 nanoseconds.
+    uint64_t Duration;
+};
+
+// An inverted index over the best recognition of transcribed segments, to find the recordings, and the time within
+// them, that mention a term or phrase without reading their results again.
+//
+// Every term has a posting list of the segments that contain it, with the positions of the term within each
+// segment. Segments are numbered in the order they are added, so a posting list is in ascending order and stores
+// the difference to the previous segment, and the positions likewise, as variable length integers of 7 bits per byte.
+// Most differences fit in one byte. The file and time of each segment are kept once in a table.
+//
+// A phrase query intersects the posting lists of its terms, skipping ahead in all of them to the largest segment
+// any of them is at, and then checks the positions of the terms for consecutive ones.
+class TranscriptIndex
+{
+public:
+    struct Statistics
+    {
+        size_t Files = 0;
+        size_t Segments = 0;
+        size_t Terms = 0;
+        size_t Occurrences = 0;     // indexed words.
+        size_t PostingBytes = 0;
+    };
+
+    // Indexes the best recognition of a segment. Segments without a recognition take no space in the posting lists.
+    void Add(const std::string& file, const SegmentResult& segment)
+    {
+        // Consecutive segments mostly come from the same file, but the merged channels of a recording alternate.
+        if (m_files.empty() || m_files[m_currentFile] != file)
+        {
+            m_currentFile = FileId(file);
+        }
+
+        auto segmentId = static_cast<uint32_t>(m_segments.size());
+        m_segments.push_back(IndexedSegment{ segment.Offset, segment.Duration, m_currentFile });
+        if (segment.NBest.empty())
+        {
+            return;
+        }
+
+        // Collects the positions of every term of the segment, to write each term's positions together.
+        m_segmentTerms.clear();
+        uint32_t position = 0;
+        ForEachTerm(segment.NBest.front().Lexical, [this, &position](const std::string& term)
+        {
+            auto it = m_terms.find(term);
+            if (it == m_terms.end())
+            {
+                it = m_terms.emplace(term, Postings()).first;
+            }
+            m_segmentTerms.emplace_back(&it->second, position++);
+        });
+        m_occurrences += position;
+
+        // Sorting by term keeps the positions of a term in ascending order, as they were added in order.
+        std::stable_sort(m_segmentTerms.begin(), m_segmentTerms.end(),
+            [](const std::pair<Postings*, uint32_t>& a, const std::pair<Postings*, uint32_t>& b) { return std::less<Postings*>()(a.first, b.first); });
+        for (size_t i = 0; i < m_segmentTerms.size();)
+        {
+            auto postings = m_segmentTerms[i].first;
+            size_t end = i;
+            while (end < m_segmentTerms.size() && m_segmentTerms[end].first == postings)
+            {
+                end++;
+            }
+
+            WriteVarint(&postings->Bytes, segmentId - postings->LastSegment);
+            WriteVarint(&postings->Bytes, static_cast<uint32_t>(end - i));
+            uint32_t previous = 0;
+            for (; i < end; i++)
+            {
+                WriteVarint(&postings->Bytes, m_segmentTerms[i].second - previous);
+                previous = m_segmentTerms[i].second;
+            }
+            postings->LastSegment = segmentId;
+            postings->SegmentCount++;
+        }
+    }
+
+    // Adds all segments of another index after those of this one, e.g. of a transcription that was indexed on its
+    // own until all its results were fetched. The posting lists are appended as they are, only their first segment
+    // is made relative to the last one of this index.
+    void Append(const TranscriptIndex& other)
+    {
+        auto firstSegment = static_cast<uint32_t>(m_segments.size());
+        for (const auto& segment : other.m_segments)
+        {
+            m_segments.push_back(IndexedSegment{ segment.Offset, segment.Duration, FileId(other.m_files[segment.File]) });
+        }
+        for (const auto& term : other.m_terms)
+        {
+            auto& postings = m_terms[term.first];
+            const uint8_t* position = term.second.Bytes.data();
+            const uint8_t* end = position + term.second.Bytes.size();
+            auto segmentId = firstSegment + static_cast<uint32_t>(ReadVarint(&position, end));
+            WriteVarint(&postings.Bytes, segmentId - postings.LastSegment);
+            postings.Bytes.insert(postings.Bytes.end(), position, end);
+            postings.LastSegment = firstSegment + term.second.LastSegment;
+            postings.SegmentCount += term.second.SegmentCount;
+        }
+        m_occurrences += other.m_occurrences;
+    }
+
+    // Finds the segments that contain the phrase, one or more terms in this order, in the order they were added.
+    // The phrase is split into terms like the indexed text, so case and punctuation do not matter.
+    std::vector<TranscriptHit> Search(const std::string& phrase, size_t maxHits = SIZE_MAX) const
+    {
+        std::vector<Cursor> cursors;
+        ForEachTerm(phrase, [this, &cursors](const std::string& term)
+        {
+            auto it = m_terms.find(term);
+            cursors.emplace_back(it == m_terms.end() ? nullptr : &it->second);
+        });
+
+        std::vector<TranscriptHit> hits;
+        if (cursors.empty() || std::any_of(cursors.begin(), cursors.end(), [](const Cursor& cursor) { return cursor.AtEnd(); }))
+        {
+            return hits;
+        }
+
+        // Advancing the rarest term first skips the most segments of the others.
+        std::vector<size_t> order(cursors.size());
+        for (size_t i = 0; i < order.size(); i++)
+        {
+            order[i] = i;
+        }
+        std::sort(order.begin(), order.end(), [&cursors](size_t a, size_t b) { return cursors[a].SegmentCount() < cursors[b].SegmentCount(); });
+
+        std::vector<uint32_t> phrasePositions, termPositions;
+        uint32_t target = 0;
+        while (hits.size() < maxHits)
+        {
+            bool aligned = true;
+            for (auto i : order)
+            {
+                if (!cursors[i].SkipTo(target))
+                {
+                    return hits;
+                }
+                if (cursors[i].Segment() != target)
+                {
+                    target = cursors[i].Segment();
+                    aligned = false;
+                    break;
+                }
+            }
+            if (!aligned)
+            {
+                continue;
+            }
+
+            // Positions where the phrase starts: those of the first term that every following term continues.
+            cursors[0].Positions(&phrasePositions);
+            for (size_t term = 1; term < cursors.size() && !phrasePositions.empty(); term++)
+            {
+                cursors[term].Positions(&termPositions);
+                phrasePositions.erase(std::remove_if(phrasePositions.begin(), phrasePositions.end(), [&termPositions, term](uint32_t start)
+                {
+                    return !std::binary_search(termPositions.begin(), termPositions.end(), static_cast<uint32_t>(start + term));
+                }), phrasePositions.end());
+            }
+            if (!phrasePositions.empty())
+            {
+                const auto& segment = m_segments[target];
+                hits.push_back(TranscriptHit{ m_files[segment.File], segment.Offset, segment.Duration });
+            }
+            target++;
+        }
+        return hits;
+    }
+
+    Statistics GetStatistics() const
+    {
+        Statistics statistics;
+        statistics.Files = m_files.size();
+        statistics.Segments = m_segments.size();
+        statistics.Terms = m_terms.size();
+        statistics.Occurrences = m_occurrences;
+        for (const auto& term : m_terms)
+        {
+            statistics.PostingBytes += term.second.Bytes.size();
+        }
+        return statistics;
+    }
+
+    // Appends the index in its file format to data.
+    void Serialize(std::string* data) const
+    {
+        data->append(Magic);
+        WriteVarint(data, m_files.size());
+        for (const auto& file : m_files)
+        {
+            WriteString(data, file);
+        }
+        WriteVarint(data, m_segments.size());
+        for (const auto& segment : m_segments)
+        {
+            WriteVarint(data, segment.File);
+            WriteVarint(data, segment.Offset);
+            WriteVarint(data, segment.Duration);
+        }
+        WriteVarint(data, m_terms.size());
+        WriteVarint(data, m_occurrences);
+        for (const auto& term : m_terms)
+        {
+            WriteString(data, term.first);
+            WriteVarint(data, term.second.LastSegment);
+            WriteVarint(data, term.second.SegmentCount);
+            WriteString(data, std::string_view(reinterpret_cast<const char*>(term.second.Bytes.data()), term.second.Bytes.size()));
+        }
+    }
+
+    // Replaces the index with one written by Serialize. Throws if data is not an index or truncated.
+    void Deserialize(std::string_view data)
+    {
+        if (data.compare(0, Magic.size(), Magic) != 0)
+        {
+            throw std::runtime_error("Not a transcript index.");
+        }
+
+        *this = TranscriptIndex();
+        const uint8_t* position = reinterpret_cast<const uint8_t*>(data.data()) + Magic.size();
+        const uint8_t* end = reinterpret_cast<const uint8_t*>(data.data()) + data.size();
+        auto count = ReadVarint(&position, end);
+        for (uint64_t i = 0; i < count; i++)
+        {
+            m_files.emplace_back(ReadString(&position, end));
+            m_fileIds.emplace(m_files.back(), static_cast<uint32_t>(i));
+        }
+        m_segments.resize(ReadVarint(&position, end));
+        for (auto& segment : m_segments)
+        {
+            segment.File = static_cast<uint32_t>(ReadVarint(&position, end));
+            segment.Offset = ReadVarint(&position, end);
+            segment.Duration = ReadVarint(&position, end);
+            if (segment.File >= m_files.size())
+            {
+                throw std::runtime_error("Corrupt transcript index.");
+            }
+        }
+        count = ReadVarint(&position, end);
+        m_occurrences = ReadVarint(&position, end);
+        m_terms.reserve(count);
+        for (uint64_t i = 0; i < count; i++)
+        {
+            auto term = ReadString(&position, end);
+            Postings postings;
+            postings.LastSegment = static_cast<uint32_t>(ReadVarint(&position, end));
+            postings.SegmentCount = static_cast<uint32_t>(ReadVarint(&position, end));
+            auto bytes = ReadString(&position, end);
+            postings.Bytes.assign(bytes.begin(), bytes.end());
+            m_terms.emplace(std::move(term), std::move(postings));
+        }
+        if (!m_segments.empty())
+        {
+            m_currentFile = m_segments.back().File;
+        }
+    }
+
+    // Writes the index to a file, replacing it only once written completely and flushed to the disk.
+    // Throws if it cannot be written.
+    void Save(const std::string& fileName) const
+    {
+        std::string data;
+        Serialize(&data);
+        ReplaceFileDurably(fileName, data);
+    }
+
+    // Reads an index written by Save. Returns false if the file does not exist, throws if it is not an index.
+    bool Load(const std::string& fileName)
+    {
+        std::ifstream file(fileName, std::ios::binary);
+        if (!file)
+        {
+            return false;
+        }
+        std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        try
+        {
+            Deserialize(data);
+        }
+        catch (const std::exception& e)
+        {
+            throw std::runtime_error(fileName + ": " + e.what());
+        }
+        return true;
+    }
+
+    // Calls onTerm for every term of the text: runs of letters, digits, apostrophes and non-ASCII characters, with
+    // ASCII letters in lower case.
+    template<class TermHandler>
+    static void ForEachTerm(const std::string& text, TermHandler onTerm)
+    {
+        std::string term;
+        for (size_t i = 0; i <= text.size(); i++)
+        {
+            unsigned char c = i < text.size() ? static_cast<unsigned char>(text[i]) : ' ';
+            if ((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '\'' || c >= 0x80)
+            {
+                term += static_cast<char>(c);
+            }
+            else if (c >= 'A' && c <= 'Z')
+            {
+                term += static_cast<char>(c - 'A' + 'a');
+            }
+            else if (!term.empty())
+            {
+                onTerm(term);
+                term.clear();
+            }
+        }
+    }
+
+private:
+    uint32_t FileId(const std::string& file)
+    {
+        auto it = m_fileIds.find(file);
+        if (it == m_fileIds.end())
+        {
+            it = m_fileIds.emplace(file, static_cast<uint32_t>(m_files.size())).first;
+            m_files.push_back(file);
+        }
+        return it->second;
+    }
+
+    static constexpr std::string_view Magic = "TranscriptIndex 1\n";
+
+    struct IndexedSegment
+    {
+        uint64_t Offset;
+        uint64_t Duration;
+        uint32_t File;
+    };
+
+    struct Postings
+    {
+        std::vector<uint8_t> Bytes;
+        uint32_t LastSegment = 0;
+        uint32_t SegmentCount = 0;
+    };
+
+    // Reads a posting list one segment at a time, decoding the positions only when asked.
+    class Cursor
+    {
+    public:
+        explicit Cursor(const Postings* postings) :
+            m_postings(postings),
+            m_position(postings ? postings->Bytes.data() : nullptr),
+            m_end(postings ? postings->Bytes.data() + postings->Bytes.size() : nullptr)
+        {
+            Next();
+        }
+
+        bool AtEnd() const { return m_atEnd; }
+        uint32_t Segment() const { return m_segment; }
+        uint32_t SegmentCount() const { return m_postings ? m_postings->SegmentCount : 0; }
+
+        // Moves to the first segment not before target. Returns false if there is none.
+        bool SkipTo(uint32_t target)
+        {
+            while (!m_atEnd && m_segment < target)
+            {
+                Next();
+            }
+            return !m_atEnd;
+        }
+
+        void Positions(std::vector<uint32_t>* positions)
+        {
+            positions->clear();
+            auto position = m_positions;
+            uint32_t value = 0;
+            for (uint32_t i = 0; i < m_positionCount; i++)
+            {
+                value += static_cast<uint32_t>(ReadVarint(&position, m_end));
+                positions->push_back(value);
+            }
+        }
+
+    private:
+        void Next()
+        {
+            // Skips the positions of the current segment.
+            for (uint32_t i = 0; i < m_positionCount; i++)
+            {
+                while (*m_positions++ & 0x80)
+                {
+                }
+            }
+            if (m_positions)
+            {
+                m_position = m_positions;
+            }
+            if (m_position == m_end)
+            {
+                m_atEnd = true;
+                m_positionCount = 0;
+                return;
+            }
+            m_segment += static_cast<uint32_t>(ReadVarint(&m_position, m_end));
+            m_positionCount = static_cast<uint32_t>(ReadVarint(&m_position, m_end));
+            m_positions = m_position;
+        }
+
+        const Postings* m_postings;
+        const uint8_t* m_position;
+        const uint8_t* m_end;
+        const uint8_t* m_positions = nullptr;
+        uint32_t m_segment = 0;
+        uint32_t m_positionCount = 0;
+        bool m_atEnd = false;
+    };
+
+    template<class Buffer>
+    static void WriteVarint(Buffer* buffer, uint64_t value)
+    {
+        while (value >= 0x80)
+        {
+            buffer->push_back(static_cast<typename Buffer::value_type>(value | 0x80));
+            value >>= 7;
+        }
+        buffer->push_back(static_cast<typename Buffer::value_type>(value));
+    }
+
+    static uint64_t ReadVarint(const uint8_t** position, const uint8_t* end)
+    {
+        uint64_t value = 0;
+        for (int shift = 0; *position < end && shift < 64; shift += 7)
+        {
+            uint8_t byte = *(*position)++;
+            value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0)
+            {
+                return value;
+            }
+        }
+        throw std::runtime_error("Truncated transcript index.");
+    }
+
+    static void WriteString(std::string* buffer, std::string_view text)
+    {
+        WriteVarint(buffer, text.size());
+        buffer->append(text.data(), text.size());
+    }
+
+    static std::string ReadString(const uint8_t** position, const uint8_t* end)
+    {
+        auto size = ReadVarint(position, end);
+        if (size > static_cast<uint64_t>(end - *position))
+        {
+            throw std::runtime_error("Truncated transcript index.");
+        }
+        std::string text(reinterpret_cast<const char*>(*position), static_cast<size_t>(size));
+        *position += size;
+        return text;
+    }
+
+    std::vector<std::string> m_files;
+    std::unordered_map<std::string, uint32_t> m_fileIds;
+    uint32_t m_currentFile = 0;
+    std::vector<IndexedSegment> m_segments;
+    std::unordered_map<std::string, Postings> m_terms;
+    std::vector<std::pair<Postings*, uint32_t>> m_segmentTerms;
+    uint64_t m_occurrences = 0;
+};
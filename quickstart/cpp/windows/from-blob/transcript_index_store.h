@@ -0,0 +1,325 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include <Windows.h>
+
+#include "durable_file.h"
+#include "transcript_index.h"
+
+// Keeps a TranscriptIndex on the disk as a snapshot and an append-only log, so adding the results of a transcription
+// writes only their own index instead of the whole index again.
+//
+// Add appends the index of a transcription to the log as one record with a CRC-32, and returns once the record is
+// flushed to the disk; only then may the transcription be journaled as fetched. A crash can only tear the last
+// record, which fails the check when the store is opened and is cut off. Once the log has grown as large as the
+// snapshot, the whole index is written to a new snapshot and the log starts over, so the index is rewritten a
+// logarithmic number of times, and the time spent on it stays linear in its size.
+//
+// Both files carry the generation of the log: the snapshot the one of the log that continues it, the log its own.
+// A log older than the snapshot, left behind by a crash during compaction, is already contained in the snapshot.
+// If the index cannot be restored, e.g. because the snapshot is unreadable or the log continues a snapshot that is
+// gone, both files are moved aside and the store starts empty, and Lost tells to fetch all results again.
+class TranscriptIndexStore
+{
+public:
+    struct Statistics
+    {
+        uint64_t Records = 0;           // in the log.
+        uint64_t LogBytes = 0;
+        uint64_t SnapshotBytes = 0;
+        uint64_t TornBytes = 0;         // cut off the log when the store was opened.
+        uint64_t Compactions = 0;
+        uint64_t FailedCompactions = 0;
+        bool Lost = false;              // the index could not be restored and starts empty.
+    };
+
+    // Opens the store with the snapshot fileName and the log fileName.log, creating them if they do not exist.
+    // The log is not compacted while it is smaller than compactionMinBytes. Throws if the log cannot be opened.
+    explicit TranscriptIndexStore(const std::string& fileName, uint64_t compactionMinBytes = 64 * 1024 * 1024) :
+        m_fileName(fileName),
+        m_compactionMinBytes(compactionMinBytes)
+    {
+        uint64_t validBytes = 0;
+        if (!Restore(m_fileName, &m_index, &m_statistics, &m_generation, &validBytes))
+        {
+            // Kept for inspection; nothing of them is used anymore.
+            MoveFileExA(m_fileName.c_str(), (m_fileName + ".lost").c_str(), MOVEFILE_REPLACE_EXISTING);
+            MoveFileExA(LogName(m_fileName).c_str(), (LogName(m_fileName) + ".lost").c_str(), MOVEFILE_REPLACE_EXISTING);
+            m_index = TranscriptIndex();
+            m_statistics = Statistics();
+            m_statistics.Lost = true;
+            m_generation = 0;
+        }
+
+        if (validBytes == 0)
+        {
+            StartLog();
+            return;
+        }
+        m_log = OpenLog();
+        m_statistics.LogBytes = validBytes;
+        if (!Truncate())
+        {
+            CloseHandle(m_log);
+            throw std::runtime_error("Cannot truncate the index log " + LogName(m_fileName));
+        }
+    }
+
+    ~TranscriptIndexStore()
+    {
+        if (m_log != INVALID_HANDLE_VALUE)
+        {
+            CloseHandle(m_log);
+        }
+    }
+
+    TranscriptIndexStore(const TranscriptIndexStore&) = delete;
+    TranscriptIndexStore& operator=(const TranscriptIndexStore&) = delete;
+
+    // Reads the index of a store without modifying its files, e.g. to search it while results are being fetched.
+    // Returns false if there is no store or its index cannot be restored.
+    static bool Read(const std::string& fileName, TranscriptIndex* index)
+    {
+        Statistics statistics;
+        uint64_t generation = 0;
+        uint64_t validBytes = 0;
+        return Restore(fileName, index, &statistics, &generation, &validBytes) && validBytes > 0;
+    }
+
+    const TranscriptIndex& Index() const { return m_index; }
+    Statistics GetStatistics() const { return m_statistics; }
+
+    // Adds the segments of another index, e.g. of the results of one transcription. Returns once they are on the
+    // disk, throws if they cannot be written, leaving the store as it was. Not thread safe.
+    void Add(const TranscriptIndex& index)
+    {
+        if (m_log == INVALID_HANDLE_VALUE)
+        {
+            StartLog();
+        }
+
+        std::string payload;
+        index.Serialize(&payload);
+        std::string record;
+        AppendLittleEndian(&record, static_cast<uint32_t>(payload.size()));
+        AppendLittleEndian(&record, Crc32(payload));
+        record += payload;
+        if (!WriteAll(m_log, record) || !FlushFileBuffers(m_log))
+        {
+            // Cuts off what was written of the record, or else the records after it would be lost with it.
+            if (!Truncate())
+            {
+                CloseHandle(m_log);
+                m_log = INVALID_HANDLE_VALUE;
+            }
+            throw std::runtime_error("Cannot write the index log " + LogName(m_fileName));
+        }
+
+        m_index.Append(index);
+        m_statistics.Records++;
+        m_statistics.LogBytes += record.size();
+        if (m_statistics.LogBytes >= std::max(m_compactionMinBytes, m_statistics.SnapshotBytes))
+        {
+            // The record is on the disk already; a failed compaction is repeated with the next one.
+            try
+            {
+                Compact();
+            }
+            catch (const std::exception&)
+            {
+                m_statistics.FailedCompactions++;
+            }
+        }
+    }
+
+    // Writes the whole index to the snapshot and starts a new log. Throws if either cannot be written.
+    void Compact()
+    {
+        std::string snapshot(SnapshotMagic);
+        AppendLittleEndian(&snapshot, m_generation + 1);
+        AppendLittleEndian(&snapshot, uint32_t(0));
+        auto headerSize = snapshot.size();
+        m_index.Serialize(&snapshot);
+        auto crc = Crc32(snapshot.data() + headerSize, snapshot.size() - headerSize);
+        for (size_t i = 0; i < sizeof(crc); i++)
+        {
+            snapshot[headerSize - sizeof(crc) + i] = static_cast<char>(crc >> (8 * i));
+        }
+
+        // From here on the log is older than the snapshot, and ignored if the client stops before it is replaced.
+        ReplaceFileDurably(m_fileName, snapshot);
+        m_generation++;
+        m_statistics.SnapshotBytes = snapshot.size();
+        m_statistics.Compactions++;
+        CloseHandle(m_log);
+        m_log = INVALID_HANDLE_VALUE;
+        StartLog();
+    }
+
+private:
+    static constexpr std::string_view SnapshotMagic = "TranscriptIndexSnapshot 1\n";
+    static constexpr std::string_view LogMagic = "TranscriptIndexLog 1\n";
+    static constexpr size_t SnapshotHeaderSize = SnapshotMagic.size() + 12;
+    static constexpr size_t LogHeaderSize = LogMagic.size() + 8;
+
+    static std::string LogName(const std::string& fileName)
+    {
+        return fileName + ".log";
+    }
+
+    static bool ReadWholeFile(const std::string& fileName, std::string* data)
+    {
+        std::ifstream file(fileName, std::ios::binary);
+        if (!file)
+        {
+            return false;
+        }
+        data->assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        return true;
+    }
+
+    // Reads the snapshot and replays the log into index. Sets generation to the one of the log, and validBytes to
+    // the length of its valid part, or 0 if there is no log to continue. Returns false if the index is lost.
+    static bool Restore(const std::string& fileName, TranscriptIndex* index, Statistics* statistics, uint64_t* generation,
+        uint64_t* validBytes)
+    {
+        *index = TranscriptIndex();
+        *generation = 0;
+        *validBytes = 0;
+
+        std::string data;
+        if (ReadWholeFile(fileName, &data))
+        {
+            if (data.size() < SnapshotHeaderSize || data.compare(0, SnapshotMagic.size(), SnapshotMagic) != 0 ||
+                ReadLittleEndian<uint32_t>(data, SnapshotHeaderSize - 4) != Crc32(data.data() + SnapshotHeaderSize, data.size() - SnapshotHeaderSize))
+            {
+                return false;
+            }
+            try
+            {
+                index->Deserialize(std::string_view(data).substr(SnapshotHeaderSize));
+            }
+            catch (const std::exception&)
+            {
+                return false;
+            }
+            *generation = ReadLittleEndian<uint64_t>(data, SnapshotMagic.size());
+            statistics->SnapshotBytes = data.size();
+        }
+
+        // The log is written in one piece when it starts, so a missing or bad header means its records are lost,
+        // unless the snapshot has been compacted after it.
+        bool logRead = ReadWholeFile(LogName(fileName), &data);
+        if (!logRead || data.size() < LogHeaderSize || data.compare(0, LogMagic.size(), LogMagic) != 0)
+        {
+            return !logRead && *generation == 0;
+        }
+        auto logGeneration = ReadLittleEndian<uint64_t>(data, LogMagic.size());
+        if (logGeneration < *generation)
+        {
+            return true;
+        }
+        if (logGeneration > *generation)
+        {
+            // The log continues a snapshot that is gone.
+            return false;
+        }
+
+        size_t offset = LogHeaderSize;
+        while (offset + 8 <= data.size())
+        {
+            auto size = ReadLittleEndian<uint32_t>(data, offset);
+            auto crc = ReadLittleEndian<uint32_t>(data, offset + 4);
+            if (size > data.size() - offset - 8 || crc != Crc32(data.data() + offset + 8, size))
+            {
+                // A torn record; the crash happened before it was flushed, so it is the last one.
+                break;
+            }
+            TranscriptIndex record;
+            try
+            {
+                record.Deserialize(std::string_view(data).substr(offset + 8, size));
+            }
+            catch (const std::exception&)
+            {
+                return false;
+            }
+            index->Append(record);
+            statistics->Records++;
+            offset += 8 + size;
+        }
+        statistics->TornBytes = data.size() - offset;
+        *validBytes = offset;
+        return true;
+    }
+
+    // Replaces the log with an empty one of the current generation and opens it.
+    void StartLog()
+    {
+        std::string header(LogMagic);
+        AppendLittleEndian(&header, m_generation);
+        ReplaceFileDurably(LogName(m_fileName), header);
+        m_log = OpenLog();
+        m_statistics.LogBytes = header.size();
+        m_statistics.Records = 0;
+        LARGE_INTEGER end = {};
+        SetFilePointerEx(m_log, end, nullptr, FILE_END);
+    }
+
+    HANDLE OpenLog() const
+    {
+        auto logName = LogName(m_fileName);
+        auto file = CreateFileA(logName.c_str(), GENERIC_WRITE, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+        {
+            throw std::runtime_error("Cannot open the index log " + logName);
+        }
+        return file;
+    }
+
+    // Cuts the log off after its valid records, and continues writing there.
+    bool Truncate()
+    {
+        LARGE_INTEGER size;
+        size.QuadPart = static_cast<LONGLONG>(m_statistics.LogBytes);
+        return SetFilePointerEx(m_log, size, nullptr, FILE_BEGIN) && SetEndOfFile(m_log) && FlushFileBuffers(m_log);
+    }
+
+    template<class T>
+    static void AppendLittleEndian(std::string* data, T value)
+    {
+        for (size_t i = 0; i < sizeof(T); i++)
+        {
+            data->push_back(static_cast<char>(static_cast<uint64_t>(value) >> (8 * i)));
+        }
+    }
+
+    template<class T>
+    static T ReadLittleEndian(const std::string& data, size_t offset)
+    {
+        uint64_t value = 0;
+        for (size_t i = 0; i < sizeof(T); i++)
+        {
+            value |= static_cast<uint64_t>(static_cast<unsigned char>(data[offset + i])) << (8 * i);
+        }
+        return static_cast<T>(value);
+    }
+
+    std::string m_fileName;
+    uint64_t m_compactionMinBytes;
+    uint64_t m_generation = 0;
+    HANDLE m_log = INVALID_HANDLE_VALUE;
+    TranscriptIndex m_index;
+    Statistics m_statistics;
+};
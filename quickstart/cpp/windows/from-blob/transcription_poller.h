@@ -0,0 +1,401 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <cpprest/http_client.h>
+#include <nlohmann/json.hpp>
+
+#include "http_retry.h"
+
+// Polling intervals of the TranscriptionPoller.
+struct TranscriptionPollerOptions
+{
+    std::chrono::milliseconds InitialInterval = std::chrono::seconds(2);
+    std::chrono::milliseconds MinInterval = std::chrono::milliseconds(500);
+    std::chrono::milliseconds MaxInterval = std::chrono::seconds(60);
+    double BackoffFactor = 2.0;
+    double Jitter = 0.2;            // each interval is scaled by a random factor in [1 - Jitter, 1 + Jitter].
+    int MaxConsecutiveErrors = 8;   // a transcription is given up after this many failed polls in a row.
+
+    // Interval between the polls of a transcription that PollNow requested while they fail, independent of the
+    // others, which may be long when polling is only a fallback for webhooks.
+    std::chrono::milliseconds RequestedRetryInterval = std::chrono::seconds(1);
+};
+
+// Polls the status of many transcriptions from one event loop thread, with asynchronous requests, instead of one
+// blocking loop with a fixed sleep per transcription.
+//
+// The interval between two polls of a transcription grows exponentially while it has not started or an error occurs,
+// and shrinks as a running transcription approaches its expected completion, so a finished transcription is noticed
+// within about MinInterval. The expected running time is learned from the transcriptions completed so far, or given
+// by the caller. Every interval gets random jitter, so polls of transcriptions submitted together spread out, and
+// a Retry-After header of a throttled (429) or unavailable (503) response is honoured.
+//
+// With webhook notifications, polling is only a safety net with long intervals, and PollNow polls a transcription
+// as soon as the service notified its completion.
+class TranscriptionPoller
+{
+public:
+    using Options = TranscriptionPollerOptions;
+
+    // Called on the event loop thread for every status received. status is the transcription JSON, or null if
+    // the transcription was given up because of errors. Polling stops after Succeeded, Failed or null.
+    using StatusHandler = std::function<void(const utility::string_t& location, const nlohmann::json& status)>;
+
+    TranscriptionPoller(const utility::string_t& subscriptionKey, const Options& options = Options()) :
+        m_subscriptionKey(subscriptionKey),
+        m_options(options),
+        m_random(std::random_device()())
+    {
+    }
+
+    // Starts polling a transcription. expectedRunningTime is a hint of how long it runs once started, 0 if unknown.
+    // May be called from any thread, also from a status handler.
+    void Add(const utility::string_t& location, StatusHandler onStatus, std::chrono::milliseconds expectedRunningTime = std::chrono::milliseconds(0))
+    {
+        auto job = std::make_shared<PollJob>();
+        job->Location = location;
+        job->OnStatus = std::move(onStatus);
+        job->ExpectedRunningTime = expectedRunningTime;
+        job->Interval = m_options.InitialInterval;
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_activeJobs++;
+        m_jobs[location] = job;
+        // The first poll happens right away, the transcription may have finished already when it is resumed.
+        job->Sequence = m_nextSequence++;
+        m_schedule.push(Scheduled{ Clock::now(), job->Sequence, job });
+        m_wakeUp.notify_one();
+    }
+
+    // Polls a transcription right away instead of when it is due, e.g. when a webhook notified its completion.
+    // Returns false if the transcription is not being polled. May be called from any thread.
+    bool PollNow(const utility::string_t& location)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_jobs.find(location);
+        if (it == m_jobs.end())
+        {
+            return false;
+        }
+        m_pollRequests.push_back(it->second);
+        m_wakeUp.notify_one();
+        return true;
+    }
+
+    // Runs the event loop on the calling thread until every transcription completed.
+    void Run()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (m_activeJobs > 0)
+        {
+            // Handles the responses that arrived, on this thread, so handlers never run concurrently.
+            while (!m_responses.empty())
+            {
+                auto response = std::move(m_responses.front());
+                m_responses.pop_front();
+                lock.unlock();
+                HandleResponse(response);
+                lock.lock();
+            }
+
+            // A poll in flight is repeated once its response arrives, as it may have been sent just before the
+            // transcription completed. Otherwise the job is scheduled now, which makes its earlier schedule stale.
+            while (!m_pollRequests.empty())
+            {
+                auto job = m_pollRequests.front();
+                m_pollRequests.pop_front();
+                if (job->InFlight)
+                {
+                    job->PollRequested = true;
+                }
+                else if (!job->Completed)
+                {
+                    job->Sequence = m_nextSequence++;
+                    m_schedule.push(Scheduled{ Clock::now(), job->Sequence, job });
+                }
+            }
+
+            if (!m_schedule.empty() && m_schedule.top().Due <= Clock::now())
+            {
+                auto scheduled = m_schedule.top();
+                m_schedule.pop();
+                if (scheduled.Sequence != scheduled.Job->Sequence || scheduled.Job->Completed)
+                {
+                    continue;
+                }
+                scheduled.Job->InFlight = true;
+                lock.unlock();
+                Poll(scheduled.Job);
+                lock.lock();
+                continue;
+            }
+
+            if (m_schedule.empty())
+            {
+                m_wakeUp.wait(lock, [this]() { return !m_responses.empty() || !m_pollRequests.empty() || !m_schedule.empty() || m_activeJobs == 0; });
+            }
+            else
+            {
+                auto due = m_schedule.top().Due;
+                m_wakeUp.wait_until(lock, due, [this, due]()
+                {
+                    return !m_responses.empty() || !m_pollRequests.empty() || m_schedule.top().Due < due;
+                });
+            }
+        }
+    }
+
+    // Number of status requests sent so far.
+    size_t PollCount() const { return m_pollCount; }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct PollJob
+    {
+        utility::string_t Location;
+        StatusHandler OnStatus;
+        std::chrono::milliseconds ExpectedRunningTime;
+        std::chrono::milliseconds Interval;
+        Clock::time_point RunningSince;
+        bool Running = false;
+        int ConsecutiveErrors = 0;
+        int OverduePolls = 0;
+
+        // Guarded by m_mutex.
+        uint64_t Sequence = 0;      // of the current schedule, older ones are stale.
+        bool InFlight = false;
+        bool PollRequested = false;
+        bool Completed = false;
+    };
+
+    struct Scheduled
+    {
+        Clock::time_point Due;
+        uint64_t Sequence;      // keeps the order of equal due times stable.
+        std::shared_ptr<PollJob> Job;
+
+        bool operator>(const Scheduled& other) const
+        {
+            return Due != other.Due ? Due > other.Due : Sequence > other.Sequence;
+        }
+    };
+
+    struct Response
+    {
+        std::shared_ptr<PollJob> Job;
+        web::http::status_code StatusCode = 0;   // 0 if the request failed.
+        std::chrono::milliseconds RetryAfter = std::chrono::milliseconds(0);
+        std::string Body;
+    };
+
+    // One client per host, so all polls of a host share its keep-alive connections.
+    web::http::client::http_client& GetClient(const web::uri& location)
+    {
+        auto authority = location.authority().to_string();
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_clients.find(authority);
+        if (it == m_clients.end())
+        {
+            it = m_clients.emplace(authority, std::make_shared<web::http::client::http_client>(location.authority())).first;
+        }
+        return *it->second;
+    }
+
+    void Poll(const std::shared_ptr<PollJob>& job)
+    {
+        web::uri location(job->Location);
+        web::http::http_request request(web::http::methods::GET);
+        request.set_request_uri(location.resource());
+        request.headers().add(U("Ocp-Apim-Subscription-Key"), m_subscriptionKey);
+        m_pollCount++;
+
+        GetClient(location).request(request).then([this, job](pplx::task<web::http::http_response> task)
+        {
+            auto response = std::make_shared<Response>();
+            response->Job = job;
+            try
+            {
+                auto httpResponse = task.get();
+                response->StatusCode = httpResponse.status_code();
+                response->RetryAfter = GetRetryAfter(httpResponse.headers());
+                if (response->StatusCode == web::http::status_codes::OK)
+                {
+                    response->Body = httpResponse.extract_utf8string(true).get();
+                }
+            }
+            catch (const std::exception&)
+            {
+                response->StatusCode = 0;
+            }
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_responses.push_back(std::move(*response));
+            m_wakeUp.notify_one();
+        });
+    }
+
+    void HandleResponse(Response& response)
+    {
+        auto& job = *response.Job;
+        bool pollRequested;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            job.InFlight = false;
+            pollRequested = job.PollRequested;
+            job.PollRequested = false;
+        }
+
+        if (response.StatusCode != web::http::status_codes::OK)
+        {
+            if (++job.ConsecutiveErrors >= m_options.MaxConsecutiveErrors)
+            {
+                Complete(response.Job, nlohmann::json());
+                return;
+            }
+            if (pollRequested)
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                job.PollRequested = true;
+            }
+            job.Interval = Backoff(job.Interval);
+            Schedule(response.Job, std::max(pollRequested ? m_options.RequestedRetryInterval : job.Interval, response.RetryAfter));
+            return;
+        }
+        job.ConsecutiveErrors = 0;
+
+        nlohmann::json status;
+        try
+        {
+            status = nlohmann::json::parse(response.Body);
+        }
+        catch (const std::exception&)
+        {
+            job.Interval = Backoff(job.Interval);
+            Schedule(response.Job, job.Interval);
+            return;
+        }
+
+        auto state = status.value("status", "");
+        if (state == "Succeeded" || state == "Failed")
+        {
+            if (job.Running && state == "Succeeded")
+            {
+                LearnRunningTime(std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - job.RunningSince));
+            }
+            Complete(response.Job, status);
+            return;
+        }
+
+        job.OnStatus(job.Location, status);
+        if (state == "Running")
+        {
+            if (!job.Running)
+            {
+                job.Running = true;
+                job.RunningSince = Clock::now();
+                job.Interval = m_options.InitialInterval;
+            }
+            auto interval = std::max(RunningInterval(job), response.RetryAfter);
+            Schedule(response.Job, pollRequested ? std::chrono::milliseconds(0) : interval);
+        }
+        else
+        {
+            // Not started yet, the wait for a free slot is unpredictable, so the interval only grows.
+            job.Interval = Backoff(job.Interval);
+            Schedule(response.Job, pollRequested ? std::chrono::milliseconds(0) : std::max(job.Interval, response.RetryAfter));
+        }
+    }
+
+    // The interval for a running transcription: half the expected remaining time, so polls get denser towards
+    // the expected completion, and growing again from MinInterval once the transcription is overdue.
+    std::chrono::milliseconds RunningInterval(PollJob& job)
+    {
+        auto expected = job.ExpectedRunningTime.count() > 0 ? job.ExpectedRunningTime : LearnedRunningTime();
+        job.Interval = Backoff(job.Interval);
+        if (expected.count() == 0)
+        {
+            return job.Interval;
+        }
+
+        auto remaining = expected - std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - job.RunningSince);
+        if (remaining.count() > 0)
+        {
+            job.Interval = std::max(m_options.MinInterval, std::min(job.Interval, remaining / 2));
+            return job.Interval;
+        }
+
+        auto overdue = m_options.MinInterval.count() * std::pow(m_options.BackoffFactor, job.OverduePolls++);
+        job.Interval = std::min(m_options.MaxInterval, std::chrono::milliseconds(static_cast<int64_t>(overdue)));
+        return job.Interval;
+    }
+
+    std::chrono::milliseconds Backoff(std::chrono::milliseconds interval) const
+    {
+        auto next = std::chrono::milliseconds(static_cast<int64_t>(interval.count() * m_options.BackoffFactor));
+        return std::max(m_options.MinInterval, std::min(m_options.MaxInterval, next));
+    }
+
+    void Schedule(const std::shared_ptr<PollJob>& job, std::chrono::milliseconds interval)
+    {
+        std::uniform_real_distribution<double> jitter(1 - m_options.Jitter, 1 + m_options.Jitter);
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto delay = std::chrono::milliseconds(static_cast<int64_t>(interval.count() * jitter(m_random)));
+        job->Sequence = m_nextSequence++;
+        m_schedule.push(Scheduled{ Clock::now() + delay, job->Sequence, job });
+    }
+
+    void Complete(const std::shared_ptr<PollJob>& job, const nlohmann::json& status)
+    {
+        job->OnStatus(job->Location, status);
+        std::lock_guard<std::mutex> lock(m_mutex);
+        job->Completed = true;
+        m_jobs.erase(job->Location);
+        m_activeJobs--;
+    }
+
+    // Exponentially weighted average of the running times of completed transcriptions.
+    void LearnRunningTime(std::chrono::milliseconds runningTime)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_learnedRunningTime = m_learnedRunningTime.count() == 0 ? runningTime : (m_learnedRunningTime * 3 + runningTime) / 4;
+    }
+
+    std::chrono::milliseconds LearnedRunningTime()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_learnedRunningTime;
+    }
+
+    utility::string_t m_subscriptionKey;
+    Options m_options;
+    std::mutex m_mutex;
+    std::condition_variable m_wakeUp;
+    std::priority_queue<Scheduled, std::vector<Scheduled>, std::greater<Scheduled>> m_schedule;
+    std::deque<Response> m_responses;
+    std::deque<std::shared_ptr<PollJob>> m_pollRequests;
+    std::map<utility::string_t, std::shared_ptr<PollJob>> m_jobs;     // the active jobs by location.
+    std::map<utility::string_t, std::shared_ptr<web::http::client::http_client>> m_clients;
+    std::mt19937 m_random;
+    uint64_t m_nextSequence = 0;
+    size_t m_activeJobs = 0;
+    size_t m_pollCount = 0;
+    std::chrono::milliseconds m_learnedRunningTime = std::chrono::milliseconds(0);
+};
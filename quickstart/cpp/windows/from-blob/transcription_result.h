@@ -0,0 +1,77 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <string>
+
+#include <nlohmann/json.hpp>
+
+// Result of a batch transcription (v2 API), one document per channel.
+
+class Result
+{
+public:
+    std::string Lexical;
+    std::string ITN;
+    std::string MaskedITN;
+    std::string Display;
+};
+inline void from_json(const nlohmann::json& j, Result& r) {
+    j.at("Lexical").get_to(r.Lexical);
+    j.at("ITN").get_to(r.ITN);
+    j.at("MaskedITN").get_to(r.MaskedITN);
+    j.at("Display").get_to(r.Display);
+}
+
+class NBest : public Result
+{
+public:
+    double Confidence;
+};
+inline void from_json(const nlohmann::json& j, NBest& nb) {
+    j.at("Confidence").get_to(nb.Confidence);
+    j.at("Lexical").get_to(nb.Lexical);
+    j.at("ITN").get_to(nb.ITN);
+    j.at("MaskedITN").get_to(nb.MaskedITN);
+    j.at("Display").get_to(nb.Display);
+}
+
+class SegmentResult
+{
+public:
+    std::string RecognitionStatus;
+    uint64_t Offset;     // in ticks of 100 nanoseconds.
+    uint64_t Duration;
+    std::list<NBest> NBest;
+};
+inline void from_json(const nlohmann::json& j, SegmentResult& sr) {
+    j.at("RecognitionStatus").get_to(sr.RecognitionStatus);
+    j.at("Offset").get_to(sr.Offset);
+    j.at("Duration").get_to(sr.Duration);
+    sr.NBest = j.at("NBest").get<std::list<NBest>>();
+}
+
+class AudioFileResult
+{
+public:
+    std::string AudioFileName;
+    std::list<SegmentResult> SegmentResults;
+    std::list<Result> CombinedResults;
+};
+inline void from_json(const nlohmann::json& j, AudioFileResult& arf) {
+    j.at("AudioFileName").get_to(arf.AudioFileName);
+    arf.SegmentResults = j.at("SegmentResults").get<std::list<SegmentResult>>();
+    arf.CombinedResults = j.at("CombinedResults").get<std::list<Result>>();
+}
+
+class RootObject {
+public:
+    std::list<AudioFileResult> AudioFileResults;
+};
+inline void from_json(const nlohmann::json& j, RootObject& r) {
+    r.AudioFileResults = j.at("AudioFileResults").get<std::list<AudioFileResult>>();
+}
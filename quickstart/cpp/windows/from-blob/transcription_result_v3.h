@@ -0,0 +1,414 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// Generated by generate_result_parser.py from transcriptionresult_v3.schema.json, do not edit.
+//
+#pragma once
+
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include "json_cursor.h"
+
+// Result of a batch transcription (v3 API), one document per audio file. Members the client does not use are
+// left out:
+//     timestamp
+//     duration
+//     recognizedPhrases/offset
+//     recognizedPhrases/duration
+//     recognizedPhrases/nBest/words/offset
+//     recognizedPhrases/nBest/words/duration
+
+class CombinedRecognizedPhrase
+{
+public:
+    // channel number of the concatenated results
+    int Channel = 0;
+    // The actual words recognized.
+    std::string Lexical;
+    // Inverse-text-normalized form of the recognized text. Abbreviations ("doctor smith" to "dr smith"), phone numbers, and other transformations are applied.
+    std::string ITN;
+    // The ITN form with profanity masking applied.
+    std::string MaskedITN;
+    // The display form of the recognized text. Added punctuation and capitalization are included.
+    std::string Display;
+};
+inline void from_json(const nlohmann::json& j, CombinedRecognizedPhrase& value) {
+    j.at("channel").get_to(value.Channel);
+    j.at("lexical").get_to(value.Lexical);
+    j.at("itn").get_to(value.ITN);
+    j.at("maskedITN").get_to(value.MaskedITN);
+    j.at("display").get_to(value.Display);
+}
+
+class WordEntry
+{
+public:
+    // the lexical form of the recognized form
+    std::string Word;
+    // offset in audio of this phrase in ticks (1 tick is 100 nanoseconds)
+    uint64_t OffsetInTicks = 0;
+    // audio duration of this phrase in ticks (1 tick is 100 nanoseconds)
+    uint64_t DurationInTicks = 0;
+    // confidence value for the recognition of the individual word
+    double Confidence = 0.0;
+};
+inline void from_json(const nlohmann::json& j, WordEntry& value) {
+    j.at("word").get_to(value.Word);
+    j.at("offsetInTicks").get_to(value.OffsetInTicks);
+    j.at("durationInTicks").get_to(value.DurationInTicks);
+    j.at("confidence").get_to(value.Confidence);
+}
+
+class NBestEntry
+{
+public:
+    // confidence value for the recognition of the whole phrase
+    double Confidence = 0.0;
+    // if `diarizationEnabled` is `true`, this is the identified speaker (1 or 2), otherwise this property is not present
+    int Speaker = 1;
+    // The actual words recognized
+    std::string Lexical;
+    // Inverse-text-normalized form of the recognized text. Abbreviations ("doctor smith" to "dr smith"), phone numbers, and other transformations are applied.
+    std::string ITN;
+    // The ITN form with profanity masking applied
+    std::string MaskedITN;
+    // The display form of the recognized text. Added punctuation and capitalization are included
+    std::string Display;
+    // if `wordLevelTimestampsEnabled` is `true`, there will be a result for each word of the phrase, otherwise this property is not present
+    std::vector<WordEntry> Words;
+};
+inline void from_json(const nlohmann::json& j, NBestEntry& value) {
+    j.at("confidence").get_to(value.Confidence);
+    if (j.contains("speaker")) j.at("speaker").get_to(value.Speaker);
+    j.at("lexical").get_to(value.Lexical);
+    j.at("itn").get_to(value.ITN);
+    j.at("maskedITN").get_to(value.MaskedITN);
+    j.at("display").get_to(value.Display);
+    if (j.contains("words")) j.at("words").get_to(value.Words);
+}
+
+class RecognizedPhrase
+{
+public:
+    // recognition state, e.g. "Success", "Failure"
+    std::string RecognitionStatus;
+    // channel number of the result
+    int Channel = 0;
+    // offset in audio of this phrase in ticks (1 tick is 100 nanoseconds)
+    uint64_t OffsetInTicks = 0;
+    // audio duration of this phrase in ticks (1 tick is 100 nanoseconds)
+    uint64_t DurationInTicks = 0;
+    // possible transcriptions of the current phrase with confidences
+    std::vector<NBestEntry> NBest;
+};
+inline void from_json(const nlohmann::json& j, RecognizedPhrase& value) {
+    j.at("recognitionStatus").get_to(value.RecognitionStatus);
+    j.at("channel").get_to(value.Channel);
+    j.at("offsetInTicks").get_to(value.OffsetInTicks);
+    j.at("durationInTicks").get_to(value.DurationInTicks);
+    j.at("nBest").get_to(value.NBest);
+}
+
+class TranscriptionResult
+{
+public:
+    // the sas url of a given contentUrl or the path relative to the root of a given container
+    std::string Source;
+    // total audio duration in ticks (1 tick is 100 nanoseconds)
+    uint64_t DurationInTicks = 0;
+    // concatenated results for simple access in single string for each channel
+    std::vector<CombinedRecognizedPhrase> CombinedRecognizedPhrases;
+    std::vector<RecognizedPhrase> RecognizedPhrases;
+};
+inline void from_json(const nlohmann::json& j, TranscriptionResult& value) {
+    j.at("source").get_to(value.Source);
+    j.at("durationInTicks").get_to(value.DurationInTicks);
+    j.at("combinedRecognizedPhrases").get_to(value.CombinedRecognizedPhrases);
+    j.at("recognizedPhrases").get_to(value.RecognizedPhrases);
+}
+
+// Parses a TranscriptionResult in place with a JsonCursor. Every object is parsed by a function specialized for its
+// class, which finds members by the length of the key before comparing it, reads the ticks straight from the
+// digits and skips the values of unknown and left out members without materializing them.
+class TranscriptionResultParser
+{
+public:
+    // Parses the body, which is unescaped in place. Returns false if it is malformed, then Error() tells why.
+    bool Parse(std::string& body, TranscriptionResult* result)
+    {
+        *result = TranscriptionResult();
+        m_cursor = JsonCursor(&body[0], &body[0] + body.size());
+        return Parse(result) && m_cursor.ExpectEnd();
+    }
+
+    const std::string& Error() const { return m_cursor.Error(); }
+
+private:
+    bool Parse(CombinedRecognizedPhrase* value)
+    {
+        uint32_t found = 0;
+        bool parsed = m_cursor.ParseObject([this, value, &found](std::string_view key)
+        {
+            switch (key.size())
+            {
+            case 3:
+                if (key == "itn")
+                {
+                    found |= 0x4;
+                    return m_cursor.ParseString(&value->ITN);
+                }
+                break;
+            case 7:
+                if (key == "channel")
+                {
+                    found |= 0x1;
+                    return m_cursor.ParseInteger(&value->Channel);
+                }
+                if (key == "lexical")
+                {
+                    found |= 0x2;
+                    return m_cursor.ParseString(&value->Lexical);
+                }
+                if (key == "display")
+                {
+                    found |= 0x10;
+                    return m_cursor.ParseString(&value->Display);
+                }
+                break;
+            case 9:
+                if (key == "maskedITN")
+                {
+                    found |= 0x8;
+                    return m_cursor.ParseString(&value->MaskedITN);
+                }
+                break;
+            }
+            return m_cursor.SkipValue();
+        });
+        return parsed && (found == 0x1f || MissingMember("CombinedRecognizedPhrase", found, { "channel", "lexical", "itn", "maskedITN", "display" }));
+    }
+
+    bool Parse(WordEntry* value)
+    {
+        uint32_t found = 0;
+        bool parsed = m_cursor.ParseObject([this, value, &found](std::string_view key)
+        {
+            switch (key.size())
+            {
+            case 4:
+                if (key == "word")
+                {
+                    found |= 0x1;
+                    return m_cursor.ParseString(&value->Word);
+                }
+                break;
+            case 10:
+                if (key == "confidence")
+                {
+                    found |= 0x8;
+                    return m_cursor.ParseDouble(&value->Confidence);
+                }
+                break;
+            case 13:
+                if (key == "offsetInTicks")
+                {
+                    found |= 0x2;
+                    return m_cursor.ParseUnsigned(&value->OffsetInTicks);
+                }
+                break;
+            case 15:
+                if (key == "durationInTicks")
+                {
+                    found |= 0x4;
+                    return m_cursor.ParseUnsigned(&value->DurationInTicks);
+                }
+                break;
+            }
+            return m_cursor.SkipValue();
+        });
+        return parsed && (found == 0xf || MissingMember("WordEntry", found, { "word", "offsetInTicks", "durationInTicks", "confidence" }));
+    }
+
+    bool Parse(NBestEntry* value)
+    {
+        uint32_t found = 0;
+        bool parsed = m_cursor.ParseObject([this, value, &found](std::string_view key)
+        {
+            switch (key.size())
+            {
+            case 3:
+                if (key == "itn")
+                {
+                    found |= 0x4;
+                    return m_cursor.ParseString(&value->ITN);
+                }
+                break;
+            case 5:
+                if (key == "words")
+                {
+                    return m_cursor.ParseArray([this, value]()
+                    {
+                        value->Words.emplace_back();
+                        return Parse(&value->Words.back());
+                    });
+                }
+                break;
+            case 7:
+                if (key == "speaker")
+                {
+                    return m_cursor.ParseInteger(&value->Speaker);
+                }
+                if (key == "lexical")
+                {
+                    found |= 0x2;
+                    return m_cursor.ParseString(&value->Lexical);
+                }
+                if (key == "display")
+                {
+                    found |= 0x10;
+                    return m_cursor.ParseString(&value->Display);
+                }
+                break;
+            case 9:
+                if (key == "maskedITN")
+                {
+                    found |= 0x8;
+                    return m_cursor.ParseString(&value->MaskedITN);
+                }
+                break;
+            case 10:
+                if (key == "confidence")
+                {
+                    found |= 0x1;
+                    return m_cursor.ParseDouble(&value->Confidence);
+                }
+                break;
+            }
+            return m_cursor.SkipValue();
+        });
+        return parsed && (found == 0x1f || MissingMember("NBestEntry", found, { "confidence", "lexical", "itn", "maskedITN", "display" }));
+    }
+
+    bool Parse(RecognizedPhrase* value)
+    {
+        uint32_t found = 0;
+        bool parsed = m_cursor.ParseObject([this, value, &found](std::string_view key)
+        {
+            switch (key.size())
+            {
+            case 5:
+                if (key == "nBest")
+                {
+                    found |= 0x10;
+                    return m_cursor.ParseArray([this, value]()
+                    {
+                        value->NBest.emplace_back();
+                        return Parse(&value->NBest.back());
+                    });
+                }
+                break;
+            case 7:
+                if (key == "channel")
+                {
+                    found |= 0x2;
+                    return m_cursor.ParseInteger(&value->Channel);
+                }
+                break;
+            case 13:
+                if (key == "offsetInTicks")
+                {
+                    found |= 0x4;
+                    return m_cursor.ParseUnsigned(&value->OffsetInTicks);
+                }
+                break;
+            case 15:
+                if (key == "durationInTicks")
+                {
+                    found |= 0x8;
+                    return m_cursor.ParseUnsigned(&value->DurationInTicks);
+                }
+                break;
+            case 17:
+                if (key == "recognitionStatus")
+                {
+                    found |= 0x1;
+                    return m_cursor.ParseString(&value->RecognitionStatus);
+                }
+                break;
+            }
+            return m_cursor.SkipValue();
+        });
+        return parsed && (found == 0x1f || MissingMember("RecognizedPhrase", found, { "recognitionStatus", "channel", "offsetInTicks", "durationInTicks", "nBest" }));
+    }
+
+    bool Parse(TranscriptionResult* value)
+    {
+        uint32_t found = 0;
+        bool parsed = m_cursor.ParseObject([this, value, &found](std::string_view key)
+        {
+            switch (key.size())
+            {
+            case 6:
+                if (key == "source")
+                {
+                    found |= 0x1;
+                    return m_cursor.ParseString(&value->Source);
+                }
+                break;
+            case 15:
+                if (key == "durationInTicks")
+                {
+                    found |= 0x2;
+                    return m_cursor.ParseUnsigned(&value->DurationInTicks);
+                }
+                break;
+            case 17:
+                if (key == "recognizedPhrases")
+                {
+                    found |= 0x8;
+                    return m_cursor.ParseArray([this, value]()
+                    {
+                        value->RecognizedPhrases.emplace_back();
+                        return Parse(&value->RecognizedPhrases.back());
+                    });
+                }
+                break;
+            case 25:
+                if (key == "combinedRecognizedPhrases")
+                {
+                    found |= 0x4;
+                    return m_cursor.ParseArray([this, value]()
+                    {
+                        value->CombinedRecognizedPhrases.emplace_back();
+                        return Parse(&value->CombinedRecognizedPhrases.back());
+                    });
+                }
+                break;
+            }
+            return m_cursor.SkipValue();
+        });
+        return parsed && (found == 0xf || MissingMember("TranscriptionResult", found, { "source", "durationInTicks", "combinedRecognizedPhrases", "recognizedPhrases" }));
+    }
+
+    bool MissingMember(const char* className, uint32_t found, std::initializer_list<const char*> required)
+    {
+        for (auto key : required)
+        {
+            if ((found & 1) == 0)
+            {
+                return m_cursor.Fail(std::string("Missing member ") + key + " of " + className + ".");
+            }
+            found >>= 1;
+        }
+        return true;
+    }
+
+    JsonCursor m_cursor;
+};
@@ -0,0 +1,256 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <Windows.h>
+#include <bcrypt.h>
+
+#include <cpprest/http_client.h>
+#include <cpprest/http_listener.h>
+#include <nlohmann/json.hpp>
+
+#pragma comment(lib, "bcrypt.lib")
+
+// Signature of a webhook notification: the base64 encoded HMAC-SHA256 of the body, keyed with the secret given when
+// registering the webhook.
+inline std::string ComputeWebhookSignature(const std::string& body, const std::string& secret)
+{
+    BCRYPT_ALG_HANDLE algorithm = nullptr;
+    BCRYPT_HASH_HANDLE hash = nullptr;
+    std::vector<unsigned char> digest(32);
+    bool computed = BCRYPT_SUCCESS(BCryptOpenAlgorithmProvider(&algorithm, BCRYPT_SHA256_ALGORITHM, nullptr, BCRYPT_ALG_HANDLE_HMAC_FLAG))
+        && BCRYPT_SUCCESS(BCryptCreateHash(algorithm, &hash, nullptr, 0, reinterpret_cast<PUCHAR>(const_cast<char*>(secret.data())),
+            static_cast<ULONG>(secret.size()), 0))
+        && BCRYPT_SUCCESS(BCryptHashData(hash, reinterpret_cast<PUCHAR>(const_cast<char*>(body.data())), static_cast<ULONG>(body.size()), 0))
+        && BCRYPT_SUCCESS(BCryptFinishHash(hash, digest.data(), static_cast<ULONG>(digest.size()), 0));
+    if (hash)
+    {
+        BCryptDestroyHash(hash);
+    }
+    if (algorithm)
+    {
+        BCryptCloseAlgorithmProvider(algorithm, 0);
+    }
+    if (!computed)
+    {
+        throw std::runtime_error("Computing the webhook signature failed.");
+    }
+    return utility::conversions::to_utf8string(utility::conversions::to_base64(digest));
+}
+
+// The id of a transcription, the last segment of its URL. The notifications link the transcription with the URL of
+// the v3 API, which differs from the v2 location the client polls.
+inline std::string TranscriptionIdFromUrl(const std::string& url)
+{
+    auto end = url.find_last_not_of('/');
+    if (end == std::string::npos)
+    {
+        return std::string();
+    }
+    auto slash = url.rfind('/', end);
+    auto start = slash == std::string::npos ? 0 : slash + 1;
+    return url.substr(start, end + 1 - start);
+}
+
+// Receives the webhook notifications of the batch transcription service, so the client learns that a transcription
+// completed when it does, instead of polling its status until then.
+//
+// The receiver listens on an embedded HTTP listener and registers a webhook for the transcriptionCompletion event
+// with the URL under which the service reaches the listener, e.g. through a reverse proxy. The service validates
+// the URL with a challenge when the webhook is registered, and signs every notification with the secret, so
+// notifications from anyone else are rejected. The webhook is deleted again when the receiver is destroyed.
+//
+// Like the MockTranscriptionService, the listener needs a URL reservation when not running as administrator.
+class WebhookReceiver
+{
+public:
+    // Called on a listener thread with the URL of the transcription that completed, succeeded or failed.
+    using CompletionHandler = std::function<void(const std::string& transcriptionUrl)>;
+
+    struct Statistics
+    {
+        size_t Notifications = 0;   // transcriptionCompletion notifications accepted.
+        size_t Challenges = 0;
+        size_t Rejected = 0;        // requests with a missing or wrong signature, or a malformed body.
+    };
+
+    WebhookReceiver(const utility::string_t& listenUrl, const std::string& secret, CompletionHandler onCompletion) :
+        m_listener(web::uri(listenUrl)),
+        m_secret(secret),
+        m_onCompletion(std::move(onCompletion))
+    {
+        m_listener.support([this](web::http::http_request request) { Handle(request); });
+        m_listener.open().wait();
+    }
+
+    ~WebhookReceiver()
+    {
+        try
+        {
+            Unregister();
+        }
+        catch (const std::exception&)
+        {
+            // The service deletes webhooks that keep failing on its own.
+        }
+        m_listener.close().wait();
+    }
+
+    // Registers the webhook with the service at webhooksUrl, e.g.
+    // https://westus.api.cognitive.microsoft.com/speechtotext/v3.0/webhooks, to notify callbackUrl. Throws if the
+    // service rejects it, e.g. because the challenge did not reach the listener.
+    void Register(const utility::string_t& webhooksUrl, const utility::string_t& callbackUrl, const utility::string_t& subscriptionKey)
+    {
+        nlohmann::json definition = {
+            { "displayName", "from-blob client" },
+            { "description", "Notifies the client of completed transcriptions." },
+            { "webUrl", utility::conversions::to_utf8string(callbackUrl) },
+            { "events", { { "transcriptionCompletion", true } } },
+            { "properties", { { "secret", m_secret } } }
+        };
+
+        web::http::client::http_client client(webhooksUrl);
+        const int maxAttempts = 4;
+        for (int attempt = 1; ; attempt++)
+        {
+            web::http::http_request request(web::http::methods::POST);
+            request.headers().add(U("Ocp-Apim-Subscription-Key"), subscriptionKey);
+            request.set_body(definition.dump(), "application/json");
+
+            auto response = client.request(request).get();
+            if (response.status_code() == web::http::status_codes::Created)
+            {
+                m_webhookLocation = response.headers()[U("Location")];
+                m_subscriptionKey = subscriptionKey;
+                return;
+            }
+            bool retry = response.status_code() >= 500 || response.status_code() == web::http::status_codes::TooManyRequests;
+            if (!retry || attempt == maxAttempts)
+            {
+                throw std::runtime_error("Registering the webhook failed with http code " + std::to_string(response.status_code()) + ": "
+                    + response.extract_utf8string(true).get());
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(500 << attempt));
+        }
+    }
+
+    // Deletes the registered webhook.
+    void Unregister()
+    {
+        if (m_webhookLocation.empty())
+        {
+            return;
+        }
+        web::uri location(m_webhookLocation);
+        web::http::client::http_client client(location.authority());
+        web::http::http_request request(web::http::methods::DEL);
+        request.set_request_uri(location.resource());
+        request.headers().add(U("Ocp-Apim-Subscription-Key"), m_subscriptionKey);
+        m_webhookLocation.clear();
+        client.request(request).wait();
+    }
+
+    Statistics GetStatistics() const
+    {
+        Statistics statistics;
+        statistics.Notifications = m_notifications;
+        statistics.Challenges = m_challenges;
+        statistics.Rejected = m_rejected;
+        return statistics;
+    }
+
+private:
+    void Handle(web::http::http_request request)
+    {
+        auto event = Header(request.headers(), U("X-MicrosoftSpeechServices-Event"));
+        if (event == "challenge")
+        {
+            // Answered with the token, which proves that the URL leads to this receiver.
+            auto query = web::uri::split_query(request.request_uri().query());
+            auto token = query.find(U("validationToken"));
+            if (token == query.end())
+            {
+                m_rejected++;
+                request.reply(web::http::status_codes::BadRequest);
+                return;
+            }
+            m_challenges++;
+            request.reply(web::http::status_codes::OK, utility::conversions::to_utf8string(token->second), "text/plain");
+            return;
+        }
+
+        auto body = request.extract_utf8string(true).get();
+        if (!m_secret.empty() && !SignatureMatches(ComputeWebhookSignature(body, m_secret), Header(request.headers(), U("X-MicrosoftSpeechServices-Signature"))))
+        {
+            m_rejected++;
+            request.reply(web::http::status_codes::Unauthorized);
+            return;
+        }
+        if (_stricmp(event.c_str(), "TranscriptionCompletion") != 0)
+        {
+            // Ping, and events of other kinds.
+            request.reply(web::http::status_codes::OK);
+            return;
+        }
+
+        std::string transcriptionUrl;
+        try
+        {
+            transcriptionUrl = nlohmann::json::parse(body).value("self", "");
+        }
+        catch (const std::exception&)
+        {
+        }
+        if (transcriptionUrl.empty())
+        {
+            m_rejected++;
+            request.reply(web::http::status_codes::BadRequest);
+            return;
+        }
+
+        // Acknowledged first, so the service does not wait for the client, nor redeliver if it is slow.
+        m_notifications++;
+        request.reply(web::http::status_codes::OK);
+        m_onCompletion(transcriptionUrl);
+    }
+
+    static std::string Header(const web::http::http_headers& headers, const utility::string_t& name)
+    {
+        auto it = headers.find(name);
+        return it == headers.end() ? std::string() : utility::conversions::to_utf8string(it->second);
+    }
+
+    // Compares in constant time, so the time of a rejection does not tell how much of a forged signature matched.
+    static bool SignatureMatches(const std::string& expected, const std::string& actual)
+    {
+        if (expected.size() != actual.size())
+        {
+            return false;
+        }
+        unsigned char difference = 0;
+        for (size_t i = 0; i < expected.size(); i++)
+        {
+            difference |= static_cast<unsigned char>(expected[i] ^ actual[i]);
+        }
+        return difference == 0;
+    }
+
+    web::http::experimental::listener::http_listener m_listener;
+    std::string m_secret;
+    CompletionHandler m_onCompletion;
+    utility::string_t m_webhookLocation;
+    utility::string_t m_subscriptionKey;
+    std::atomic<size_t> m_notifications{ 0 };
+    std::atomic<size_t> m_challenges{ 0 };
+    std::atomic<size_t> m_rejected{ 0 };
+};
@@ -0,0 +1,86 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Runs tasks on a fixed number of threads, e.g. the downloads of transcription results, so the thread that posts
+// them, like the event loop of the TranscriptionPoller, never waits for one. Tasks start in the order they were
+// posted. The destructor waits for all tasks.
+class WorkerPool
+{
+public:
+    explicit WorkerPool(size_t threadCount)
+    {
+        for (size_t i = 0; i < threadCount; i++)
+        {
+            m_threads.emplace_back(&WorkerPool::Run, this);
+        }
+    }
+
+    ~WorkerPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+            m_changed.notify_all();
+        }
+        for (auto& thread : m_threads)
+        {
+            thread.join();
+        }
+    }
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    void Post(std::function<void()> task)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_tasks.push_back(std::move(task));
+        m_changed.notify_all();
+    }
+
+    // Blocks until every task posted so far has completed.
+    void Wait()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_changed.wait(lock, [this]() { return m_tasks.empty() && m_running == 0; });
+    }
+
+private:
+    void Run()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (true)
+        {
+            m_changed.wait(lock, [this]() { return !m_tasks.empty() || m_stopping; });
+            if (m_tasks.empty())
+            {
+                return;
+            }
+            auto task = std::move(m_tasks.front());
+            m_tasks.pop_front();
+            m_running++;
+            lock.unlock();
+            task();
+            lock.lock();
+            m_running--;
+            m_changed.notify_all();
+        }
+    }
+
+    std::mutex m_mutex;
+    std::condition_variable m_changed;
+    std::deque<std::function<void()>> m_tasks;
+    size_t m_running = 0;
+    bool m_stopping = false;
+    std::vector<std::thread> m_threads;
+};
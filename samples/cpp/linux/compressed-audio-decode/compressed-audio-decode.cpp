@@ -0,0 +1,461 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <future>
+#include <iomanip>
+#include <iostream> // cin, cout
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <speechapi_cxx.h>
+#include "gstreamer_modules.h"
+#include "gst_pcm_decoder.h"
+#include "pcm_cache.h"
+
+using namespace Microsoft::CognitiveServices::Speech;
+using namespace Microsoft::CognitiveServices::Speech::Audio;
+
+static std::mutex outputMutex;
+
+// With lazy registration only the plugins of the codecs in use are registered, when the first file of a codec is decoded.
+static bool lazyRegistration = true;
+
+// Decoded PCM of earlier runs, or null if no cache directory is given.
+static std::unique_ptr<PcmCache> pcmCache;
+
+// Startup measurements, from the start of main.
+static std::chrono::steady_clock::time_point processStart;
+static std::once_flag firstPcmFlag;
+static double firstPcmMilliseconds = 0;
+
+static double MillisecondsSinceStart()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - processStart).count();
+}
+
+// Resident memory of the process in megabytes.
+static double ResidentMegabytes()
+{
+    long pages = 0, residentPages = 0;
+    std::ifstream statm("/proc/self/statm");
+    statm >> pages >> residentPages;
+    return residentPages * (sysconf(_SC_PAGESIZE) / 1048576.0);
+}
+
+static double PeakResidentMegabytes()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss / 1024.0;
+}
+
+static void RegisterPlugins(Codec codec)
+{
+    if (!lazyRegistration)
+    {
+        return;
+    }
+    AudioStreamContainerFormat format;
+    switch (codec)
+    {
+    case Codec::Mp3: format = AudioStreamContainerFormat::MP3; break;
+    case Codec::Opus: format = AudioStreamContainerFormat::OGG_OPUS; break;
+    case Codec::Flac: format = AudioStreamContainerFormat::FLAC; break;
+    case Codec::Alaw: case Codec::WaveAlaw: format = AudioStreamContainerFormat::ALAW; break;
+    default: format = AudioStreamContainerFormat::MULAW; break;
+    }
+    Microsoft::CognitiveServices::Speech::Impl::spx_gst_init_for_format(static_cast<int>(format));
+}
+
+static void OnFirstPcm()
+{
+    std::call_once(firstPcmFlag, []() { firstPcmMilliseconds = MillisecondsSinceStart(); });
+}
+
+// CPU time used by the calling thread, which excludes the time spent waiting for the consumer of the audio.
+static double ThreadCpuSeconds()
+{
+    struct timespec time;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+    return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+// Runs work for each file on workerCount threads, each taking the next file when it is done with the previous one.
+static void RunOnThreadPool(size_t fileCount, size_t workerCount, const std::function<void(size_t)>& work)
+{
+    std::atomic<size_t> next(0);
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < workerCount && i < fileCount; i++)
+    {
+        workers.emplace_back([fileCount, &next, &work]()
+        {
+            for (size_t file = next++; file < fileCount; file = next++)
+            {
+                work(file);
+            }
+        });
+    }
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+}
+
+// Decodes the file on the calling thread and feeds the PCM into a push stream while it is being recognized,
+// so the service receives uncompressed audio and no decoding happens inside the Speech SDK.
+void recognizeDecodedFile(const std::string& compressedFileName)
+{
+    Codec codec;
+    if (!GetCodecFromFileName(compressedFileName, &codec))
+    {
+        std::lock_guard<std::mutex> lock(outputMutex);
+        std::cout << compressedFileName << ": unsupported format." << std::endl;
+        return;
+    }
+
+    // Creates an instance of a speech config with specified subscription key and service region.
+    // Replace with your own subscription key and service region (e.g., "westus").
+    auto config = SpeechConfig::FromSubscription("YourSubscriptionKey", "YourServiceRegion");
+
+    // PCM cached by an earlier run is read straight from the cache, and the file is not decoded again.
+    std::string cacheKey = pcmCache ? PcmCache::GetKey(compressedFileName, CodecName(codec)) : std::string();
+    MappedPcm* cachedPcm = cacheKey.empty() ? nullptr : pcmCache->Open(cacheKey);
+    size_t cachedPcmSize = cachedPcm != nullptr ? cachedPcm->Size() : 0;
+
+    // Both streams carry the default input format, 16kHz 16bit mono PCM, which is what the decoder produces.
+    std::shared_ptr<PushAudioInputStream> pushStream;
+    std::shared_ptr<AudioConfig> audioConfig;
+    if (cachedPcm != nullptr)
+    {
+        audioConfig = AudioConfig::FromStreamInput(AudioInputStream::CreatePullStream(
+            AudioStreamFormat::GetWaveFormatPCM(DecodedSampleRate, 16, 1),
+            cachedPcm,
+            MappedPcm::Read,
+            MappedPcm::Close));
+    }
+    else
+    {
+        pushStream = AudioInputStream::CreatePushStream();
+        audioConfig = AudioConfig::FromStreamInput(pushStream);
+    }
+    auto recognizer = SpeechRecognizer::FromConfig(config, audioConfig);
+
+    // promise for synchronization of recognition end.
+    std::promise<void> recognitionEnd;
+    std::once_flag recognitionEndFlag;
+    auto notifyEnd = [&recognitionEnd, &recognitionEndFlag]()
+    {
+        std::call_once(recognitionEndFlag, [&recognitionEnd]() { recognitionEnd.set_value(); });
+    };
+
+    recognizer->Recognized.Connect([&compressedFileName](const SpeechRecognitionEventArgs& e)
+    {
+        if (e.Result->Reason == ResultReason::RecognizedSpeech)
+        {
+            std::lock_guard<std::mutex> lock(outputMutex);
+            std::cout << compressedFileName << ": RECOGNIZED: Text=" << e.Result->Text << std::endl;
+        }
+    });
+
+    recognizer->Canceled.Connect([&compressedFileName, &notifyEnd](const SpeechRecognitionCanceledEventArgs& e)
+    {
+        if (e.Reason == CancellationReason::Error)
+        {
+            std::lock_guard<std::mutex> lock(outputMutex);
+            std::cout << compressedFileName << ": CANCELED: ErrorCode=" << (int)e.ErrorCode << std::endl;
+            std::cout << compressedFileName << ": CANCELED: ErrorDetails=" << e.ErrorDetails << std::endl;
+        }
+        notifyEnd();
+    });
+
+    recognizer->SessionStopped.Connect([&notifyEnd](const SessionEventArgs&)
+    {
+        notifyEnd();
+    });
+
+    recognizer->StartContinuousRecognitionAsync().get();
+
+    if (cachedPcm != nullptr)
+    {
+        recognitionEnd.get_future().get();
+        recognizer->StopContinuousRecognitionAsync().get();
+
+        std::lock_guard<std::mutex> lock(outputMutex);
+        std::cout << compressedFileName << ": read " << cachedPcmSize / (DecodedSampleRate * 2.0) << " seconds of PCM from the cache." << std::endl;
+        return;
+    }
+
+    // While decoding, the PCM is also written to a new cache entry, which is added when the file is decoded completely.
+    auto cacheWriter = cacheKey.empty() ? nullptr : pcmCache->Insert(cacheKey);
+    uint64_t pcmBytes = 0;
+    std::string error;
+    auto cpuStart = ThreadCpuSeconds();
+    RegisterPlugins(codec);
+    bool decoded = DecodeToPcm(compressedFileName, codec, [&pushStream, &cacheWriter, &pcmBytes](const uint8_t* data, size_t size)
+    {
+        OnFirstPcm();
+        pushStream->Write(const_cast<uint8_t*>(data), static_cast<uint32_t>(size));
+        if (cacheWriter)
+        {
+            cacheWriter->Write(data, size);
+        }
+        pcmBytes += size;
+    }, &error);
+    auto cpuSeconds = ThreadCpuSeconds() - cpuStart;
+    if (decoded && cacheWriter)
+    {
+        cacheWriter->Commit();
+    }
+
+    // Closing the stream signals the end of the audio, recognition stops after the remaining audio is processed.
+    pushStream->Close();
+    recognitionEnd.get_future().get();
+    recognizer->StopContinuousRecognitionAsync().get();
+
+    std::lock_guard<std::mutex> lock(outputMutex);
+    if (!decoded)
+    {
+        std::cout << compressedFileName << ": decoding failed: " << error << std::endl;
+    }
+    std::cout << compressedFileName << ": decoded " << CodecName(codec) << " to " << pcmBytes / (DecodedSampleRate * 2.0)
+        << " seconds of PCM using " << cpuSeconds << " CPU seconds." << std::endl;
+}
+
+void recognizeDecodedFiles(const std::vector<std::string>& compressedFileNames, size_t workerCount)
+{
+    RunOnThreadPool(compressedFileNames.size(), workerCount, [&compressedFileNames](size_t file)
+    {
+        recognizeDecodedFile(compressedFileNames[file]);
+    });
+}
+
+struct CodecStatistics
+{
+    size_t Files = 0;
+    size_t Failures = 0;
+    uint64_t CompressedBytes = 0;
+    double AudioSeconds = 0;
+    double CpuSeconds = 0;
+};
+
+// Decodes all files with workerCount threads, discarding the PCM, and returns the statistics per codec.
+static std::vector<CodecStatistics> benchmarkDecode(const std::vector<std::string>& compressedFileNames, size_t workerCount, double* wallSeconds)
+{
+    std::vector<CodecStatistics> statistics((size_t)Codec::Count);
+    std::mutex statisticsMutex;
+    auto start = std::chrono::steady_clock::now();
+
+    RunOnThreadPool(compressedFileNames.size(), workerCount, [&](size_t file)
+    {
+        const auto& fileName = compressedFileNames[file];
+        Codec codec;
+        if (!GetCodecFromFileName(fileName, &codec))
+        {
+            return;
+        }
+
+        uint64_t pcmBytes = 0;
+        std::string error;
+        auto cpuStart = ThreadCpuSeconds();
+        RegisterPlugins(codec);
+        bool decoded = DecodeToPcm(fileName, codec, [&pcmBytes](const uint8_t*, size_t size) { OnFirstPcm(); pcmBytes += size; }, &error);
+        auto cpuSeconds = ThreadCpuSeconds() - cpuStart;
+
+        std::ifstream compressedFile(fileName, std::ios::binary | std::ios::ate);
+        // A-law and mu-law in wave files are reported together with the headerless ones.
+        auto key = codec == Codec::WaveAlaw ? Codec::Alaw : codec == Codec::WaveMulaw ? Codec::Mulaw : codec;
+
+        std::lock_guard<std::mutex> lock(statisticsMutex);
+        auto& codecStatistics = statistics[(size_t)key];
+        codecStatistics.Files++;
+        codecStatistics.Failures += decoded ? 0 : 1;
+        codecStatistics.CompressedBytes += static_cast<uint64_t>(std::max<std::streamoff>(compressedFile.tellg(), 0));
+        codecStatistics.AudioSeconds += pcmBytes / (DecodedSampleRate * 2.0);
+        codecStatistics.CpuSeconds += cpuSeconds;
+    });
+
+    *wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return statistics;
+}
+
+// Reports how fast each codec decodes on one core, and how the throughput scales with the number of threads.
+// Audio seconds per CPU second is the real time factor of decoding on a single core: divided by the real time
+// factor of the service it tells whether decoding on the client is cheap enough, or compressed audio should be sent.
+void benchmarkDecoding(const std::vector<std::string>& compressedFileNames, std::vector<size_t> workerCounts)
+{
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "Hardware threads: " << std::thread::hardware_concurrency() << std::endl;
+
+    double firstThroughput = 0;
+    for (auto workerCount : workerCounts)
+    {
+        double wallSeconds = 0;
+        auto statistics = benchmarkDecode(compressedFileNames, workerCount, &wallSeconds);
+
+        std::cout << std::endl << "Workers: " << workerCount << ", wall seconds: " << wallSeconds << std::endl;
+        std::cout << std::left << std::setw(8) << "codec" << std::right
+            << std::setw(8) << "files" << std::setw(10) << "failures"
+            << std::setw(14) << "compressedMB" << std::setw(14) << "audioSeconds"
+            << std::setw(12) << "cpuSeconds" << std::setw(18) << "audioPerCpuSecond" << std::endl;
+
+        double totalAudioSeconds = 0;
+        for (size_t codec = 0; codec < statistics.size(); codec++)
+        {
+            const auto& s = statistics[codec];
+            if (s.Files == 0)
+            {
+                continue;
+            }
+            totalAudioSeconds += s.AudioSeconds;
+            std::cout << std::left << std::setw(8) << CodecName((Codec)codec) << std::right
+                << std::setw(8) << s.Files << std::setw(10) << s.Failures
+                << std::setw(14) << s.CompressedBytes / 1e6 << std::setw(14) << s.AudioSeconds
+                << std::setw(12) << s.CpuSeconds << std::setw(18) << (s.CpuSeconds > 0 ? s.AudioSeconds / s.CpuSeconds : 0.0) << std::endl;
+        }
+
+        auto throughput = wallSeconds > 0 ? totalAudioSeconds / wallSeconds : 0;
+        if (firstThroughput == 0)
+        {
+            firstThroughput = throughput / workerCount;
+        }
+        std::cout << "Audio seconds decoded per wall second: " << throughput
+            << " (" << throughput / workerCount << " per worker, scaling "
+            << (firstThroughput > 0 ? throughput / firstThroughput : 0.0) << "x of one worker)" << std::endl;
+    }
+}
+
+static void PrintUsage()
+{
+    std::cout << "Usage: ./compressed-audio-decode [--workers <count>] [--manifest <file with one filename per line>] [<filename> ...]" << std::endl;
+    std::cout << "       ./compressed-audio-decode --benchmark [--workers <count>] [--manifest <file with one filename per line>] [<filename> ...]" << std::endl;
+    std::cout << "Options: --cache <directory> [--cache-size <megabytes>] (default 1024) reuses the PCM decoded by earlier runs" << std::endl;
+    std::cout << "         --registration lazy|eager (default lazy) registers the GStreamer plugins of the codecs in use on first use, or all at startup" << std::endl;
+    std::cout << "Supported files: .mp3, .opus/.ogg (Ogg Opus), .flac, .alaw/.mulaw (headerless, 8kHz mono), .wav (A-law or mu-law)" << std::endl;
+}
+
+int main(int argc, char **argv) {
+    processStart = std::chrono::steady_clock::now();
+    setlocale(LC_ALL, "");
+
+    bool benchmark = false;
+    size_t workerCount = 0;
+    std::string cacheDirectory;
+    uint64_t cacheMegabytes = 1024;
+    std::vector<std::string> compressedFileNames;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--benchmark")
+        {
+            benchmark = true;
+        }
+        else if (arg == "--cache" && i + 1 < argc)
+        {
+            cacheDirectory = argv[++i];
+        }
+        else if (arg == "--cache-size" && i + 1 < argc)
+        {
+            cacheMegabytes = std::max(1, atoi(argv[++i]));
+        }
+        else if (arg == "--registration" && i + 1 < argc && (std::string(argv[i + 1]) == "lazy" || std::string(argv[i + 1]) == "eager"))
+        {
+            lazyRegistration = std::string(argv[++i]) == "lazy";
+        }
+        else if (arg == "--workers" && i + 1 < argc)
+        {
+            workerCount = std::max(1, atoi(argv[++i]));
+        }
+        else if (arg == "--manifest" && i + 1 < argc)
+        {
+            std::ifstream manifest(argv[++i]);
+            std::string line;
+            while (std::getline(manifest, line))
+            {
+                if (!line.empty())
+                {
+                    compressedFileNames.push_back(line);
+                }
+            }
+        }
+        else if (arg.compare(0, 2, "--") == 0)
+        {
+            // An unknown option, one without its value, or --registration with neither lazy nor eager.
+            std::cout << "Invalid option: " << arg << std::endl;
+            PrintUsage();
+            return 1;
+        }
+        else
+        {
+            compressedFileNames.push_back(arg);
+        }
+    }
+
+    if (compressedFileNames.empty())
+    {
+        PrintUsage();
+        return 0;
+    }
+
+    // Registers the decoder plugins. With a shared GStreamer installation they are found in the plugin directory,
+    // with statically linked plugins the wrapper registers them, all now or each codec's when it is first used.
+    gst_init(NULL, NULL);
+    if (!lazyRegistration)
+    {
+        Microsoft::CognitiveServices::Speech::Impl::spx_gst_init();
+    }
+    auto initMilliseconds = MillisecondsSinceStart();
+    auto initResidentMegabytes = ResidentMegabytes();
+    auto printStartup = [initMilliseconds, initResidentMegabytes]()
+    {
+        std::cout << std::fixed << std::setprecision(2) << std::endl
+            << "Startup with " << (lazyRegistration ? "lazy" : "eager") << " registration: initialized after " << initMilliseconds
+            << " ms with " << initResidentMegabytes << " MB resident, first PCM after " << firstPcmMilliseconds
+            << " ms, peak resident memory " << PeakResidentMegabytes() << " MB" << std::endl;
+    };
+
+    if (benchmark)
+    {
+        // Without a worker count the benchmark runs with 1, 2, 4, ... threads up to the number of hardware threads.
+        std::vector<size_t> workerCounts;
+        if (workerCount != 0)
+        {
+            workerCounts.push_back(workerCount);
+        }
+        else
+        {
+            size_t hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+            for (size_t count = 1; count < hardwareThreads; count *= 2)
+            {
+                workerCounts.push_back(count);
+            }
+            workerCounts.push_back(hardwareThreads);
+        }
+        benchmarkDecoding(compressedFileNames, workerCounts);
+        printStartup();
+        return 0;
+    }
+
+    if (!cacheDirectory.empty())
+    {
+        pcmCache.reset(new PcmCache(cacheDirectory, cacheMegabytes * 1024 * 1024));
+    }
+
+    recognizeDecodedFiles(compressedFileNames, workerCount != 0 ? workerCount : 4);
+    printStartup();
+    if (pcmCache)
+    {
+        const auto& statistics = pcmCache->GetStatistics();
+        std::cout << "PCM cache: " << statistics.Hits << " hits, " << statistics.Misses << " misses, "
+            << statistics.Inserts << " inserts, " << statistics.Evictions << " evictions" << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,158 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#pragma once
+
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <gst/gst.h>
+#include <gst/app/gstappsink.h>
+
+// Sample rate of the decoded audio, which is 16bit mono PCM, the default input format of the Speech SDK.
+static const int DecodedSampleRate = 16000;
+
+enum class Codec { Mp3, Opus, Flac, Alaw, Mulaw, WaveAlaw, WaveMulaw, Count };
+
+static const char* CodecName(Codec codec)
+{
+    switch (codec)
+    {
+    case Codec::Mp3: return "mp3";
+    case Codec::Opus: return "opus";
+    case Codec::Flac: return "flac";
+    case Codec::Alaw: case Codec::WaveAlaw: return "alaw";
+    case Codec::Mulaw: case Codec::WaveMulaw: return "mulaw";
+    default: return "unknown";
+    }
+}
+
+static bool EndsWith(const std::string& text, const std::string& suffix)
+{
+    return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// Gets the codec from the file extension. For wave files the format tag of the canonical header tells A-law from mu-law.
+static bool GetCodecFromFileName(const std::string& fileName, Codec* codec)
+{
+    if (EndsWith(fileName, ".mp3")) { *codec = Codec::Mp3; return true; }
+    if (EndsWith(fileName, ".opus") || EndsWith(fileName, ".ogg")) { *codec = Codec::Opus; return true; }
+    if (EndsWith(fileName, ".flac")) { *codec = Codec::Flac; return true; }
+    if (EndsWith(fileName, ".alaw")) { *codec = Codec::Alaw; return true; }
+    if (EndsWith(fileName, ".mulaw")) { *codec = Codec::Mulaw; return true; }
+    if (EndsWith(fileName, ".wav"))
+    {
+        uint8_t header[22] = {};
+        FILE* file = fopen(fileName.c_str(), "rb");
+        auto read = file != NULL ? fread(header, 1, sizeof(header), file) : 0;
+        if (file != NULL)
+        {
+            fclose(file);
+        }
+        if (read == sizeof(header) && memcmp(header, "RIFF", 4) == 0 && (header[20] == 6 || header[20] == 7))
+        {
+            *codec = header[20] == 6 ? Codec::WaveAlaw : Codec::WaveMulaw;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Gets the pipeline decoding a file of the given codec to 16kHz 16bit mono PCM.
+// Each codec has an explicit chain of elements instead of decodebin, so no time is spent on type finding and
+// the elements are the ones the GStreamer wrapper registers: mpg123, opus, flac, alaw and mulaw.
+// The appsink does not synchronize to the clock, so files are decoded as fast as the CPU allows,
+// and holds a few buffers only, which throttles the decoder to the speed of the consumer.
+static std::string GetDecodePipeline(Codec codec)
+{
+    std::string decoder;
+    switch (codec)
+    {
+    case Codec::Mp3: decoder = "mpegaudioparse ! mpg123audiodec"; break;
+    case Codec::Opus: decoder = "oggdemux ! opusdec"; break;
+    case Codec::Flac: decoder = "flacparse ! flacdec"; break;
+    case Codec::Alaw: decoder = "capsfilter caps=audio/x-alaw,rate=8000,channels=1 ! alawdec"; break;
+    case Codec::Mulaw: decoder = "capsfilter caps=audio/x-mulaw,rate=8000,channels=1 ! mulawdec"; break;
+    case Codec::WaveAlaw: decoder = "wavparse ! alawdec"; break;
+    case Codec::WaveMulaw: decoder = "wavparse ! mulawdec"; break;
+    default: return std::string();
+    }
+    return "filesrc name=src ! " + decoder + " ! audioconvert ! audioresample ! "
+        "audio/x-raw,format=S16LE,rate=" + std::to_string(DecodedSampleRate) + ",channels=1 ! "
+        "appsink name=sink sync=false max-buffers=16";
+}
+
+// Decodes a file to 16kHz 16bit mono PCM on the calling thread, handing each decoded buffer to onPcm as soon as
+// it is available. gst_init must have been called before.
+// Returns false and sets error if the file cannot be decoded.
+static bool DecodeToPcm(const std::string& fileName, Codec codec, const std::function<void(const uint8_t*, size_t)>& onPcm, std::string* error)
+{
+    GError* gerror = NULL;
+    GstElement* pipeline = gst_parse_launch(GetDecodePipeline(codec).c_str(), &gerror);
+    if (pipeline == NULL || gerror != NULL)
+    {
+        *error = gerror != NULL ? gerror->message : "Failed to create the decode pipeline.";
+        if (gerror != NULL)
+        {
+            g_error_free(gerror);
+        }
+        if (pipeline != NULL)
+        {
+            gst_object_unref(pipeline);
+        }
+        return false;
+    }
+
+    // The location is set as a property, so file names need no escaping in the pipeline description.
+    GstElement* source = gst_bin_get_by_name(GST_BIN(pipeline), "src");
+    g_object_set(source, "location", fileName.c_str(), NULL);
+    gst_object_unref(source);
+
+    GstElement* sink = gst_bin_get_by_name(GST_BIN(pipeline), "sink");
+    GstBus* bus = gst_element_get_bus(pipeline);
+    bool succeeded = gst_element_set_state(pipeline, GST_STATE_PLAYING) != GST_STATE_CHANGE_FAILURE;
+
+    while (succeeded)
+    {
+        // An error stops the streaming thread without an end of stream, so the bus is checked whenever no buffer arrives.
+        GstSample* sample = gst_app_sink_try_pull_sample(GST_APP_SINK(sink), 100 * GST_MSECOND);
+        if (sample == NULL)
+        {
+            if (gst_app_sink_is_eos(GST_APP_SINK(sink)))
+            {
+                break;
+            }
+            GstMessage* message = gst_bus_pop_filtered(bus, GST_MESSAGE_ERROR);
+            if (message != NULL)
+            {
+                gst_message_parse_error(message, &gerror, NULL);
+                *error = gerror->message;
+                g_error_free(gerror);
+                gst_message_unref(message);
+                succeeded = false;
+            }
+            continue;
+        }
+
+        GstBuffer* buffer = gst_sample_get_buffer(sample);
+        GstMapInfo map;
+        if (buffer != NULL && gst_buffer_map(buffer, &map, GST_MAP_READ))
+        {
+            onPcm(map.data, map.size);
+            gst_buffer_unmap(buffer, &map);
+        }
+        gst_sample_unref(sample);
+    }
+
+    if (!succeeded && error->empty())
+    {
+        *error = "Failed to start the decode pipeline.";
+    }
+    gst_element_set_state(pipeline, GST_STATE_NULL);
+    gst_object_unref(bus);
+    gst_object_unref(sink);
+    gst_object_unref(pipeline);
+    return succeeded;
+}
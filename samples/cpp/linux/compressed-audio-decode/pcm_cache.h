@@ -0,0 +1,286 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+// Read-only memory mapping of a cached PCM file, read by a pull audio input stream.
+class MappedPcm
+{
+public:
+    static MappedPcm* Open(const std::string& fileName)
+    {
+        int fd = open(fileName.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            return nullptr;
+        }
+
+        struct stat fileStat;
+        void* data = MAP_FAILED;
+        if (fstat(fd, &fileStat) == 0 && fileStat.st_size > 0)
+        {
+            data = mmap(nullptr, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        }
+        // The mapping stays valid after the descriptor is closed.
+        close(fd);
+
+        if (data == MAP_FAILED)
+        {
+            return nullptr;
+        }
+        madvise(data, fileStat.st_size, MADV_SEQUENTIAL);
+        return new MappedPcm(static_cast<const uint8_t*>(data), fileStat.st_size);
+    }
+
+    ~MappedPcm()
+    {
+        munmap(const_cast<uint8_t*>(m_data), m_size);
+    }
+
+    size_t Size() const { return m_size; }
+
+    // Pull stream read callback, the context is the MappedPcm.
+    static int Read(void* context, uint8_t* buffer, uint32_t size)
+    {
+        auto pcm = static_cast<MappedPcm*>(context);
+        auto count = std::min(static_cast<size_t>(size), pcm->m_size - pcm->m_position);
+        memcpy(buffer, pcm->m_data + pcm->m_position, count);
+        pcm->m_position += count;
+        return static_cast<int>(count);
+    }
+
+    // Pull stream close callback, the context is the MappedPcm.
+    static void Close(void* context)
+    {
+        delete static_cast<MappedPcm*>(context);
+    }
+
+private:
+    MappedPcm(const uint8_t* data, size_t size) : m_data(data), m_size(size) {}
+
+    const uint8_t* m_data;
+    size_t m_size;
+    size_t m_position = 0;
+};
+
+// A directory of decoded 16kHz 16bit mono PCM, one file per compressed input, keyed by the hash of the compressed
+// content and the codec, so renamed or copied inputs hit the cache and changed inputs miss it.
+// The total size is bounded: after each insert the least recently used entries are removed. The modification
+// time of an entry is its last use, so the order survives restarts and is shared by processes using the same directory.
+class PcmCache
+{
+public:
+    struct Statistics
+    {
+        std::atomic<uint64_t> Hits{ 0 };
+        std::atomic<uint64_t> Misses{ 0 };
+        std::atomic<uint64_t> Inserts{ 0 };
+        std::atomic<uint64_t> Evictions{ 0 };
+    };
+
+    // Collects decoded PCM for one entry in a temporary file, which becomes visible on Commit only, so a crash
+    // or a failed decode never leaves a truncated entry.
+    class Writer
+    {
+    public:
+        ~Writer()
+        {
+            if (m_file != NULL)
+            {
+                fclose(m_file);
+                remove(m_tempFileName.c_str());
+            }
+        }
+
+        void Write(const uint8_t* data, size_t size)
+        {
+            if (m_file != NULL && fwrite(data, 1, size, m_file) != size)
+            {
+                fclose(m_file);
+                remove(m_tempFileName.c_str());
+                m_file = NULL;
+            }
+        }
+
+        // Adds the entry to the cache. Returns false if it could not be written.
+        bool Commit()
+        {
+            if (m_file == NULL)
+            {
+                return false;
+            }
+            bool written = fclose(m_file) == 0 && rename(m_tempFileName.c_str(), m_fileName.c_str()) == 0;
+            m_file = NULL;
+            if (!written)
+            {
+                remove(m_tempFileName.c_str());
+                return false;
+            }
+            m_cache->m_statistics.Inserts++;
+            m_cache->Evict();
+            return true;
+        }
+
+    private:
+        friend class PcmCache;
+
+        Writer(PcmCache* cache, const std::string& fileName) :
+            m_cache(cache),
+            m_fileName(fileName),
+            m_tempFileName(fileName + ".tmp" + std::to_string(getpid()) + "-" + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())))
+        {
+            m_file = fopen(m_tempFileName.c_str(), "wb");
+        }
+
+        PcmCache* m_cache;
+        std::string m_fileName;
+        std::string m_tempFileName;
+        FILE* m_file = NULL;
+    };
+
+    // Uses the directory, which must exist, keeping at most maxBytes of PCM in it.
+    PcmCache(const std::string& directory, uint64_t maxBytes) :
+        m_directory(directory),
+        m_maxBytes(maxBytes)
+    {
+    }
+
+    // Gets the key of a compressed file: the FNV-1a hash of its content, its size and the codec.
+    // Returns an empty string if the file cannot be read.
+    static std::string GetKey(const std::string& compressedFileName, const std::string& codecName)
+    {
+        int fd = open(compressedFileName.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            return std::string();
+        }
+        uint64_t hash = 14695981039346656037ULL;
+        uint64_t size = 0;
+        std::vector<uint8_t> buffer(1 << 16);
+        ssize_t read;
+        while ((read = ::read(fd, buffer.data(), buffer.size())) > 0)
+        {
+            for (ssize_t i = 0; i < read; i++)
+            {
+                hash = (hash ^ buffer[i]) * 1099511628211ULL;
+            }
+            size += static_cast<uint64_t>(read);
+        }
+        close(fd);
+        if (read < 0)
+        {
+            return std::string();
+        }
+
+        char key[64];
+        snprintf(key, sizeof(key), "%016llx-%llu.%s", (unsigned long long)hash, (unsigned long long)size, codecName.c_str());
+        return key;
+    }
+
+    // Maps the cached PCM of the key and marks it as used. Returns nullptr on a miss.
+    MappedPcm* Open(const std::string& key)
+    {
+        auto fileName = GetFileName(key);
+        auto pcm = MappedPcm::Open(fileName);
+        if (pcm == nullptr)
+        {
+            m_statistics.Misses++;
+            return nullptr;
+        }
+        m_statistics.Hits++;
+        utimes(fileName.c_str(), NULL);
+        return pcm;
+    }
+
+    // Starts a new entry for the key, to be filled while decoding.
+    std::unique_ptr<Writer> Insert(const std::string& key)
+    {
+        return std::unique_ptr<Writer>(new Writer(this, GetFileName(key)));
+    }
+
+    const Statistics& GetStatistics() const { return m_statistics; }
+
+private:
+    static const char* Extension() { return ".pcm"; }
+
+    std::string GetFileName(const std::string& key) const
+    {
+        return m_directory + "/" + key + Extension();
+    }
+
+    // Removes the least recently used entries until the cache fits into its size bound.
+    void Evict()
+    {
+        std::lock_guard<std::mutex> lock(m_evictMutex);
+
+        struct Entry
+        {
+            std::string FileName;
+            time_t LastUse;
+            uint64_t Size;
+        };
+        std::vector<Entry> entries;
+        uint64_t totalSize = 0;
+
+        DIR* dir = opendir(m_directory.c_str());
+        if (dir == NULL)
+        {
+            return;
+        }
+        while (auto entry = readdir(dir))
+        {
+            std::string name = entry->d_name;
+            auto extensionLength = strlen(Extension());
+            if (name.size() <= extensionLength || name.compare(name.size() - extensionLength, extensionLength, Extension()) != 0)
+            {
+                continue;
+            }
+            auto fileName = m_directory + "/" + name;
+            struct stat fileStat;
+            if (stat(fileName.c_str(), &fileStat) == 0)
+            {
+                entries.push_back(Entry{ fileName, fileStat.st_mtime, static_cast<uint64_t>(fileStat.st_size) });
+                totalSize += static_cast<uint64_t>(fileStat.st_size);
+            }
+        }
+        closedir(dir);
+
+        std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.LastUse < b.LastUse; });
+        for (const auto& entry : entries)
+        {
+            if (totalSize <= m_maxBytes)
+            {
+                break;
+            }
+            // A reader that mapped the entry keeps its pages until it unmaps them.
+            if (remove(entry.FileName.c_str()) == 0)
+            {
+                totalSize -= entry.Size;
+                m_statistics.Evictions++;
+            }
+        }
+    }
+
+    std::string m_directory;
+    uint64_t m_maxBytes;
+    std::mutex m_evictMutex;
+    Statistics m_statistics;
+};
@@ -0,0 +1,153 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#pragma once
+
+#include <cstring>
+#include <speechapi_cxx.h>
+
+// Number of leading bytes passed to SniffContainerFormat. Wave headers with extra chunks need more than the magic bytes.
+static const size_t SniffHeaderSize = 4096;
+
+static bool StartsWith(const uint8_t* data, size_t size, size_t offset, const char* magic)
+{
+    auto length = strlen(magic);
+    return size >= offset + length && memcmp(data + offset, magic, length) == 0;
+}
+
+static uint32_t ReadLittleEndian32(const uint8_t* data)
+{
+    return data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+// Length in bytes of the MPEG audio frame whose 4 byte header starts at data, or 0 if it is not a valid header:
+// a frame sync, a known version and layer, a bitrate index other than free (0) and bad (15), and a known sample rate.
+// Layer bits of 00 denote AAC in ADTS framing, which is not MP3.
+static size_t MpegFrameLength(const uint8_t* data)
+{
+    static const uint16_t bitrates[2][3][15] = {
+        // MPEG-1 layer I, II and III.
+        { { 0, 32, 64, 96, 128, 160, 192, 224, 256, 288, 320, 352, 384, 416, 448 },
+          { 0, 32, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384 },
+          { 0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320 } },
+        // MPEG-2 and 2.5 layer I, II and III.
+        { { 0, 32, 48, 56, 64, 80, 96, 112, 128, 144, 160, 176, 192, 224, 256 },
+          { 0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160 },
+          { 0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160 } },
+    };
+    static const uint32_t sampleRates[3] = { 44100, 48000, 32000 };
+
+    if (data[0] != 0xFF || (data[1] & 0xE0) != 0xE0)
+    {
+        return 0;
+    }
+    auto version = (data[1] >> 3) & 3;         // 0: MPEG-2.5, 1: reserved, 2: MPEG-2, 3: MPEG-1.
+    auto layer = 4 - ((data[1] >> 1) & 3);      // 4 for the reserved layer bits 00.
+    auto bitrateIndex = data[2] >> 4;
+    auto sampleRateIndex = (data[2] >> 2) & 3;
+    auto padding = (data[2] >> 1) & 1;
+    if (version == 1 || layer == 4 || bitrateIndex == 0 || bitrateIndex == 15 || sampleRateIndex == 3)
+    {
+        return 0;
+    }
+
+    uint32_t bitrate = bitrates[version == 3 ? 0 : 1][layer - 1][bitrateIndex] * 1000;
+    uint32_t sampleRate = sampleRates[sampleRateIndex] >> (version == 3 ? 0 : version == 2 ? 1 : 2);
+    if (layer == 1)
+    {
+        return (12 * bitrate / sampleRate + padding) * 4;
+    }
+    auto samplesPerFrame = layer == 3 && version != 3 ? 576 : 1152;
+    return samplesPerFrame / 8 * bitrate / sampleRate + padding;
+}
+
+// Whether the data starts with an MPEG audio frame, which is followed by the header of a next frame of the same
+// stream if the data reaches that far. A single sync word is not enough, e.g. mu-law silence is all 0xFF bytes.
+static bool StartsWithMpegFrames(const uint8_t* data, size_t size)
+{
+    if (size < 4)
+    {
+        return false;
+    }
+    auto length = MpegFrameLength(data);
+    if (length == 0)
+    {
+        return false;
+    }
+    if (size < length + 4)
+    {
+        return true;
+    }
+    // The next frame has the same version, layer and sample rate; bitrate and padding may differ.
+    const uint8_t* next = data + length;
+    return MpegFrameLength(next) != 0 && (next[1] & 0xFE) == (data[1] & 0xFE) && (next[2] & 0x0C) == (data[2] & 0x0C);
+}
+
+// Detects the container format from the first bytes of a file, independent of its name.
+// dataOffset receives the number of leading bytes to skip before passing the data to the Speech SDK, which is not 0
+// for A-law/mu-law wave files, whose header must not be decoded as audio.
+// Returns false if the format is not recognized, e.g. for headerless A-law/mu-law files.
+static bool SniffContainerFormat(const uint8_t* data, size_t size, Microsoft::CognitiveServices::Speech::Audio::AudioStreamContainerFormat* format, size_t* dataOffset)
+{
+    using Microsoft::CognitiveServices::Speech::Audio::AudioStreamContainerFormat;
+    *dataOffset = 0;
+
+    // FLAC stream marker.
+    if (StartsWith(data, size, 0, "fLaC"))
+    {
+        *format = AudioStreamContainerFormat::FLAC;
+        return true;
+    }
+
+    // Ogg page whose first packet is an Opus identification header. The first page holds a single segment,
+    // so the packet starts right after the 27 byte page header and the 1 byte segment table.
+    if (StartsWith(data, size, 0, "OggS"))
+    {
+        if (size > 27 && StartsWith(data, size, 27 + (size_t)data[26], "OpusHead"))
+        {
+            *format = AudioStreamContainerFormat::OGG_OPUS;
+            return true;
+        }
+        return false;
+    }
+
+    // MP3 with an ID3v2 tag, or starting directly with MPEG audio frames.
+    if (StartsWith(data, size, 0, "ID3") || StartsWithMpegFrames(data, size))
+    {
+        *format = AudioStreamContainerFormat::MP3;
+        return true;
+    }
+
+    // Wave file holding A-law (format tag 6) or mu-law (format tag 7) audio.
+    if (StartsWith(data, size, 0, "RIFF") && StartsWith(data, size, 8, "WAVE"))
+    {
+        size_t offset = 12;
+        bool hasFormat = false;
+        while (offset + 8 <= size)
+        {
+            auto chunkSize = ReadLittleEndian32(data + offset + 4);
+            if (StartsWith(data, size, offset, "fmt ") && offset + 10 <= size)
+            {
+                auto formatTag = data[offset + 8] | (data[offset + 9] << 8);
+                if (formatTag == 6 || formatTag == 7)
+                {
+                    *format = formatTag == 6 ? AudioStreamContainerFormat::ALAW : AudioStreamContainerFormat::MULAW;
+                    hasFormat = true;
+                }
+                else
+                {
+                    return false;
+                }
+            }
+            else if (StartsWith(data, size, offset, "data"))
+            {
+                *dataOffset = offset + 8;
+                return hasFormat;
+            }
+            offset += 8 + chunkSize + (chunkSize & 1);
+        }
+    }
+
+    return false;
+}
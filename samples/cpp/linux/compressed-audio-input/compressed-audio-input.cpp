@@ -3,8 +3,26 @@
 // Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
 //
 
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <iomanip>
 #include <iostream> // cin, cout
+#include <iterator>
+#include <mutex>
+#include <thread>
+#include <vector>
 #include <speechapi_cxx.h>
+#include "audio_format_sniffer.h"
+#include "g711_push_stream.h"
+#ifdef WITH_OPUS
+#include "opus_push_stream.h"
+#endif
+#include "mapped_audio_file.h"
+#include "pipe_audio_reader.h"
 
 using namespace Microsoft::CognitiveServices::Speech;
 using namespace Microsoft::CognitiveServices::Speech::Audio;
@@ -37,57 +55,186 @@ static int ReadCompressedBinaryData(void *stream, uint8_t *ptr, uint32_t bufSize
     }
 }
 
-void recognizeSpeech(const std::string& compressedFileName)
+static bool EndsWith(const std::string& fileName, const std::string& extension)
 {
-    std::shared_ptr<SpeechRecognizer> recognizer;
-    std::shared_ptr<PullAudioInputStream> pullAudioStream;
+    return fileName.size() >= extension.size() &&
+        fileName.compare(fileName.size() - extension.size(), extension.size(), extension) == 0;
+}
 
-    void *compressedFilePtr = OpenCompressedFile(compressedFileName);
+static bool GetFormatFromFileName(const std::string& compressedFileName, AudioStreamContainerFormat* format)
+{
+    if (EndsWith(compressedFileName, ".mp3"))
+    {
+        *format = AudioStreamContainerFormat::MP3;
+    }
+    else if (EndsWith(compressedFileName, ".opus"))
+    {
+        *format = AudioStreamContainerFormat::OGG_OPUS;
+    }
+    else if (EndsWith(compressedFileName, ".alaw"))
+    {
+        *format = AudioStreamContainerFormat::ALAW;
+    }
+    else if (EndsWith(compressedFileName, ".mulaw"))
+    {
+        *format = AudioStreamContainerFormat::MULAW;
+    }
+    else if (EndsWith(compressedFileName, ".flac"))
+    {
+        *format = AudioStreamContainerFormat::FLAC;
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
 
-    if (compressedFilePtr == NULL)
+// Detects the container format from the content, falling back to the file extension for headerless A-law/mu-law.
+static bool GetContainerFormat(const std::string& compressedFileName, const uint8_t* header, size_t headerSize, AudioStreamContainerFormat* format, size_t* dataOffset)
+{
+    AudioStreamContainerFormat formatFromName;
+    bool hasFormatFromName = GetFormatFromFileName(compressedFileName, &formatFromName);
+
+    // Headerless A-law/mu-law audio can start like MPEG frames, so frames found without an ID3 tag do not override
+    // an explicit .alaw/.mulaw extension.
+    bool headerless = hasFormatFromName &&
+        (formatFromName == AudioStreamContainerFormat::ALAW || formatFromName == AudioStreamContainerFormat::MULAW);
+    if (SniffContainerFormat(header, headerSize, format, dataOffset) &&
+        !(headerless && *format == AudioStreamContainerFormat::MP3 && !StartsWith(header, headerSize, 0, "ID3")))
     {
-        std::cout << "Error: Input file doesn't exist" << std::endl;
-        return;
+        if (hasFormatFromName && formatFromName != *format)
+        {
+            std::cout << "Note: the content of " << compressedFileName << " does not match its extension, using the detected format." << std::endl;
+        }
+        return true;
     }
 
-    // Creates an instance of a speech config with specified subscription key and service region.
-    // Replace with your own subscription key and service region (e.g., "westus").
-    auto config = SpeechConfig::FromSubscription("YourSubscriptionKey", "YourServiceRegion");
+    *dataOffset = 0;
+    *format = formatFromName;
+    return hasFormatFromName;
+}
 
+// Creates a pull stream reading the file through a memory mapping, or through stdio if the file cannot be mapped.
+static std::shared_ptr<PullAudioInputStream> CreatePullStreamFromFile(const std::string& compressedFileName)
+{
     AudioStreamContainerFormat inputFormat;
+    size_t dataOffset = 0;
 
-    if (compressedFileName.find(".mp3") == (compressedFileName.size() - 4))
+    auto mappedFile = MappedAudioFile::Open(compressedFileName);
+    if (mappedFile != NULL)
     {
-        inputFormat = AudioStreamContainerFormat::MP3;
+        if (!GetContainerFormat(compressedFileName, mappedFile->Data(), mappedFile->Size(), &inputFormat, &dataOffset))
+        {
+            delete mappedFile;
+            return nullptr;
+        }
+        mappedFile->Seek(dataOffset);
+        return AudioInputStream::CreatePullStream(
+            AudioStreamFormat::GetCompressedFormat(inputFormat),
+            mappedFile,
+            MappedAudioFile::Read,
+            MappedAudioFile::Close
+        );
     }
-    else if (compressedFileName.find(".opus") == (compressedFileName.size() - 5))
+
+    void *compressedFilePtr = OpenCompressedFile(compressedFileName);
+    if (compressedFilePtr == NULL)
     {
-        inputFormat = AudioStreamContainerFormat::OGG_OPUS;
+        return nullptr;
     }
-    else if (compressedFileName.find(".alaw") == (compressedFileName.size() - 5))
+
+    uint8_t header[SniffHeaderSize];
+    size_t headerSize = fread(header, 1, sizeof(header), (FILE*)compressedFilePtr);
+    if (!GetContainerFormat(compressedFileName, header, headerSize, &inputFormat, &dataOffset))
     {
-        inputFormat = AudioStreamContainerFormat::ALAW;
+        closeStream(compressedFilePtr);
+        return nullptr;
     }
-    else if (compressedFileName.find(".mulaw") == (compressedFileName.size() - 6))
+    fseek((FILE*)compressedFilePtr, (long)dataOffset, SEEK_SET);
+
+    return AudioInputStream::CreatePullStream(
+        AudioStreamFormat::GetCompressedFormat(inputFormat),
+        compressedFilePtr,
+        ReadCompressedBinaryData,
+        closeStream
+    );
+}
+
+static bool GetFormatFromName(const std::string& formatName, AudioStreamContainerFormat* format)
+{
+    return GetFormatFromFileName("." + formatName, format);
+}
+
+// Creates a pull stream reading from standard input ("-") or a named pipe, starting as soon as the first bytes arrive.
+// The container format is taken from formatName if not empty, otherwise it is detected from the first bytes.
+static std::shared_ptr<PullAudioInputStream> CreatePullStreamFromPipe(const std::string& pipeName, const std::string& formatName)
+{
+    AudioStreamContainerFormat inputFormat;
+    size_t dataOffset = 0;
+
+    if (!formatName.empty() && !GetFormatFromName(formatName, &inputFormat))
     {
-        inputFormat = AudioStreamContainerFormat::MULAW;
+        return nullptr;
     }
-    else if (compressedFileName.find(".flac") == (compressedFileName.size() - 5))
+
+    auto pipeReader = PipeAudioReader::Open(pipeName);
+    if (pipeReader == NULL)
     {
-        inputFormat = AudioStreamContainerFormat::FLAC;
+        return nullptr;
     }
-    else
+
+    if (formatName.empty())
     {
-        std::cout << "Only Opus and MP3 input files are currently supported" << std::endl;
-        return;
+        // Most containers are recognized from their first few bytes, wave headers may need more.
+        size_t headerSize = 0;
+        const uint8_t* header = pipeReader->Peek(64, &headerSize);
+        bool detected = SniffContainerFormat(header, headerSize, &inputFormat, &dataOffset);
+        if (!detected && headerSize >= 64)
+        {
+            header = pipeReader->Peek(SniffHeaderSize, &headerSize);
+            detected = SniffContainerFormat(header, headerSize, &inputFormat, &dataOffset);
+        }
+        if (!detected)
+        {
+            delete pipeReader;
+            return nullptr;
+        }
+        pipeReader->Skip(dataOffset);
     }
 
-    pullAudioStream = AudioInputStream::CreatePullStream(
+    return AudioInputStream::CreatePullStream(
         AudioStreamFormat::GetCompressedFormat(inputFormat),
-        compressedFilePtr,
-        ReadCompressedBinaryData,
-        closeStream
+        pipeReader,
+        PipeAudioReader::Read,
+        PipeAudioReader::Close
     );
+}
+
+void recognizeSpeech(const std::string& compressedFileName)
+{
+    std::shared_ptr<SpeechRecognizer> recognizer;
+    std::shared_ptr<PullAudioInputStream> pullAudioStream;
+
+    FILE *inputFile = fopen(compressedFileName.c_str(), "rb");
+    if (inputFile == NULL)
+    {
+        std::cout << "Error: Input file doesn't exist" << std::endl;
+        return;
+    }
+    fclose(inputFile);
+
+    // Creates an instance of a speech config with specified subscription key and service region.
+    // Replace with your own subscription key and service region (e.g., "westus").
+    auto config = SpeechConfig::FromSubscription("YourSubscriptionKey", "YourServiceRegion");
+
+    pullAudioStream = CreatePullStreamFromFile(compressedFileName);
+    if (pullAudioStream == nullptr)
+    {
+        std::cout << "Only MP3, Opus, FLAC, A-law and mu-law input files are currently supported" << std::endl;
+        return;
+    }
+
     recognizer = SpeechRecognizer::FromConfig(config, AudioConfig::FromStreamInput(pullAudioStream));
 
     std::cout << "Recognizing ..." << std::endl;
@@ -119,13 +266,466 @@ void recognizeSpeech(const std::string& compressedFileName)
     }
 }
 
+static std::string JsonEscape(const std::string& text)
+{
+    std::string escaped;
+    for (unsigned char c : text)
+    {
+        switch (c)
+        {
+        case '"': escaped += "\\\""; break;
+        case '\\': escaped += "\\\\"; break;
+        case '\n': escaped += "\\n"; break;
+        case '\r': escaped += "\\r"; break;
+        case '\t': escaped += "\\t"; break;
+        default:
+            if (c < 0x20)
+            {
+                char buffer[8];
+                snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+                escaped += buffer;
+            }
+            else
+            {
+                escaped += (char)c;
+            }
+            break;
+        }
+    }
+    return escaped;
+}
+
+// Serializes the JSON lines written by concurrent recognitions.
+static std::mutex outputMutex;
+
+static void WriteJsonLine(const std::string& line)
+{
+    std::lock_guard<std::mutex> lock(outputMutex);
+    std::cout << line << std::endl;
+}
+
+// Recognizes a whole stream with continuous recognition and writes one JSON line per recognized utterance,
+// followed by one JSON line with the statistics of the stream.
+void recognizeContinuous(const std::string& compressedFileName, std::shared_ptr<AudioInputStream> audioStream)
+{
+    auto fileJson = "\"file\":\"" + JsonEscape(compressedFileName) + "\"";
+
+    if (audioStream == nullptr)
+    {
+        WriteJsonLine("{" + fileJson + ",\"status\":\"error\",\"error\":\"Input is missing or not in a supported format\"}");
+        return;
+    }
+
+    // Creates an instance of a speech config with specified subscription key and service region.
+    // Replace with your own subscription key and service region (e.g., "westus").
+    auto config = SpeechConfig::FromSubscription("YourSubscriptionKey", "YourServiceRegion");
+    auto recognizer = SpeechRecognizer::FromConfig(config, AudioConfig::FromStreamInput(audioStream));
+
+    // promise for synchronization of recognition end.
+    std::promise<void> recognitionEnd;
+    std::once_flag recognitionEndFlag;
+    auto notifyEnd = [&recognitionEnd, &recognitionEndFlag]()
+    {
+        std::call_once(recognitionEndFlag, [&recognitionEnd]() { recognitionEnd.set_value(); });
+    };
+
+    // The audio duration of a compressed file is not known upfront, the end of the last utterance approximates it.
+    uint64_t audioEndTicks = 0;
+    size_t utterances = 0;
+    std::string error;
+
+    recognizer->Recognized.Connect([&](const SpeechRecognitionEventArgs& e)
+    {
+        if (e.Result->Reason == ResultReason::RecognizedSpeech)
+        {
+            audioEndTicks = std::max(audioEndTicks, e.Result->Offset() + e.Result->Duration());
+            utterances++;
+            WriteJsonLine("{" + fileJson +
+                ",\"offset\":" + std::to_string(e.Result->Offset()) +
+                ",\"duration\":" + std::to_string(e.Result->Duration()) +
+                ",\"text\":\"" + JsonEscape(e.Result->Text) + "\"}");
+        }
+    });
+
+    recognizer->Canceled.Connect([&](const SpeechRecognitionCanceledEventArgs& e)
+    {
+        if (e.Reason == CancellationReason::Error)
+        {
+            error = "ErrorCode=" + std::to_string((int)e.ErrorCode) + " " + e.ErrorDetails;
+        }
+        notifyEnd();
+    });
+
+    recognizer->SessionStopped.Connect([&](const SessionEventArgs&)
+    {
+        notifyEnd();
+    });
+
+    auto start = std::chrono::steady_clock::now();
+
+    // Starts continuous recognition, which runs until the end of the file.
+    recognizer->StartContinuousRecognitionAsync().get();
+    recognitionEnd.get_future().get();
+    recognizer->StopContinuousRecognitionAsync().get();
+
+    auto wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    auto audioSeconds = audioEndTicks / 10000000.0;
+
+    // The real time factor is the processing time divided by the audio duration, lower is faster.
+    std::string stats = "{" + fileJson +
+        ",\"status\":\"" + (error.empty() ? "done" : "error") + "\"" +
+        ",\"utterances\":" + std::to_string(utterances) +
+        ",\"audioSeconds\":" + std::to_string(audioSeconds) +
+        ",\"wallSeconds\":" + std::to_string(wallSeconds) +
+        ",\"realTimeFactor\":" + std::to_string(audioSeconds > 0 ? wallSeconds / audioSeconds : 0.0);
+    if (!error.empty())
+    {
+        stats += ",\"error\":\"" + JsonEscape(error) + "\"";
+    }
+    WriteJsonLine(stats + "}");
+}
+
+// Recognizes the files with at most workerCount recognitions running at the same time.
+void recognizeFiles(const std::vector<std::string>& compressedFileNames, size_t workerCount)
+{
+    std::atomic<size_t> next(0);
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < workerCount && i < compressedFileNames.size(); i++)
+    {
+        workers.emplace_back([&compressedFileNames, &next]()
+        {
+            for (size_t file = next++; file < compressedFileNames.size(); file = next++)
+            {
+                recognizeContinuous(compressedFileNames[file], CreatePullStreamFromFile(compressedFileNames[file]));
+            }
+        });
+    }
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+}
+
+// Reads the PCM of a 16bit mono wave file, returns false if it is not one.
+static bool ReadPcmWaveFile(const std::string& fileName, std::vector<uint8_t>* pcm, uint32_t* sampleRate)
+{
+    std::ifstream file(fileName, std::ios::binary);
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (data.size() < 12 || memcmp(data.data(), "RIFF", 4) != 0 || memcmp(data.data() + 8, "WAVE", 4) != 0)
+    {
+        return false;
+    }
+    bool isPcm = false;
+    for (size_t offset = 12; offset + 8 <= data.size();)
+    {
+        auto chunkSize = ReadLittleEndian32(data.data() + offset + 4);
+        if (memcmp(data.data() + offset, "fmt ", 4) == 0 && offset + 24 <= data.size())
+        {
+            // PCM (format tag 1), mono, 16bit.
+            isPcm = data[offset + 8] == 1 && data[offset + 10] == 1 && data[offset + 22] == 16;
+            *sampleRate = ReadLittleEndian32(data.data() + offset + 12);
+        }
+        else if (memcmp(data.data() + offset, "data", 4) == 0)
+        {
+            auto begin = data.begin() + offset + 8;
+            pcm->assign(begin, begin + std::min<size_t>(chunkSize, data.size() - offset - 8));
+            return isPcm;
+        }
+        offset += 8 + chunkSize + (chunkSize & 1);
+    }
+    return false;
+}
+
+// Recognizes a PCM wave file that is sent to the service as A-law or mu-law, written in chunks of 100 milliseconds
+// like live audio, and reports the bytes sent.
+void recognizeG711(const std::string& pcmFileName, const std::string& formatName)
+{
+    AudioStreamContainerFormat format;
+    if (formatName != "alaw" && formatName != "mulaw")
+    {
+        WriteJsonLine("{\"file\":\"" + JsonEscape(pcmFileName) + "\",\"status\":\"error\",\"error\":\"Format must be alaw or mulaw\"}");
+        return;
+    }
+    GetFormatFromName(formatName, &format);
+    std::vector<uint8_t> pcm;
+    uint32_t sampleRate = 0;
+    if (!ReadPcmWaveFile(pcmFileName, &pcm, &sampleRate) || (sampleRate != 8000 && sampleRate != 16000))
+    {
+        WriteJsonLine("{\"file\":\"" + JsonEscape(pcmFileName) + "\",\"status\":\"error\",\"error\":\"Input must be an 8kHz or 16kHz 16bit mono PCM wave file\"}");
+        return;
+    }
+
+    G711PushAudioInputStream g711Stream(format, sampleRate);
+    std::thread writer([&g711Stream, &pcm, sampleRate]()
+    {
+        size_t chunkSize = sampleRate / 10 * 2;
+        for (size_t offset = 0; offset < pcm.size(); offset += chunkSize)
+        {
+            g711Stream.Write(pcm.data() + offset, std::min(chunkSize, pcm.size() - offset));
+        }
+        g711Stream.Close();
+    });
+    recognizeContinuous(pcmFileName, g711Stream.GetStream());
+    writer.join();
+
+    const auto& stats = g711Stream.GetStatistics();
+    WriteJsonLine("{\"file\":\"" + JsonEscape(pcmFileName) + "\"" +
+        ",\"format\":\"" + formatName + "\"" +
+        ",\"pcmBytes\":" + std::to_string(stats.PcmBytes) +
+        ",\"sentBytes\":" + std::to_string(stats.EncodedBytes) +
+        ",\"encodeSeconds\":" + std::to_string(stats.EncodeSeconds) + "}");
+}
+
+// Synthetic test audio: a warbling tone with noise, whose level varies over the whole 16bit range.
+static std::vector<int16_t> GenerateTestAudio(uint32_t sampleRate, size_t seconds)
+{
+    std::vector<int16_t> samples(sampleRate * seconds);
+    uint32_t noise = 1;
+    for (size_t i = 0; i < samples.size(); i++)
+    {
+        noise = noise * 1664525 + 1013904223;
+        double envelope = 0.5 + 0.5 * std::sin(i * 2 * 3.14159265 / sampleRate);
+        double value = envelope * (12000 * std::sin(i * 2 * 3.14159265 * (300 + 200 * std::sin(i / 8000.0)) / sampleRate) + (int16_t)(noise >> 16) / 16.0);
+        samples[i] = static_cast<int16_t>(value);
+    }
+    return samples;
+}
+
+// Measures the encoding cost of one live stream against the bandwidth it saves, on synthetic audio.
+void benchmarkG711()
+{
+    const uint32_t sampleRate = 16000;
+    const size_t seconds = 600;
+    auto samples = GenerateTestAudio(sampleRate, seconds);
+    std::vector<uint8_t> codes(samples.size());
+
+    auto measure = [&samples](const std::function<void()>& encode)
+    {
+        auto start = std::chrono::steady_clock::now();
+        encode();
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() * 1e9 / samples.size();
+    };
+    auto scalarMuLaw = measure([&]() { for (size_t i = 0; i < samples.size(); i++) codes[i] = LinearToMuLaw(samples[i]); });
+    auto scalarALaw = measure([&]() { for (size_t i = 0; i < samples.size(); i++) codes[i] = LinearToALaw(samples[i]); });
+    auto vectorMuLaw = measure([&]() { EncodeMuLaw(samples.data(), codes.data(), samples.size()); });
+    auto vectorALaw = measure([&]() { EncodeALaw(samples.data(), codes.data(), samples.size()); });
+    std::vector<int16_t> decoded(samples.size());
+    auto decodeMuLaw = measure([&]() { DecodeMuLaw(codes.data(), decoded.data(), codes.size()); });
+
+    std::cout << "Encoding, nanoseconds per sample: mu-law " << scalarMuLaw << " scalar, " << vectorMuLaw << " vectorized; "
+        << "A-law " << scalarALaw << " scalar, " << vectorALaw << " vectorized; table decoding " << decodeMuLaw << std::endl;
+
+    // The complete stream path, 16kHz PCM written in 100 millisecond chunks, filtered, decimated and encoded.
+    for (auto format : { AudioStreamContainerFormat::MULAW, AudioStreamContainerFormat::ALAW })
+    {
+        G711PushAudioInputStream stream(format, sampleRate);
+        auto pcm = reinterpret_cast<const uint8_t*>(samples.data());
+        size_t chunkSize = sampleRate / 10 * 2;
+        for (size_t offset = 0; offset < samples.size() * 2; offset += chunkSize)
+        {
+            stream.Write(pcm + offset, chunkSize);
+        }
+        stream.Close();
+
+        const auto& stats = stream.GetStatistics();
+        auto cpuShare = stats.EncodeSeconds / seconds;
+        std::cout << (format == AudioStreamContainerFormat::MULAW ? "mu-law" : "A-law") << " stream from 16kHz PCM: "
+            << stats.PcmBytes * 8 / 1000.0 / seconds << " kbps PCM, " << stats.EncodedBytes * 8 / 1000.0 / seconds << " kbps sent, "
+            << (1 - (double)stats.EncodedBytes / stats.PcmBytes) * 100 << "% saved, "
+            << cpuShare * 100 << "% of a core per stream (" << (cpuShare > 0 ? 1 / cpuShare : 0) << " streams per core)" << std::endl;
+    }
+}
+
+#ifdef WITH_OPUS
+// Recognizes a PCM wave file that is sent to the service as Ogg Opus. The PCM is written in 20 millisecond chunks
+// at the pace of live audio, so the reported page delay is the delay a live source would see.
+void recognizeOpus(const std::string& pcmFileName)
+{
+    std::vector<uint8_t> pcm;
+    uint32_t sampleRate = 0;
+    if (!ReadPcmWaveFile(pcmFileName, &pcm, &sampleRate) || (sampleRate != 8000 && sampleRate != 16000))
+    {
+        WriteJsonLine("{\"file\":\"" + JsonEscape(pcmFileName) + "\",\"status\":\"error\",\"error\":\"Input must be an 8kHz or 16kHz 16bit mono PCM wave file\"}");
+        return;
+    }
+
+    OpusPushAudioInputStream opusStream(sampleRate);
+    std::thread writer([&opusStream, &pcm, sampleRate]()
+    {
+        size_t chunkSize = sampleRate / 50 * 2;
+        auto next = std::chrono::steady_clock::now();
+        for (size_t offset = 0; offset < pcm.size(); offset += chunkSize)
+        {
+            std::this_thread::sleep_until(next);
+            opusStream.Write(pcm.data() + offset, std::min(chunkSize, pcm.size() - offset));
+            next += std::chrono::milliseconds(20);
+        }
+        opusStream.Close();
+    });
+    recognizeContinuous(pcmFileName, opusStream.GetStream());
+    writer.join();
+
+    const auto& stats = opusStream.GetStatistics();
+    auto audioSeconds = pcm.size() / (sampleRate * 2.0);
+    WriteJsonLine("{\"file\":\"" + JsonEscape(pcmFileName) + "\"" +
+        ",\"format\":\"opus\"" +
+        ",\"pcmKbps\":" + std::to_string(stats.PcmBytes * 8 / 1000.0 / audioSeconds) +
+        ",\"sentKbps\":" + std::to_string(stats.SentBytes * 8 / 1000.0 / audioSeconds) +
+        ",\"algorithmicDelayMilliseconds\":" + std::to_string(opusStream.AlgorithmicDelayMilliseconds()) +
+        ",\"meanPageDelayMilliseconds\":" + std::to_string(stats.Pages > 0 ? stats.PageDelaySeconds * 1000 / stats.Pages : 0.0) +
+        ",\"encodeSeconds\":" + std::to_string(stats.EncodeSeconds) +
+        ",\"failedFrames\":" + std::to_string(stats.FailedFrames) +
+        (stats.Error.empty() ? "" : ",\"error\":\"" + JsonEscape(stats.Error) + "\"") + "}");
+}
+
+// Compares the bandwidth, added delay and encoding cost of Opus settings with 16kHz PCM and G.711, on synthetic audio.
+void benchmarkOpus()
+{
+    const uint32_t sampleRate = 16000;
+    const size_t seconds = 120;
+    auto samples = GenerateTestAudio(sampleRate, seconds);
+    auto pcm = reinterpret_cast<const uint8_t*>(samples.data());
+
+    struct Setting { int Bitrate; uint32_t FrameMilliseconds; uint32_t FramesPerPage; bool LowDelay; };
+    const Setting settings[] = {
+        { 24000, 20, 1, false }, { 24000, 20, 5, false }, { 24000, 10, 1, false }, { 24000, 10, 1, true }, { 16000, 20, 5, false }, { 32000, 20, 1, false }
+    };
+
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "16kHz PCM: " << sampleRate * 16 / 1000.0 << " kbps, G.711: " << 8000 * 8 / 1000.0 << " kbps, no added delay" << std::endl;
+    std::cout << std::setw(8) << "bitrate" << std::setw(8) << "frameMs" << std::setw(7) << "frames" << std::setw(9) << "lowDelay"
+        << std::setw(10) << "sentKbps" << std::setw(11) << "oggKbps" << std::setw(9) << "saved%" << std::setw(10) << "delayMs"
+        << std::setw(13) << "cpuPerStream%" << std::endl;
+    for (const auto& setting : settings)
+    {
+        OpusPushAudioInputStream stream(sampleRate, setting.Bitrate, setting.FrameMilliseconds, setting.FramesPerPage, setting.LowDelay);
+        // Written in 10 millisecond chunks, as a live source would.
+        size_t chunkSize = sampleRate / 100 * 2;
+        for (size_t offset = 0; offset < samples.size() * 2; offset += chunkSize)
+        {
+            stream.Write(pcm + offset, chunkSize);
+        }
+        stream.Close();
+
+        const auto& stats = stream.GetStatistics();
+        std::cout << std::setw(8) << setting.Bitrate << std::setw(8) << setting.FrameMilliseconds << std::setw(7) << setting.FramesPerPage
+            << std::setw(9) << (setting.LowDelay ? "yes" : "no")
+            << std::setw(10) << stats.SentBytes * 8 / 1000.0 / seconds
+            << std::setw(11) << stats.OggOverheadBytes * 8 / 1000.0 / seconds
+            << std::setw(9) << (1 - (double)stats.SentBytes / stats.PcmBytes) * 100
+            << std::setw(10) << stream.AlgorithmicDelayMilliseconds() + stats.EncodeSeconds * 1000 / std::max<uint64_t>(stats.Pages, 1)
+            << std::setw(13) << stats.EncodeSeconds / seconds * 100 << std::endl;
+    }
+}
+#endif
+
+static void PrintUsage()
+{
+    std::cout << "Usage: ./compressed-audio-input <filename>" << std::endl;
+    std::cout << "       ./compressed-audio-input --continuous [--workers <count>] [--manifest <file with one filename per line>] [<filename> ...]" << std::endl;
+    std::cout << "       ./compressed-audio-input --pipe <named pipe, or - for stdin> [--format mp3|opus|flac|alaw|mulaw]" << std::endl;
+    std::cout << "       ./compressed-audio-input --g711 alaw|mulaw <8kHz or 16kHz 16bit mono PCM wave file>" << std::endl;
+    std::cout << "       ./compressed-audio-input --g711-benchmark" << std::endl;
+#ifdef WITH_OPUS
+    std::cout << "       ./compressed-audio-input --opus <8kHz or 16kHz 16bit mono PCM wave file>" << std::endl;
+    std::cout << "       ./compressed-audio-input --opus-benchmark" << std::endl;
+#endif
+}
+
 int main(int argc, char **argv) {
-    if (argc != 2)
+    setlocale(LC_ALL, "");
+
+    if (argc == 2 && std::string(argv[1]).compare(0, 2, "--") != 0)
     {
-        std::cout << "Usage: ./compressed-audio-input <filename>" << std::endl;
+        recognizeSpeech(argv[1]);
         return 0;
     }
-    setlocale(LC_ALL, "");
-    recognizeSpeech(argv[1]);
+
+    bool continuous = false;
+    size_t workerCount = 4;
+    std::string pipeName;
+    std::string formatName;
+    std::vector<std::string> compressedFileNames;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--continuous")
+        {
+            continuous = true;
+        }
+        else if (arg == "--workers" && i + 1 < argc)
+        {
+            workerCount = std::max(1, atoi(argv[++i]));
+        }
+        else if (arg == "--g711" && i + 2 < argc)
+        {
+            std::string g711Format = argv[++i];
+            recognizeG711(argv[++i], g711Format);
+            return 0;
+        }
+#ifdef WITH_OPUS
+        else if (arg == "--opus" && i + 1 < argc)
+        {
+            recognizeOpus(argv[++i]);
+            return 0;
+        }
+        else if (arg == "--opus-benchmark")
+        {
+            benchmarkOpus();
+            return 0;
+        }
+#endif
+        else if (arg == "--g711-benchmark")
+        {
+            benchmarkG711();
+            return 0;
+        }
+        else if (arg == "--pipe" && i + 1 < argc)
+        {
+            pipeName = argv[++i];
+        }
+        else if (arg == "--format" && i + 1 < argc)
+        {
+            formatName = argv[++i];
+        }
+        else if (arg == "--manifest" && i + 1 < argc)
+        {
+            std::ifstream manifest(argv[++i]);
+            std::string line;
+            while (std::getline(manifest, line))
+            {
+                if (!line.empty())
+                {
+                    compressedFileNames.push_back(line);
+                }
+            }
+        }
+        else if (arg.compare(0, 2, "--") == 0)
+        {
+            // An unknown option, or one without its value.
+            std::cout << "Invalid option: " << arg << std::endl;
+            PrintUsage();
+            return 1;
+        }
+        else
+        {
+            compressedFileNames.push_back(arg);
+        }
+    }
+
+    if (!pipeName.empty())
+    {
+        // Recognition starts with the first bytes written to the pipe, and ends when the writer closes it.
+        recognizeContinuous(pipeName, CreatePullStreamFromPipe(pipeName, formatName));
+        return 0;
+    }
+
+    if (!continuous || compressedFileNames.empty())
+    {
+        PrintUsage();
+        return 0;
+    }
+
+    recognizeFiles(compressedFileNames, workerCount);
     return 0;
 }
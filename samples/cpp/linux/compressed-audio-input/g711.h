@@ -0,0 +1,203 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// G.711 A-law and mu-law encoding and decoding of 16bit PCM, one byte per sample.
+//
+// The segment (exponent) of a G.711 code is the position of the highest set bit of the sample magnitude, and its
+// 4 bit mantissa are the bits right below it. Converting the magnitude to a float yields both without a loop:
+// the float exponent is the position of the highest set bit and the top 4 bits of the float mantissa follow it.
+// This is exact, as every 16bit integer is representable as a float, and maps to plain SIMD instructions.
+
+// Encodes one sample to mu-law, the reference for the vectorized kernel. Same as the classic bias 0x84 / clip 32635 encoder.
+static inline uint8_t LinearToMuLaw(int16_t sample)
+{
+    int32_t sign = sample < 0 ? 0x80 : 0;
+    int32_t magnitude = sample < 0 ? -static_cast<int32_t>(sample) : sample;
+    magnitude = (magnitude > 32635 ? 32635 : magnitude) + 0x84;
+    float value = static_cast<float>(magnitude);
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    int32_t exponent = static_cast<int32_t>(bits >> 23) - 127 - 7;
+    int32_t mantissa = (bits >> 19) & 0x0f;
+    return static_cast<uint8_t>(~(sign | (exponent << 4) | mantissa));
+}
+
+// Encodes one sample to A-law, the reference for the vectorized kernel. Same as the classic 13 bit segment encoder.
+static inline uint8_t LinearToALaw(int16_t sample)
+{
+    int32_t value = sample >> 3;
+    int32_t mask = value < 0 ? 0x55 : 0xd5;
+    int32_t magnitude = value < 0 ? ~value : value;  // 0 ... 4095
+    int32_t code;
+    if (magnitude < 32)
+    {
+        // Segments 0 and 1 share the step size of 2.
+        code = magnitude >> 1;
+    }
+    else
+    {
+        float f = static_cast<float>(magnitude);
+        uint32_t bits;
+        memcpy(&bits, &f, sizeof(bits));
+        code = ((static_cast<int32_t>(bits >> 23) - 127 - 4) << 4) | ((bits >> 19) & 0x0f);
+    }
+    return static_cast<uint8_t>(code ^ mask);
+}
+
+static inline int16_t MuLawToLinear(uint8_t code)
+{
+    int32_t value = ~code & 0xff;
+    int32_t magnitude = ((((value & 0x0f) << 3) + 0x84) << ((value >> 4) & 0x07)) - 0x84;
+    return static_cast<int16_t>(value & 0x80 ? -magnitude : magnitude);
+}
+
+static inline int16_t ALawToLinear(uint8_t code)
+{
+    int32_t value = code ^ 0x55;
+    int32_t segment = (value >> 4) & 0x07;
+    int32_t magnitude = ((value & 0x0f) << 4) + 8;
+    if (segment != 0)
+    {
+        magnitude = (magnitude + 0x100) << (segment - 1);
+    }
+    return static_cast<int16_t>(value & 0x80 ? magnitude : -magnitude);
+}
+
+#if defined(__SSE2__)
+// Sign-extends the lower or upper 4 samples of 8 to 32bit lanes.
+static inline __m128i G711Widen(__m128i samples, bool upper)
+{
+    return _mm_srai_epi32(upper ? _mm_unpackhi_epi16(samples, samples) : _mm_unpacklo_epi16(samples, samples), 16);
+}
+
+// Float exponent and top 4 mantissa bits of 4 non-negative 32bit integers.
+static inline void G711SegmentAndMantissa(__m128i magnitude, __m128i* exponent, __m128i* mantissa)
+{
+    auto bits = _mm_castps_si128(_mm_cvtepi32_ps(magnitude));
+    *exponent = _mm_srli_epi32(bits, 23);
+    *mantissa = _mm_and_si128(_mm_srli_epi32(bits, 19), _mm_set1_epi32(0x0f));
+}
+
+static inline __m128i MuLawEncode4(__m128i value)
+{
+    auto sign = _mm_srai_epi32(value, 31);
+    auto magnitude = _mm_sub_epi32(_mm_xor_si128(value, sign), sign);
+    auto clip = _mm_set1_epi32(32635);
+    auto overflow = _mm_cmpgt_epi32(magnitude, clip);
+    magnitude = _mm_or_si128(_mm_and_si128(overflow, clip), _mm_andnot_si128(overflow, magnitude));
+    magnitude = _mm_add_epi32(magnitude, _mm_set1_epi32(0x84));
+
+    __m128i exponent, mantissa;
+    G711SegmentAndMantissa(magnitude, &exponent, &mantissa);
+    exponent = _mm_sub_epi32(exponent, _mm_set1_epi32(127 + 7));
+    auto code = _mm_or_si128(_mm_or_si128(_mm_slli_epi32(exponent, 4), mantissa), _mm_and_si128(sign, _mm_set1_epi32(0x80)));
+    return _mm_xor_si128(code, _mm_set1_epi32(0xff));
+}
+
+static inline __m128i ALawEncode4(__m128i value)
+{
+    value = _mm_srai_epi32(value, 3);
+    auto sign = _mm_srai_epi32(value, 31);
+    auto magnitude = _mm_xor_si128(value, sign);
+
+    __m128i exponent, mantissa;
+    G711SegmentAndMantissa(magnitude, &exponent, &mantissa);
+    exponent = _mm_sub_epi32(exponent, _mm_set1_epi32(127 + 4));
+    auto large = _mm_or_si128(_mm_slli_epi32(exponent, 4), mantissa);
+    auto small = _mm_srli_epi32(magnitude, 1);
+    auto isLarge = _mm_cmpgt_epi32(magnitude, _mm_set1_epi32(31));
+    auto code = _mm_or_si128(_mm_and_si128(isLarge, large), _mm_andnot_si128(isLarge, small));
+    auto mask = _mm_xor_si128(_mm_set1_epi32(0xd5), _mm_and_si128(sign, _mm_set1_epi32(0x80)));
+    return _mm_xor_si128(code, mask);
+}
+#endif
+
+// Encodes count samples to mu-law, 16 samples per iteration where SSE2 is available.
+static inline void EncodeMuLaw(const int16_t* samples, uint8_t* codes, size_t count)
+{
+    size_t i = 0;
+#if defined(__SSE2__)
+    for (; i + 16 <= count; i += 16)
+    {
+        auto first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(samples + i));
+        auto second = _mm_loadu_si128(reinterpret_cast<const __m128i*>(samples + i + 8));
+        auto low = _mm_packs_epi32(MuLawEncode4(G711Widen(first, false)), MuLawEncode4(G711Widen(first, true)));
+        auto high = _mm_packs_epi32(MuLawEncode4(G711Widen(second, false)), MuLawEncode4(G711Widen(second, true)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(codes + i), _mm_packus_epi16(low, high));
+    }
+#endif
+    for (; i < count; i++)
+    {
+        codes[i] = LinearToMuLaw(samples[i]);
+    }
+}
+
+// Encodes count samples to A-law, 16 samples per iteration where SSE2 is available.
+static inline void EncodeALaw(const int16_t* samples, uint8_t* codes, size_t count)
+{
+    size_t i = 0;
+#if defined(__SSE2__)
+    for (; i + 16 <= count; i += 16)
+    {
+        auto first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(samples + i));
+        auto second = _mm_loadu_si128(reinterpret_cast<const __m128i*>(samples + i + 8));
+        auto low = _mm_packs_epi32(ALawEncode4(G711Widen(first, false)), ALawEncode4(G711Widen(first, true)));
+        auto high = _mm_packs_epi32(ALawEncode4(G711Widen(second, false)), ALawEncode4(G711Widen(second, true)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(codes + i), _mm_packus_epi16(low, high));
+    }
+#endif
+    for (; i < count; i++)
+    {
+        codes[i] = LinearToALaw(samples[i]);
+    }
+}
+
+// Decoding uses a table of the 256 codes, a single load per sample, which is as fast as arithmetic decoding.
+struct G711DecodeTables
+{
+    int16_t MuLaw[256];
+    int16_t ALaw[256];
+
+    G711DecodeTables()
+    {
+        for (int code = 0; code < 256; code++)
+        {
+            MuLaw[code] = MuLawToLinear(static_cast<uint8_t>(code));
+            ALaw[code] = ALawToLinear(static_cast<uint8_t>(code));
+        }
+    }
+
+    static const G711DecodeTables& Get()
+    {
+        static const G711DecodeTables tables;
+        return tables;
+    }
+};
+
+static inline void DecodeMuLaw(const uint8_t* codes, int16_t* samples, size_t count)
+{
+    const auto& table = G711DecodeTables::Get().MuLaw;
+    for (size_t i = 0; i < count; i++)
+    {
+        samples[i] = table[codes[i]];
+    }
+}
+
+static inline void DecodeALaw(const uint8_t* codes, int16_t* samples, size_t count)
+{
+    const auto& table = G711DecodeTables::Get().ALaw;
+    for (size_t i = 0; i < count; i++)
+    {
+        samples[i] = table[codes[i]];
+    }
+}
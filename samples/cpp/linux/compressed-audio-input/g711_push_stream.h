@@ -0,0 +1,152 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#pragma once
+
+#include <chrono>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+#include <speechapi_cxx.h>
+#include "g711.h"
+
+// A push audio input stream taking 16bit mono PCM, which is sent as 8kHz A-law or mu-law, one byte per sample.
+// 8kHz PCM is sent at half the bytes, 16kHz PCM at a quarter, as it is low-pass filtered and decimated to 8kHz first,
+// the rate the Speech SDK expects for A-law and mu-law. Writes of any size are accepted, PCM frames need not be aligned.
+class G711PushAudioInputStream
+{
+public:
+    struct Statistics
+    {
+        uint64_t PcmBytes = 0;          // written by the application.
+        uint64_t EncodedBytes = 0;      // written to the Speech SDK.
+        double EncodeSeconds = 0;       // spent filtering and encoding.
+    };
+
+    G711PushAudioInputStream(Microsoft::CognitiveServices::Speech::Audio::AudioStreamContainerFormat format, uint32_t pcmSampleRate = 16000) :
+        m_muLaw(format == Microsoft::CognitiveServices::Speech::Audio::AudioStreamContainerFormat::MULAW),
+        m_decimate(pcmSampleRate == 16000)
+    {
+        using namespace Microsoft::CognitiveServices::Speech::Audio;
+        if ((format != AudioStreamContainerFormat::ALAW && format != AudioStreamContainerFormat::MULAW) ||
+            (pcmSampleRate != 8000 && pcmSampleRate != 16000))
+        {
+            throw std::invalid_argument("G.711 streams take 8kHz or 16kHz PCM and send A-law or mu-law.");
+        }
+        m_stream = AudioInputStream::CreatePushStream(AudioStreamFormat::GetCompressedFormat(format));
+
+        if (m_decimate)
+        {
+            // Windowed sinc low-pass at 3.6kHz, below the 4kHz Nyquist frequency of the 8kHz output.
+            const int taps = 31;
+            const double pi = 3.14159265358979323846;
+            const double cutoff = 3600.0 / 16000;
+            for (int i = 0; i < taps; i++)
+            {
+                double n = i - (taps - 1) / 2.0;
+                double sinc = n == 0 ? 2 * cutoff : std::sin(2 * pi * cutoff * n) / (pi * n);
+                double window = 0.54 - 0.46 * std::cos(2 * pi * i / (taps - 1));
+                m_filter.push_back(static_cast<float>(sinc * window));
+            }
+            m_history.assign(taps - 1, 0.0f);
+        }
+    }
+
+    // The stream to create the audio config from.
+    std::shared_ptr<Microsoft::CognitiveServices::Speech::Audio::PushAudioInputStream> GetStream() const { return m_stream; }
+
+    // Encodes and writes little endian 16bit PCM.
+    void Write(const uint8_t* pcm, size_t size)
+    {
+        auto start = std::chrono::steady_clock::now();
+        m_stats.PcmBytes += size;
+
+        // Completes a sample split across writes.
+        m_samples.clear();
+        if (m_hasOddByte && size > 0)
+        {
+            m_samples.push_back(static_cast<int16_t>(m_oddByte | (pcm[0] << 8)));
+            pcm++;
+            size--;
+            m_hasOddByte = false;
+        }
+        auto count = size / 2;
+        auto offset = m_samples.size();
+        m_samples.resize(offset + count);
+        memcpy(m_samples.data() + offset, pcm, count * 2);
+        if (size % 2 != 0)
+        {
+            m_oddByte = pcm[size - 1];
+            m_hasOddByte = true;
+        }
+
+        if (m_decimate)
+        {
+            Decimate();
+        }
+
+        m_codes.resize(m_samples.size());
+        if (m_muLaw)
+        {
+            EncodeMuLaw(m_samples.data(), m_codes.data(), m_samples.size());
+        }
+        else
+        {
+            EncodeALaw(m_samples.data(), m_codes.data(), m_samples.size());
+        }
+        m_stats.EncodeSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        if (!m_codes.empty())
+        {
+            m_stream->Write(m_codes.data(), static_cast<uint32_t>(m_codes.size()));
+            m_stats.EncodedBytes += m_codes.size();
+        }
+    }
+
+    // Signals the end of the audio.
+    void Close()
+    {
+        m_stream->Close();
+    }
+
+    const Statistics& GetStatistics() const { return m_stats; }
+
+private:
+    // Filters the samples and keeps every second one. The last taps - 1 input samples are kept for the next write,
+    // so the output is the same regardless of how the PCM is split into writes.
+    void Decimate()
+    {
+        m_history.insert(m_history.end(), m_samples.begin(), m_samples.end());
+        m_samples.clear();
+
+        auto taps = m_filter.size();
+        size_t position = m_phase;
+        for (; position + taps <= m_history.size(); position += 2)
+        {
+            float sum = 0;
+            for (size_t i = 0; i < taps; i++)
+            {
+                sum += m_filter[i] * m_history[position + i];
+            }
+            sum = sum > 32767.0f ? 32767.0f : (sum < -32768.0f ? -32768.0f : sum);
+            m_samples.push_back(static_cast<int16_t>(std::lrint(sum)));
+        }
+
+        auto consumed = std::min(position, m_history.size() - (taps - 1));
+        m_phase = position - consumed;
+        m_history.erase(m_history.begin(), m_history.begin() + consumed);
+    }
+
+    bool m_muLaw;
+    bool m_decimate;
+    std::shared_ptr<Microsoft::CognitiveServices::Speech::Audio::PushAudioInputStream> m_stream;
+    std::vector<float> m_filter;
+    std::vector<float> m_history;
+    size_t m_phase = 0;
+    std::vector<int16_t> m_samples;
+    std::vector<uint8_t> m_codes;
+    uint8_t m_oddByte = 0;
+    bool m_hasOddByte = false;
+    Statistics m_stats;
+};
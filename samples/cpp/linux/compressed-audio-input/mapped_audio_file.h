@@ -0,0 +1,83 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// A read-only memory mapping of a whole audio file, read by a pull audio input stream.
+// Each read copies straight from the mapped pages into the SDK's buffer, with no stdio buffer in between,
+// and the kernel is told the file is read sequentially so it reads ahead in large chunks.
+class MappedAudioFile
+{
+public:
+    // Maps the file. Returns nullptr if the file cannot be opened or mapped, e.g. if it is empty or not a regular file.
+    static MappedAudioFile* Open(const std::string& fileName)
+    {
+        int fd = open(fileName.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            return nullptr;
+        }
+
+        struct stat fileStat;
+        void* data = MAP_FAILED;
+        if (fstat(fd, &fileStat) == 0 && S_ISREG(fileStat.st_mode) && fileStat.st_size > 0)
+        {
+            data = mmap(nullptr, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        }
+        // The mapping stays valid after the descriptor is closed.
+        close(fd);
+
+        if (data == MAP_FAILED)
+        {
+            return nullptr;
+        }
+        madvise(data, fileStat.st_size, MADV_SEQUENTIAL);
+        return new MappedAudioFile(static_cast<const uint8_t*>(data), fileStat.st_size);
+    }
+
+    ~MappedAudioFile()
+    {
+        munmap(const_cast<uint8_t*>(m_data), m_size);
+    }
+
+    const uint8_t* Data() const { return m_data; }
+    size_t Size() const { return m_size; }
+
+    // Sets the offset of the first byte returned by Read, e.g. to skip a header.
+    void Seek(size_t position)
+    {
+        m_position = std::min(position, m_size);
+    }
+
+    // Pull stream read callback, the context is the MappedAudioFile.
+    static int Read(void* context, uint8_t* buffer, uint32_t size)
+    {
+        auto file = static_cast<MappedAudioFile*>(context);
+        auto count = std::min(static_cast<size_t>(size), file->m_size - file->m_position);
+        memcpy(buffer, file->m_data + file->m_position, count);
+        file->m_position += count;
+        return static_cast<int>(count);
+    }
+
+    // Pull stream close callback, the context is the MappedAudioFile.
+    static void Close(void* context)
+    {
+        delete static_cast<MappedAudioFile*>(context);
+    }
+
+private:
+    MappedAudioFile(const uint8_t* data, size_t size) : m_data(data), m_size(size) {}
+
+    const uint8_t* m_data;
+    size_t m_size;
+    size_t m_position = 0;
+};
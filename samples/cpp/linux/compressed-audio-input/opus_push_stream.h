@@ -0,0 +1,282 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#pragma once
+
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <opus/opus.h>
+#include <speechapi_cxx.h>
+
+// A push audio input stream taking 16bit mono PCM, which is encoded with Opus and sent as an Ogg Opus stream.
+// Each Opus frame is encoded as soon as its PCM is complete, and every framesPerPage frames are sent as one Ogg page,
+// so audio is delayed by at most the duration of one page plus the encoder's lookahead.
+// One frame per page gives the lowest delay, more frames per page save the 28 bytes of Ogg framing per page.
+class OpusPushAudioInputStream
+{
+public:
+    struct Statistics
+    {
+        uint64_t PcmBytes = 0;          // written by the application.
+        uint64_t SentBytes = 0;         // written to the Speech SDK, including the Ogg framing.
+        uint64_t OggOverheadBytes = 0;  // page headers and the Opus header pages.
+        uint64_t Pages = 0;
+        double EncodeSeconds = 0;       // spent in the encoder.
+        double PageDelaySeconds = 0;    // sum over pages of the time from the first PCM of the page arriving until it is sent.
+        uint64_t FailedFrames = 0;      // the encoder failed on, left out of the stream.
+        std::string Error;              // of the encoder, for the last failed frame.
+    };
+
+    // sampleRate is 8000, 12000, 16000, 24000 or 48000. frameMilliseconds is 10, 20, 40 or 60.
+    // lowDelay selects the restricted low delay mode, which has the shortest lookahead but no speech specific coding.
+    OpusPushAudioInputStream(uint32_t sampleRate = 16000, int bitrate = 24000, uint32_t frameMilliseconds = 20, uint32_t framesPerPage = 1, bool lowDelay = false) :
+        m_sampleRate(sampleRate),
+        m_frameSamples(sampleRate / 1000 * frameMilliseconds),
+        m_framesPerPage(framesPerPage == 0 ? 1 : framesPerPage),
+        m_serial(static_cast<uint32_t>(std::chrono::steady_clock::now().time_since_epoch().count()))
+    {
+        using namespace Microsoft::CognitiveServices::Speech::Audio;
+        int error = OPUS_OK;
+        m_encoder = opus_encoder_create(static_cast<opus_int32>(sampleRate), 1, lowDelay ? OPUS_APPLICATION_RESTRICTED_LOWDELAY : OPUS_APPLICATION_VOIP, &error);
+        if (error != OPUS_OK || m_encoder == nullptr)
+        {
+            throw std::runtime_error(std::string("Failed to create the Opus encoder: ") + opus_strerror(error));
+        }
+        opus_encoder_ctl(m_encoder, OPUS_SET_BITRATE(bitrate));
+        opus_encoder_ctl(m_encoder, OPUS_SET_SIGNAL(OPUS_SIGNAL_VOICE));
+        opus_int32 lookahead = 0;
+        opus_encoder_ctl(m_encoder, OPUS_GET_LOOKAHEAD(&lookahead));
+        m_lookaheadSamples = static_cast<uint32_t>(lookahead);
+        // Ogg Opus positions count 48kHz samples, whatever the encoder's rate.
+        m_preSkip = static_cast<uint16_t>(lookahead * (48000 / sampleRate));
+        m_granulePosition = m_preSkip;
+
+        m_stream = AudioInputStream::CreatePushStream(AudioStreamFormat::GetCompressedFormat(AudioStreamContainerFormat::OGG_OPUS));
+        WriteHeaders();
+    }
+
+    ~OpusPushAudioInputStream()
+    {
+        opus_encoder_destroy(m_encoder);
+    }
+
+    // The stream to create the audio config from.
+    std::shared_ptr<Microsoft::CognitiveServices::Speech::Audio::PushAudioInputStream> GetStream() const { return m_stream; }
+
+    // Delay added by encoding, in milliseconds: the PCM of a page is collected before it is sent, and the encoder
+    // looks ahead a few milliseconds. Network transfer time is not included.
+    double AlgorithmicDelayMilliseconds() const
+    {
+        return (m_frameSamples * m_framesPerPage + m_lookaheadSamples) * 1000.0 / m_sampleRate;
+    }
+
+    // Encodes and writes little endian 16bit PCM, sending a page whenever one is complete.
+    void Write(const uint8_t* pcm, size_t size)
+    {
+        auto now = std::chrono::steady_clock::now();
+        m_stats.PcmBytes += size;
+
+        for (size_t i = 0; i < size; i++)
+        {
+            if (m_samples.empty() && m_pagePackets.empty() && !m_hasOddByte)
+            {
+                m_pageStart = now;
+            }
+            if (!m_hasOddByte)
+            {
+                m_oddByte = pcm[i];
+                m_hasOddByte = true;
+                continue;
+            }
+            m_samples.push_back(static_cast<int16_t>(m_oddByte | (pcm[i] << 8)));
+            m_hasOddByte = false;
+            if (m_samples.size() == m_frameSamples)
+            {
+                EncodeFrame(m_frameSamples);
+            }
+        }
+    }
+
+    // Encodes the remaining PCM, padded with silence to a full frame, sends the last page and signals the end of the audio.
+    // The position of the last page ends the audio at its real length, so decoders drop the padding.
+    void Close()
+    {
+        if (!m_samples.empty())
+        {
+            auto samples = m_samples.size();
+            m_samples.resize(m_frameSamples, 0);
+            EncodeFrame(samples);
+        }
+        WritePage(m_pagePackets, m_preSkip + m_encodedSamples * (48000 / m_sampleRate), EndOfStream);
+        m_pagePackets.clear();
+        m_pageSegments = 0;
+        m_stream->Close();
+    }
+
+    const Statistics& GetStatistics() const { return m_stats; }
+
+private:
+    enum PageFlags : uint8_t { BeginOfStream = 0x02, EndOfStream = 0x04 };
+
+    // Encodes the frame of PCM collected, of which realSamples are audio and the rest the padding of the last frame.
+    // A frame the encoder fails on is counted and left out, the stream just gets shorter.
+    void EncodeFrame(size_t realSamples)
+    {
+        auto start = std::chrono::steady_clock::now();
+        std::vector<uint8_t> packet(1275);  // the largest Opus frame.
+        auto size = opus_encode(m_encoder, m_samples.data(), static_cast<int>(m_frameSamples), packet.data(), static_cast<opus_int32>(packet.size()));
+        m_stats.EncodeSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        m_samples.clear();
+        if (size < 0)
+        {
+            m_stats.FailedFrames++;
+            m_stats.Error = opus_strerror(size);
+            return;
+        }
+        packet.resize(static_cast<size_t>(size));
+
+        // A page holds at most 255 lacing values, so it is sent early if the packet would not fit.
+        if (m_pageSegments + SegmentCount(packet) > 255)
+        {
+            SendPage();
+        }
+        m_pageSegments += SegmentCount(packet);
+        m_pagePackets.push_back(std::move(packet));
+        m_granulePosition += m_frameSamples * (48000 / m_sampleRate);
+        m_encodedSamples += realSamples;
+
+        if (m_pagePackets.size() == m_framesPerPage)
+        {
+            SendPage();
+        }
+    }
+
+    void SendPage()
+    {
+        WritePage(m_pagePackets, m_granulePosition, 0);
+        m_stats.PageDelaySeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - m_pageStart).count();
+        m_pagePackets.clear();
+        m_pageSegments = 0;
+    }
+
+    // A packet is split into 255 byte segments, ended by a shorter one, which is 0 if the size is a multiple of 255.
+    static size_t SegmentCount(const std::vector<uint8_t>& packet)
+    {
+        return packet.size() / 255 + 1;
+    }
+
+    // The identification and comment headers, each on a page of its own as required by the Ogg Opus specification.
+    void WriteHeaders()
+    {
+        std::vector<uint8_t> head(19);
+        memcpy(head.data(), "OpusHead", 8);
+        head[8] = 1;                                // version
+        head[9] = 1;                                // mono
+        PutLittleEndian(head.data() + 10, m_preSkip, 2);
+        PutLittleEndian(head.data() + 12, m_sampleRate, 4);
+        // output gain 0 and channel mapping family 0 stay zero.
+        WritePage({ head }, 0, BeginOfStream);
+
+        std::string vendor = opus_get_version_string();
+        std::vector<uint8_t> tags(8 + 4 + vendor.size() + 4);
+        memcpy(tags.data(), "OpusTags", 8);
+        PutLittleEndian(tags.data() + 8, static_cast<uint32_t>(vendor.size()), 4);
+        memcpy(tags.data() + 12, vendor.data(), vendor.size());
+        WritePage({ tags }, 0, 0);
+        m_stats.OggOverheadBytes = m_stats.SentBytes;
+    }
+
+    void WritePage(const std::vector<std::vector<uint8_t>>& packets, uint64_t granulePosition, uint8_t flags)
+    {
+        std::vector<uint8_t> segments;
+        size_t dataSize = 0;
+        for (const auto& packet : packets)
+        {
+            segments.insert(segments.end(), packet.size() / 255, 255);
+            segments.push_back(static_cast<uint8_t>(packet.size() % 255));
+            dataSize += packet.size();
+        }
+        if (segments.size() > 255)
+        {
+            throw std::logic_error("An Ogg page cannot hold more than 255 segments.");
+        }
+
+        std::vector<uint8_t> page(27 + segments.size() + dataSize);
+        memcpy(page.data(), "OggS", 4);
+        page[5] = flags;
+        PutLittleEndian(page.data() + 6, granulePosition, 8);
+        PutLittleEndian(page.data() + 14, m_serial, 4);
+        PutLittleEndian(page.data() + 18, m_pageSequence++, 4);
+        page[26] = static_cast<uint8_t>(segments.size());
+        memcpy(page.data() + 27, segments.data(), segments.size());
+        auto offset = 27 + segments.size();
+        for (const auto& packet : packets)
+        {
+            memcpy(page.data() + offset, packet.data(), packet.size());
+            offset += packet.size();
+        }
+        PutLittleEndian(page.data() + 22, OggCrc(page.data(), page.size()), 4);
+
+        m_stream->Write(page.data(), static_cast<uint32_t>(page.size()));
+        m_stats.SentBytes += page.size();
+        m_stats.OggOverheadBytes += 27 + segments.size();
+        m_stats.Pages++;
+    }
+
+    static void PutLittleEndian(uint8_t* data, uint64_t value, size_t size)
+    {
+        for (size_t i = 0; i < size; i++)
+        {
+            data[i] = static_cast<uint8_t>(value >> (8 * i));
+        }
+    }
+
+    // CRC32 of Ogg pages: polynomial 0x04c11db7, not reflected, initial value and final xor 0.
+    static uint32_t OggCrc(const uint8_t* data, size_t size)
+    {
+        static const std::vector<uint32_t> table = []()
+        {
+            std::vector<uint32_t> entries(256);
+            for (uint32_t i = 0; i < 256; i++)
+            {
+                uint32_t crc = i << 24;
+                for (int bit = 0; bit < 8; bit++)
+                {
+                    crc = crc & 0x80000000 ? (crc << 1) ^ 0x04c11db7 : crc << 1;
+                }
+                entries[i] = crc;
+            }
+            return entries;
+        }();
+
+        uint32_t crc = 0;
+        for (size_t i = 0; i < size; i++)
+        {
+            crc = (crc << 8) ^ table[((crc >> 24) ^ data[i]) & 0xff];
+        }
+        return crc;
+    }
+
+    OpusEncoder* m_encoder = nullptr;
+    uint32_t m_sampleRate;
+    uint32_t m_frameSamples;
+    uint32_t m_framesPerPage;
+    uint32_t m_lookaheadSamples = 0;
+    uint16_t m_preSkip = 0;
+    uint32_t m_serial;
+    uint32_t m_pageSequence = 0;
+    uint64_t m_granulePosition = 0;
+    uint64_t m_encodedSamples = 0;  // of audio in the packets sent, without the padding of the last frame.
+    std::shared_ptr<Microsoft::CognitiveServices::Speech::Audio::PushAudioInputStream> m_stream;
+    std::vector<int16_t> m_samples;
+    std::vector<std::vector<uint8_t>> m_pagePackets;
+    size_t m_pageSegments = 0;
+    std::chrono::steady_clock::time_point m_pageStart;
+    uint8_t m_oddByte = 0;
+    bool m_hasOddByte = false;
+    Statistics m_stats;
+};
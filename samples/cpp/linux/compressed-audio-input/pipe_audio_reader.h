@@ -0,0 +1,179 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+// Reads compressed audio from standard input or a named pipe, for a pull audio input stream.
+// A reader thread drains the pipe into a bounded ring buffer, reading whenever poll reports input, so the producer
+// (e.g. ffmpeg) is not stalled while the SDK is busy, and stops reading when the buffer is full instead of growing
+// without bound.
+// The pull callback hands out data as soon as the first bytes arrive, without waiting for the end of the input.
+class PipeAudioReader
+{
+public:
+    // Opens the pipe, or standard input for "-". Returns nullptr if it cannot be opened.
+    // Opening a named pipe blocks until the writer opened it too, otherwise reads would report the end right away.
+    static PipeAudioReader* Open(const std::string& path, size_t readAheadSize = 1 << 20)
+    {
+        bool isStdin = path == "-";
+        int fd = isStdin ? STDIN_FILENO : open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            return nullptr;
+        }
+        // The descriptor stays blocking: standard input shares its flags with the shell, which would see O_NONBLOCK too.
+        return new PipeAudioReader(fd, !isStdin, readAheadSize);
+    }
+
+    ~PipeAudioReader()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+        }
+        m_spaceAvailable.notify_all();
+        m_thread.join();
+        if (m_ownsFd)
+        {
+            close(m_fd);
+        }
+    }
+
+    // Waits until at least minSize bytes are buffered or the input ends, and returns the start of the input.
+    // Only valid before anything has been read or skipped.
+    const uint8_t* Peek(size_t minSize, size_t* size)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        minSize = std::min(minSize, m_buffer.size());
+        m_dataAvailable.wait(lock, [this, minSize] { return m_size >= minSize || m_endOfInput; });
+        *size = std::min(m_size, m_buffer.size() - m_head);
+        return m_buffer.data() + m_head;
+    }
+
+    // Discards the next bytes, e.g. a header.
+    void Skip(size_t count)
+    {
+        std::vector<uint8_t> discard(std::min<size_t>(count, 4096));
+        while (count > 0)
+        {
+            auto read = ReadData(discard.data(), std::min(count, discard.size()));
+            if (read == 0)
+            {
+                break;
+            }
+            count -= read;
+        }
+    }
+
+    // Pull stream read callback, the context is the PipeAudioReader.
+    // Blocks until data is available, returns 0 at the end of the input.
+    static int Read(void* context, uint8_t* buffer, uint32_t size)
+    {
+        return static_cast<int>(static_cast<PipeAudioReader*>(context)->ReadData(buffer, size));
+    }
+
+    // Pull stream close callback, the context is the PipeAudioReader.
+    static void Close(void* context)
+    {
+        delete static_cast<PipeAudioReader*>(context);
+    }
+
+private:
+    PipeAudioReader(int fd, bool ownsFd, size_t readAheadSize) :
+        m_fd(fd),
+        m_ownsFd(ownsFd),
+        m_buffer(std::max<size_t>(readAheadSize, 4096))
+    {
+        m_thread = std::thread(&PipeAudioReader::Run, this);
+    }
+
+    size_t ReadData(uint8_t* buffer, size_t size)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_dataAvailable.wait(lock, [this] { return m_size > 0 || m_endOfInput; });
+
+        size_t copied = 0;
+        while (copied < size && m_size > 0)
+        {
+            auto count = std::min({ size - copied, m_size, m_buffer.size() - m_head });
+            memcpy(buffer + copied, m_buffer.data() + m_head, count);
+            m_head = (m_head + count) % m_buffer.size();
+            m_size -= count;
+            copied += count;
+        }
+        lock.unlock();
+        m_spaceAvailable.notify_one();
+        return copied;
+    }
+
+    void Run()
+    {
+        while (true)
+        {
+            // Waits for free space in the ring buffer, which bounds the read-ahead.
+            size_t tail, space;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_spaceAvailable.wait(lock, [this] { return m_size < m_buffer.size() || m_stopping; });
+                if (m_stopping)
+                {
+                    break;
+                }
+                tail = (m_head + m_size) % m_buffer.size();
+                space = std::min(m_buffer.size() - m_size, m_buffer.size() - tail);
+            }
+
+            // Waits for input, waking up regularly to notice when the stream is closed early.
+            struct pollfd pfd = { m_fd, POLLIN, 0 };
+            auto ready = poll(&pfd, 1, 100);
+            if (ready == 0 || (ready < 0 && errno == EINTR))
+            {
+                continue;
+            }
+
+            // Only this thread writes the free part of the buffer, so it can be filled without holding the lock.
+            // Input is ready, or the writer closed the pipe, so the read does not block.
+            auto read = ::read(m_fd, m_buffer.data() + tail, space);
+            if (read < 0 && errno == EINTR)
+            {
+                continue;
+            }
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (read <= 0)
+            {
+                // A named pipe reports the end of input when the last writer closes it.
+                m_endOfInput = true;
+                m_dataAvailable.notify_all();
+                break;
+            }
+            m_size += static_cast<size_t>(read);
+            m_dataAvailable.notify_all();
+        }
+    }
+
+    int m_fd;
+    bool m_ownsFd;
+    std::vector<uint8_t> m_buffer;
+    size_t m_head = 0;
+    size_t m_size = 0;
+    bool m_endOfInput = false;
+    bool m_stopping = false;
+    std::mutex m_mutex;
+    std::condition_variable m_dataAvailable;
+    std::condition_variable m_spaceAvailable;
+    std::thread m_thread;
+};
@@ -0,0 +1,164 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#pragma once
+
+#include <speechapi_cxx.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Renders a manifest of prompts to wave files with a pool of synthesizers.
+// Each line of the manifest is one prompt, either plain text or an SSML document starting with "<speak".
+// Line N (counting from 1) is rendered to "<outputDirectory>/prompt_N.wav". Finished lines are appended to a
+// checkpoint file, so an interrupted run resumes where it stopped when started again with the same manifest.
+class BatchSynthesisRenderer final
+{
+public:
+    struct Statistics
+    {
+        size_t Total = 0;           // prompts in the manifest.
+        size_t Skipped = 0;         // prompts already rendered by a previous run.
+        size_t Succeeded = 0;
+        size_t Failed = 0;
+        size_t Retries = 0;
+        double WallSeconds = 0;
+        double AudioSeconds = 0;
+
+        double UtterancesPerSecond() const { return WallSeconds > 0 ? Succeeded / WallSeconds : 0; }
+        double AudioHoursPerHour() const { return WallSeconds > 0 ? AudioSeconds / WallSeconds : 0; }
+    };
+
+    // concurrency is the number of synthesizers running at the same time, maxAttempts the number of tries per prompt.
+    // The output format of the config must be a 16kHz 16bit mono PCM format for the audio duration to be accurate.
+    BatchSynthesisRenderer(std::shared_ptr<Microsoft::CognitiveServices::Speech::SpeechConfig> config, size_t concurrency, size_t maxAttempts = 3) :
+        m_config(config),
+        m_concurrency(concurrency == 0 ? 1 : concurrency),
+        m_maxAttempts(maxAttempts == 0 ? 1 : maxAttempts)
+    {
+    }
+
+    Statistics Render(const std::string& manifestFileName, const std::string& outputDirectory)
+    {
+        using namespace Microsoft::CognitiveServices::Speech;
+
+        std::ifstream manifest(manifestFileName);
+        if (!manifest.good())
+        {
+            throw std::invalid_argument("Failed to open the specified manifest file.");
+        }
+
+        std::vector<std::string> prompts;
+        std::string line;
+        while (getline(manifest, line))
+        {
+            prompts.push_back(line);
+        }
+
+        // Reads the checkpoint of a previous run, then keeps appending to it.
+        auto checkpointFileName = manifestFileName + ".progress";
+        std::set<size_t> done;
+        {
+            std::ifstream checkpoint(checkpointFileName);
+            size_t lineNumber;
+            while (checkpoint >> lineNumber)
+            {
+                done.insert(lineNumber);
+            }
+        }
+        std::ofstream checkpoint(checkpointFileName, std::ios_base::app);
+
+        Statistics stats;
+        stats.Total = prompts.size();
+        std::mutex statsMutex;
+        std::atomic<size_t> next(0);
+        auto startTime = std::chrono::steady_clock::now();
+
+        auto worker = [&]()
+        {
+            // Each worker owns one synthesizer, so its connection is reused across prompts.
+            auto synthesizer = SpeechSynthesizer::FromConfig(m_config, nullptr);
+
+            for (size_t i = next++; i < prompts.size(); i = next++)
+            {
+                auto lineNumber = i + 1;
+                if (done.count(lineNumber) > 0)
+                {
+                    std::lock_guard<std::mutex> lock(statsMutex);
+                    stats.Skipped++;
+                    continue;
+                }
+                if (prompts[i].empty())
+                {
+                    continue;
+                }
+
+                auto isSsml = prompts[i].compare(0, 6, "<speak") == 0;
+                std::shared_ptr<SpeechSynthesisResult> result;
+                for (size_t attempt = 0; attempt < m_maxAttempts; attempt++)
+                {
+                    if (attempt > 0)
+                    {
+                        // Backs off before retrying, e.g. when the service throttles the requests, doubling the
+                        // delay up to 32 seconds, so many attempts neither overflow the shift nor wait for hours.
+                        std::this_thread::sleep_for(std::chrono::milliseconds(500LL << std::min<size_t>(attempt, 6)));
+                        std::lock_guard<std::mutex> lock(statsMutex);
+                        stats.Retries++;
+                    }
+
+                    result = isSsml ? synthesizer->SpeakSsmlAsync(prompts[i]).get() : synthesizer->SpeakTextAsync(prompts[i]).get();
+                    if (result->Reason == ResultReason::SynthesizingAudioCompleted)
+                    {
+                        break;
+                    }
+                }
+
+                if (result->Reason != ResultReason::SynthesizingAudioCompleted)
+                {
+                    auto cancellation = SpeechSynthesisCancellationDetails::FromResult(result);
+                    std::lock_guard<std::mutex> lock(statsMutex);
+                    std::cerr << "Failed to render line " << lineNumber << ": " << cancellation->ErrorDetails << std::endl;
+                    stats.Failed++;
+                    continue;
+                }
+
+                auto fileName = outputDirectory + "/prompt_" + std::to_string(lineNumber) + ".wav";
+                AudioDataStream::FromResult(result)->SaveToWavFile(fileName);
+
+                // 16kHz 16bit mono PCM is 32000 bytes per second.
+                auto audioSeconds = result->GetAudioData()->size() / 32000.0;
+
+                std::lock_guard<std::mutex> lock(statsMutex);
+                checkpoint << lineNumber << std::endl;
+                stats.Succeeded++;
+                stats.AudioSeconds += audioSeconds;
+            }
+        };
+
+        std::vector<std::thread> workers;
+        for (size_t i = 0; i < m_concurrency; i++)
+        {
+            workers.emplace_back(worker);
+        }
+        for (auto& t : workers)
+        {
+            t.join();
+        }
+
+        stats.WallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+        return stats;
+    }
+
+private:
+    std::shared_ptr<Microsoft::CognitiveServices::Speech::SpeechConfig> m_config;
+    size_t m_concurrency;
+    size_t m_maxAttempts;
+};
@@ -0,0 +1,819 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#pragma once
+
+#include <speechapi_cxx.h>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <future>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+// MP3 is encoded with the MP3 encoder of Media Foundation on Windows, and with LAME elsewhere when built with
+// WITH_MP3. Opus needs libopus and is built with WITH_OPUS, e.g. from vcpkg on Windows.
+#ifdef _WIN32
+#include <windows.h>
+#include <mfapi.h>
+#include <mferror.h>
+#include <mfidl.h>
+#include <mftransform.h>
+#include <wmcodecdsp.h>
+#include <wrl/client.h>
+#pragma comment(lib, "mfplat.lib")
+#pragma comment(lib, "mfuuid.lib")
+#pragma comment(lib, "wmcodecdspuuid.lib")
+#define FAN_OUT_ENCODER_MP3
+#elif defined(WITH_MP3)
+#include <lame/lame.h>
+#define FAN_OUT_ENCODER_MP3
+#endif
+
+#ifdef WITH_OPUS
+#include <opus/opus.h>
+#ifdef _MSC_VER
+#pragma comment(lib, "opus.lib")
+#endif
+#endif
+
+// Encodes 16bit mono PCM audio into one output format. The encoded bytes are appended to a buffer rather than
+// written to the file, so the time spent encoding is measured apart from the time spent writing.
+// Begin, Encode and End are called on the same worker thread for one output file, and throw std::runtime_error
+// if encoding fails.
+class AudioEncoder
+{
+public:
+    virtual ~AudioEncoder() {}
+
+    virtual std::string Name() const = 0;
+    virtual std::string FileExtension() const = 0;
+    virtual void Begin(uint32_t sampleRate, std::vector<uint8_t>& output) = 0;
+    virtual void Encode(const int16_t* samples, size_t count, std::vector<uint8_t>& output) = 0;
+    // Appends the rest of the file. Sets header to the bytes that replace the start of the file once it is
+    // complete, e.g. a header with the final sizes, or leaves it empty.
+    virtual void End(std::vector<uint8_t>& output, std::vector<uint8_t>& header) = 0;
+
+protected:
+    static void AppendLittleEndian(std::vector<uint8_t>& output, uint64_t value, size_t size)
+    {
+        for (size_t i = 0; i < size; i++)
+        {
+            output.push_back(static_cast<uint8_t>(value >> (8 * i)));
+        }
+    }
+};
+
+// Writes 16bit PCM wave files. The header is replaced with one holding the final sizes at the end.
+class WavEncoder : public AudioEncoder
+{
+public:
+    std::string Name() const override { return "wav"; }
+    std::string FileExtension() const override { return ".wav"; }
+
+    void Begin(uint32_t sampleRate, std::vector<uint8_t>& output) override
+    {
+        m_sampleRate = sampleRate;
+        m_dataSize = 0;
+        AppendHeader(output);
+    }
+
+    void Encode(const int16_t* samples, size_t count, std::vector<uint8_t>& output) override
+    {
+        auto bytes = reinterpret_cast<const uint8_t*>(samples);
+        output.insert(output.end(), bytes, bytes + count * sizeof(int16_t));
+        m_dataSize += static_cast<uint32_t>(count * sizeof(int16_t));
+    }
+
+    void End(std::vector<uint8_t>&, std::vector<uint8_t>& header) override
+    {
+        AppendHeader(header);
+    }
+
+private:
+    // The canonical 44 byte wave file header.
+    void AppendHeader(std::vector<uint8_t>& output) const
+    {
+        const uint8_t riff[] = { 'R', 'I', 'F', 'F' };
+        const uint8_t waveFormat[] = { 'W', 'A', 'V', 'E', 'f', 'm', 't', ' ' };
+        const uint8_t data[] = { 'd', 'a', 't', 'a' };
+        output.insert(output.end(), riff, riff + sizeof(riff));
+        AppendLittleEndian(output, 36 + m_dataSize, 4);
+        output.insert(output.end(), waveFormat, waveFormat + sizeof(waveFormat));
+        AppendLittleEndian(output, 16, 4);                  // format size
+        AppendLittleEndian(output, 1, 2);                   // PCM
+        AppendLittleEndian(output, 1, 2);                   // mono
+        AppendLittleEndian(output, m_sampleRate, 4);
+        AppendLittleEndian(output, m_sampleRate * 2, 4);    // bytes per second
+        AppendLittleEndian(output, 2, 2);                   // block align
+        AppendLittleEndian(output, 16, 2);                  // bits per sample
+        output.insert(output.end(), data, data + sizeof(data));
+        AppendLittleEndian(output, m_dataSize, 4);
+    }
+
+    uint32_t m_sampleRate = 0;
+    uint32_t m_dataSize = 0;
+};
+
+#ifdef FAN_OUT_ENCODER_MP3
+// Writes constant bitrate MP3 files. The sample rate must be one MP3 supports, e.g. 16000, 24000 or 48000.
+class Mp3Encoder : public AudioEncoder
+{
+public:
+    explicit Mp3Encoder(uint32_t bitrate = 48000) : m_bitrate(bitrate) {}
+
+    ~Mp3Encoder()
+    {
+        Release();
+    }
+
+    std::string Name() const override { return "mp3"; }
+    std::string FileExtension() const override { return ".mp3"; }
+
+#ifdef _WIN32
+    void Begin(uint32_t sampleRate, std::vector<uint8_t>&) override
+    {
+        using Microsoft::WRL::ComPtr;
+        Release();
+        m_sampleRate = sampleRate;
+        m_samplesIn = 0;
+        // The worker thread joins the multithreaded apartment, unless the thread was initialized otherwise already.
+        auto hr = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+        m_comInitialized = SUCCEEDED(hr);
+        ThrowIfFailed(MFStartup(MF_VERSION, MFSTARTUP_LITE), "MFStartup");
+        m_mfStarted = true;
+        ThrowIfFailed(CoCreateInstance(CLSID_MP3ACMCodecWrapper, nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&m_transform)), "Creating the MP3 encoder");
+
+        // The MP3 encoder takes its output type first, and the input type must match it.
+        ComPtr<IMFMediaType> outputType;
+        ThrowIfFailed(MFCreateMediaType(&outputType), "MFCreateMediaType");
+        outputType->SetGUID(MF_MT_MAJOR_TYPE, MFMediaType_Audio);
+        outputType->SetGUID(MF_MT_SUBTYPE, MFAudioFormat_MP3);
+        outputType->SetUINT32(MF_MT_AUDIO_NUM_CHANNELS, 1);
+        outputType->SetUINT32(MF_MT_AUDIO_SAMPLES_PER_SECOND, sampleRate);
+        outputType->SetUINT32(MF_MT_AUDIO_AVG_BYTES_PER_SECOND, m_bitrate / 8);
+        ThrowIfFailed(m_transform->SetOutputType(0, outputType.Get(), 0), "Setting the MP3 output type");
+
+        ComPtr<IMFMediaType> inputType;
+        ThrowIfFailed(MFCreateMediaType(&inputType), "MFCreateMediaType");
+        inputType->SetGUID(MF_MT_MAJOR_TYPE, MFMediaType_Audio);
+        inputType->SetGUID(MF_MT_SUBTYPE, MFAudioFormat_PCM);
+        inputType->SetUINT32(MF_MT_AUDIO_NUM_CHANNELS, 1);
+        inputType->SetUINT32(MF_MT_AUDIO_SAMPLES_PER_SECOND, sampleRate);
+        inputType->SetUINT32(MF_MT_AUDIO_BITS_PER_SAMPLE, 16);
+        inputType->SetUINT32(MF_MT_AUDIO_BLOCK_ALIGNMENT, 2);
+        inputType->SetUINT32(MF_MT_AUDIO_AVG_BYTES_PER_SECOND, sampleRate * 2);
+        ThrowIfFailed(m_transform->SetInputType(0, inputType.Get(), 0), "Setting the MP3 input type");
+
+        ThrowIfFailed(m_transform->ProcessMessage(MFT_MESSAGE_NOTIFY_BEGIN_STREAMING, 0), "Starting the MP3 encoder");
+        ThrowIfFailed(m_transform->ProcessMessage(MFT_MESSAGE_NOTIFY_START_OF_STREAM, 0), "Starting the MP3 encoder");
+    }
+
+    void Encode(const int16_t* samples, size_t count, std::vector<uint8_t>& output) override
+    {
+        using Microsoft::WRL::ComPtr;
+        auto size = static_cast<DWORD>(count * sizeof(int16_t));
+        ComPtr<IMFMediaBuffer> buffer;
+        ThrowIfFailed(MFCreateMemoryBuffer(size, &buffer), "MFCreateMemoryBuffer");
+        BYTE* data = nullptr;
+        ThrowIfFailed(buffer->Lock(&data, nullptr, nullptr), "Locking a buffer");
+        memcpy(data, samples, size);
+        buffer->Unlock();
+        buffer->SetCurrentLength(size);
+
+        ComPtr<IMFSample> sample;
+        ThrowIfFailed(MFCreateSample(&sample), "MFCreateSample");
+        sample->AddBuffer(buffer.Get());
+        sample->SetSampleTime(static_cast<LONGLONG>(m_samplesIn * 10000000 / m_sampleRate));
+        sample->SetSampleDuration(static_cast<LONGLONG>(count * 10000000 / m_sampleRate));
+        m_samplesIn += count;
+
+        HRESULT hr;
+        while ((hr = m_transform->ProcessInput(0, sample.Get(), 0)) == MF_E_NOTACCEPTING)
+        {
+            CollectOutput(output);
+        }
+        ThrowIfFailed(hr, "Encoding MP3");
+        CollectOutput(output);
+    }
+
+    void End(std::vector<uint8_t>& output, std::vector<uint8_t>&) override
+    {
+        ThrowIfFailed(m_transform->ProcessMessage(MFT_MESSAGE_NOTIFY_END_OF_STREAM, 0), "Ending the MP3 stream");
+        ThrowIfFailed(m_transform->ProcessMessage(MFT_MESSAGE_COMMAND_DRAIN, 0), "Draining the MP3 encoder");
+        CollectOutput(output);
+        Release();
+    }
+
+private:
+    // Appends the encoded frames the encoder has ready.
+    void CollectOutput(std::vector<uint8_t>& output)
+    {
+        using Microsoft::WRL::ComPtr;
+        MFT_OUTPUT_STREAM_INFO info = {};
+        ThrowIfFailed(m_transform->GetOutputStreamInfo(0, &info), "GetOutputStreamInfo");
+        bool providesSamples = (info.dwFlags & (MFT_OUTPUT_STREAM_PROVIDES_SAMPLES | MFT_OUTPUT_STREAM_CAN_PROVIDE_SAMPLES)) != 0;
+        while (true)
+        {
+            ComPtr<IMFSample> sample;
+            if (!providesSamples)
+            {
+                ComPtr<IMFMediaBuffer> buffer;
+                ThrowIfFailed(MFCreateMemoryBuffer(info.cbSize > 0 ? info.cbSize : 16384, &buffer), "MFCreateMemoryBuffer");
+                ThrowIfFailed(MFCreateSample(&sample), "MFCreateSample");
+                sample->AddBuffer(buffer.Get());
+            }
+
+            MFT_OUTPUT_DATA_BUFFER outputBuffer = {};
+            outputBuffer.pSample = sample.Get();
+            DWORD status = 0;
+            auto hr = m_transform->ProcessOutput(0, 1, &outputBuffer, &status);
+            if (outputBuffer.pEvents)
+            {
+                outputBuffer.pEvents->Release();
+            }
+            if (providesSamples && outputBuffer.pSample)
+            {
+                // The encoder's sample is handed over with a reference the caller releases.
+                sample.Attach(outputBuffer.pSample);
+            }
+            if (hr == MF_E_TRANSFORM_NEED_MORE_INPUT)
+            {
+                return;
+            }
+            ThrowIfFailed(hr, "Encoding MP3");
+
+            ComPtr<IMFMediaBuffer> buffer;
+            ThrowIfFailed(sample->ConvertToContiguousBuffer(&buffer), "ConvertToContiguousBuffer");
+            BYTE* data = nullptr;
+            DWORD length = 0;
+            ThrowIfFailed(buffer->Lock(&data, nullptr, &length), "Locking a buffer");
+            output.insert(output.end(), data, data + length);
+            buffer->Unlock();
+        }
+    }
+
+    void Release()
+    {
+        m_transform.Reset();
+        if (m_mfStarted)
+        {
+            MFShutdown();
+            m_mfStarted = false;
+        }
+        if (m_comInitialized)
+        {
+            CoUninitialize();
+            m_comInitialized = false;
+        }
+    }
+
+    static void ThrowIfFailed(HRESULT hr, const char* what)
+    {
+        if (FAILED(hr))
+        {
+            char code[16];
+            snprintf(code, sizeof(code), "0x%08lx", static_cast<unsigned long>(hr));
+            throw std::runtime_error(std::string(what) + " failed with " + code);
+        }
+    }
+
+    Microsoft::WRL::ComPtr<IMFTransform> m_transform;
+    uint32_t m_sampleRate = 0;
+    uint64_t m_samplesIn = 0;
+    bool m_comInitialized = false;
+    bool m_mfStarted = false;
+#else
+    void Begin(uint32_t sampleRate, std::vector<uint8_t>&) override
+    {
+        Release();
+        m_lame = lame_init();
+        if (m_lame == nullptr)
+        {
+            throw std::runtime_error("Creating the MP3 encoder failed");
+        }
+        lame_set_in_samplerate(m_lame, static_cast<int>(sampleRate));
+        lame_set_out_samplerate(m_lame, static_cast<int>(sampleRate));
+        lame_set_num_channels(m_lame, 1);
+        lame_set_mode(m_lame, MONO);
+        lame_set_brate(m_lame, static_cast<int>(m_bitrate / 1000));
+        if (lame_init_params(m_lame) < 0)
+        {
+            throw std::runtime_error("The MP3 encoder does not support " + std::to_string(sampleRate) + " Hz at " + std::to_string(m_bitrate) + " bps");
+        }
+    }
+
+    void Encode(const int16_t* samples, size_t count, std::vector<uint8_t>& output) override
+    {
+        // The worst case size given by LAME.
+        auto offset = output.size();
+        output.resize(offset + count * 5 / 4 + 7200);
+        auto size = lame_encode_buffer(m_lame, samples, samples, static_cast<int>(count), output.data() + offset, static_cast<int>(output.size() - offset));
+        if (size < 0)
+        {
+            throw std::runtime_error("Encoding MP3 failed with " + std::to_string(size));
+        }
+        output.resize(offset + static_cast<size_t>(size));
+    }
+
+    void End(std::vector<uint8_t>& output, std::vector<uint8_t>&) override
+    {
+        auto offset = output.size();
+        output.resize(offset + 7200);
+        auto size = lame_encode_flush(m_lame, output.data() + offset, 7200);
+        output.resize(offset + static_cast<size_t>(size > 0 ? size : 0));
+        Release();
+    }
+
+private:
+    void Release()
+    {
+        if (m_lame != nullptr)
+        {
+            lame_close(m_lame);
+            m_lame = nullptr;
+        }
+    }
+
+    lame_t m_lame = nullptr;
+#endif
+
+    uint32_t m_bitrate;
+};
+#endif
+
+#ifdef WITH_OPUS
+// Writes Ogg Opus files with libopus. The sample rate must be 8000, 12000, 16000, 24000 or 48000.
+// The Ogg framing is written directly: the identification and comment headers on pages of their own, then the
+// frames collected into pages of about one second, the last of which tells the exact length.
+class OggOpusEncoder : public AudioEncoder
+{
+public:
+    explicit OggOpusEncoder(int bitrate = 32000, uint32_t frameMilliseconds = 20, uint32_t framesPerPage = 50) :
+        m_bitrate(bitrate),
+        m_frameMilliseconds(frameMilliseconds),
+        m_framesPerPage(framesPerPage == 0 ? 1 : framesPerPage)
+    {
+    }
+
+    ~OggOpusEncoder()
+    {
+        Release();
+    }
+
+    std::string Name() const override { return "opus"; }
+    std::string FileExtension() const override { return ".opus"; }
+
+    void Begin(uint32_t sampleRate, std::vector<uint8_t>& output) override
+    {
+        Release();
+        int error = OPUS_OK;
+        m_encoder = opus_encoder_create(static_cast<opus_int32>(sampleRate), 1, OPUS_APPLICATION_AUDIO, &error);
+        if (error != OPUS_OK || m_encoder == nullptr)
+        {
+            throw std::runtime_error(std::string("Creating the Opus encoder failed: ") + opus_strerror(error));
+        }
+        opus_encoder_ctl(m_encoder, OPUS_SET_BITRATE(m_bitrate));
+        opus_encoder_ctl(m_encoder, OPUS_SET_SIGNAL(OPUS_SIGNAL_VOICE));
+        opus_int32 lookahead = 0;
+        opus_encoder_ctl(m_encoder, OPUS_GET_LOOKAHEAD(&lookahead));
+
+        m_sampleRate = sampleRate;
+        m_frameSamples = sampleRate / 1000 * m_frameMilliseconds;
+        // Ogg Opus positions count 48kHz samples, whatever the encoder's rate.
+        m_preSkip = static_cast<uint16_t>(lookahead * (48000 / sampleRate));
+        m_granulePosition = m_preSkip;
+        m_samplesIn = 0;
+        m_pageSequence = 0;
+        m_serial = static_cast<uint32_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+        m_samples.clear();
+        m_pagePackets.clear();
+        m_pageSegments = 0;
+
+        std::vector<uint8_t> head;
+        const char opusHead[] = "OpusHead";
+        head.insert(head.end(), opusHead, opusHead + 8);
+        head.push_back(1);                              // version
+        head.push_back(1);                              // mono
+        AppendLittleEndian(head, m_preSkip, 2);
+        AppendLittleEndian(head, sampleRate, 4);
+        AppendLittleEndian(head, 0, 2);                 // output gain
+        head.push_back(0);                              // channel mapping family
+        AppendPage(output, { head }, 0, BeginOfStream);
+
+        std::string vendor = opus_get_version_string();
+        std::vector<uint8_t> tags;
+        const char opusTags[] = "OpusTags";
+        tags.insert(tags.end(), opusTags, opusTags + 8);
+        AppendLittleEndian(tags, vendor.size(), 4);
+        tags.insert(tags.end(), vendor.begin(), vendor.end());
+        AppendLittleEndian(tags, 0, 4);                 // no comments
+        AppendPage(output, { tags }, 0, 0);
+    }
+
+    void Encode(const int16_t* samples, size_t count, std::vector<uint8_t>& output) override
+    {
+        m_samplesIn += count;
+        for (size_t i = 0; i < count; i++)
+        {
+            m_samples.push_back(samples[i]);
+            if (m_samples.size() == m_frameSamples)
+            {
+                EncodeFrame(output);
+            }
+        }
+    }
+
+    void End(std::vector<uint8_t>& output, std::vector<uint8_t>&) override
+    {
+        if (!m_samples.empty())
+        {
+            m_samples.resize(m_frameSamples, 0);
+            EncodeFrame(output);
+        }
+        // The position of the last page ends the audio at its real length, without the padding of the last frame.
+        AppendPage(output, m_pagePackets, m_preSkip + m_samplesIn * (48000 / m_sampleRate), EndOfStream);
+        m_pagePackets.clear();
+        m_pageSegments = 0;
+        Release();
+    }
+
+private:
+    enum PageFlags : uint8_t { BeginOfStream = 0x02, EndOfStream = 0x04 };
+
+    void EncodeFrame(std::vector<uint8_t>& output)
+    {
+        std::vector<uint8_t> packet(1275);  // the largest Opus frame.
+        auto size = opus_encode(m_encoder, m_samples.data(), static_cast<int>(m_frameSamples), packet.data(), static_cast<opus_int32>(packet.size()));
+        m_samples.clear();
+        if (size < 0)
+        {
+            throw std::runtime_error(std::string("Encoding Opus failed: ") + opus_strerror(size));
+        }
+        packet.resize(static_cast<size_t>(size));
+
+        // A page holds at most 255 lacing values, so it is ended early if the packet would not fit.
+        if (m_pageSegments + SegmentCount(packet) > 255)
+        {
+            AppendPage(output, m_pagePackets, m_granulePosition, 0);
+            m_pagePackets.clear();
+            m_pageSegments = 0;
+        }
+        m_pageSegments += SegmentCount(packet);
+        m_pagePackets.push_back(std::move(packet));
+        m_granulePosition += m_frameSamples * (48000 / m_sampleRate);
+        if (m_pagePackets.size() == m_framesPerPage)
+        {
+            AppendPage(output, m_pagePackets, m_granulePosition, 0);
+            m_pagePackets.clear();
+            m_pageSegments = 0;
+        }
+    }
+
+    // A packet is split into 255 byte segments, ended by a shorter one, which is 0 if the size is a multiple of 255.
+    static size_t SegmentCount(const std::vector<uint8_t>& packet)
+    {
+        return packet.size() / 255 + 1;
+    }
+
+    void AppendPage(std::vector<uint8_t>& output, const std::vector<std::vector<uint8_t>>& packets, uint64_t granulePosition, uint8_t flags)
+    {
+        std::vector<uint8_t> segments;
+        for (const auto& packet : packets)
+        {
+            segments.insert(segments.end(), packet.size() / 255, 255);
+            segments.push_back(static_cast<uint8_t>(packet.size() % 255));
+        }
+        if (segments.size() > 255)
+        {
+            throw std::logic_error("An Ogg page cannot hold more than 255 segments.");
+        }
+
+        auto start = output.size();
+        const char capture[] = "OggS";
+        output.insert(output.end(), capture, capture + 4);
+        output.push_back(0);                            // version
+        output.push_back(flags);
+        AppendLittleEndian(output, granulePosition, 8);
+        AppendLittleEndian(output, m_serial, 4);
+        AppendLittleEndian(output, m_pageSequence++, 4);
+        AppendLittleEndian(output, 0, 4);               // checksum, computed over the page with this field 0
+        output.push_back(static_cast<uint8_t>(segments.size()));
+        output.insert(output.end(), segments.begin(), segments.end());
+        for (const auto& packet : packets)
+        {
+            output.insert(output.end(), packet.begin(), packet.end());
+        }
+
+        auto crc = OggCrc(output.data() + start, output.size() - start);
+        for (size_t i = 0; i < 4; i++)
+        {
+            output[start + 22 + i] = static_cast<uint8_t>(crc >> (8 * i));
+        }
+    }
+
+    // CRC32 of Ogg pages: polynomial 0x04c11db7, not reflected, initial value and final xor 0.
+    static uint32_t OggCrc(const uint8_t* data, size_t size)
+    {
+        static const std::vector<uint32_t> table = []()
+        {
+            std::vector<uint32_t> entries(256);
+            for (uint32_t i = 0; i < 256; i++)
+            {
+                uint32_t crc = i << 24;
+                for (int bit = 0; bit < 8; bit++)
+                {
+                    crc = crc & 0x80000000 ? (crc << 1) ^ 0x04c11db7 : crc << 1;
+                }
+                entries[i] = crc;
+            }
+            return entries;
+        }();
+
+        uint32_t crc = 0;
+        for (size_t i = 0; i < size; i++)
+        {
+            crc = (crc << 8) ^ table[((crc >> 24) ^ data[i]) & 0xff];
+        }
+        return crc;
+    }
+
+    void Release()
+    {
+        if (m_encoder != nullptr)
+        {
+            opus_encoder_destroy(m_encoder);
+            m_encoder = nullptr;
+        }
+    }
+
+    OpusEncoder* m_encoder = nullptr;
+    int m_bitrate;
+    uint32_t m_frameMilliseconds;
+    uint32_t m_framesPerPage;
+    uint32_t m_sampleRate = 0;
+    uint32_t m_frameSamples = 0;
+    uint16_t m_preSkip = 0;
+    uint32_t m_serial = 0;
+    uint32_t m_pageSequence = 0;
+    uint64_t m_granulePosition = 0;
+    uint64_t m_samplesIn = 0;
+    std::vector<int16_t> m_samples;
+    std::vector<std::vector<uint8_t>> m_pagePackets;
+    size_t m_pageSegments = 0;
+};
+#endif
+
+// A push audio output stream callback that encodes the synthesized PCM audio into several formats at once,
+// so one synthesis request replaces one request per format.
+// Each encoder runs on its own worker thread; the Write callback only copies the chunk and queues it.
+// Call Begin before each synthesis request and End after it completed.
+class FanOutEncoder : public Microsoft::CognitiveServices::Speech::Audio::PushAudioOutputStreamCallback
+{
+public:
+    // The cost of one output of one request.
+    struct Report
+    {
+        std::string Encoder;
+        std::string FileName;
+        uint64_t BytesIn = 0;
+        uint64_t BytesOut = 0;
+        double EncodeMilliseconds = 0;  // spent in the encoder only.
+        double WriteMilliseconds = 0;   // spent writing the file.
+        std::string Error;              // empty if the file was written completely.
+    };
+
+    // sampleRate must match the raw PCM output format set on the speech config, e.g. 24000 for Raw24Khz16BitMonoPcm.
+    FanOutEncoder(const std::vector<std::shared_ptr<AudioEncoder>>& encoders, uint32_t sampleRate) :
+        m_sampleRate(sampleRate)
+    {
+        for (auto& encoder : encoders)
+        {
+            m_workers.emplace_back(new Worker(encoder));
+        }
+        for (auto& worker : m_workers)
+        {
+            worker->Thread = std::thread(&FanOutEncoder::Run, this, worker.get());
+        }
+    }
+
+    ~FanOutEncoder()
+    {
+        for (auto& worker : m_workers)
+        {
+            Post(*worker, Task(TaskType::Stop));
+            worker->Thread.join();
+        }
+    }
+
+    // Starts new output files named baseFileName followed by the extension of each encoder.
+    void Begin(const std::string& baseFileName)
+    {
+        m_hasOddByte = false;
+        for (auto& worker : m_workers)
+        {
+            Task task{ TaskType::Begin };
+            task.FileName = baseFileName + worker->Encoder->FileExtension();
+            Post(*worker, std::move(task));
+        }
+    }
+
+    // Waits until all encoders have finished the current files and returns what each of them cost.
+    std::vector<Report> End()
+    {
+        std::vector<std::future<Report>> futures;
+        for (auto& worker : m_workers)
+        {
+            Task task{ TaskType::End };
+            task.Done = std::make_shared<std::promise<Report>>();
+            futures.push_back(task.Done->get_future());
+            Post(*worker, std::move(task));
+        }
+
+        std::vector<Report> reports;
+        for (auto& f : futures)
+        {
+            reports.push_back(f.get());
+        }
+        return reports;
+    }
+
+    int Write(uint8_t* dataBuffer, uint32_t size) override
+    {
+        // Chunks are not guaranteed to hold whole samples, so an odd trailing byte is carried to the next chunk.
+        auto chunk = std::make_shared<std::vector<uint8_t>>();
+        chunk->reserve(size + 1);
+        if (m_hasOddByte)
+        {
+            chunk->push_back(m_oddByte);
+        }
+        chunk->insert(chunk->end(), dataBuffer, dataBuffer + size);
+        m_hasOddByte = chunk->size() % 2 != 0;
+        if (m_hasOddByte)
+        {
+            m_oddByte = chunk->back();
+            chunk->pop_back();
+        }
+
+        // All workers share the same immutable chunk.
+        for (auto& worker : m_workers)
+        {
+            Task task{ TaskType::Data };
+            task.Data = chunk;
+            Post(*worker, std::move(task));
+        }
+        return size;
+    }
+
+    void Close() override
+    {
+    }
+
+private:
+    enum class TaskType { Begin, Data, End, Stop };
+
+    struct Task
+    {
+        explicit Task(TaskType type = TaskType::Stop) : Type(type) {}
+
+        TaskType Type;
+        std::shared_ptr<const std::vector<uint8_t>> Data;
+        std::string FileName;
+        std::shared_ptr<std::promise<Report>> Done;
+    };
+
+    struct Worker
+    {
+        explicit Worker(std::shared_ptr<AudioEncoder> encoder) : Encoder(encoder) {}
+
+        std::shared_ptr<AudioEncoder> Encoder;
+        std::thread Thread;
+        std::mutex Mutex;
+        std::condition_variable Ready;
+        std::deque<Task> Queue;
+    };
+
+    void Post(Worker& worker, Task&& task)
+    {
+        {
+            std::lock_guard<std::mutex> lock(worker.Mutex);
+            worker.Queue.push_back(std::move(task));
+        }
+        worker.Ready.notify_one();
+    }
+
+    void Run(Worker* worker)
+    {
+        using Clock = std::chrono::steady_clock;
+        std::ofstream file;
+        std::vector<uint8_t> encoded;
+        std::vector<uint8_t> header;
+        Report report;
+
+        while (true)
+        {
+            Task task;
+            {
+                std::unique_lock<std::mutex> lock(worker->Mutex);
+                worker->Ready.wait(lock, [worker] { return !worker->Queue.empty(); });
+                task = std::move(worker->Queue.front());
+                worker->Queue.pop_front();
+            }
+            if (task.Type == TaskType::Stop)
+            {
+                return;
+            }
+
+            try
+            {
+                encoded.clear();
+                auto start = Clock::now();
+                switch (task.Type)
+                {
+                case TaskType::Begin:
+                    report = Report();
+                    report.Encoder = worker->Encoder->Name();
+                    report.FileName = task.FileName;
+                    file.open(task.FileName, std::ios_base::binary | std::ios_base::out | std::ios_base::trunc);
+                    if (!file.is_open())
+                    {
+                        throw std::runtime_error("Cannot open " + task.FileName);
+                    }
+                    start = Clock::now();
+                    worker->Encoder->Begin(m_sampleRate, encoded);
+                    break;
+                case TaskType::Data:
+                    if (file.is_open())
+                    {
+                        worker->Encoder->Encode(reinterpret_cast<const int16_t*>(task.Data->data()), task.Data->size() / sizeof(int16_t), encoded);
+                        report.BytesIn += task.Data->size();
+                    }
+                    break;
+                case TaskType::End:
+                    if (file.is_open())
+                    {
+                        header.clear();
+                        worker->Encoder->End(encoded, header);
+                    }
+                    break;
+                default:
+                    break;
+                }
+                auto encodedTime = Clock::now();
+                report.EncodeMilliseconds += std::chrono::duration<double, std::milli>(encodedTime - start).count();
+
+                if (file.is_open())
+                {
+                    file.write(reinterpret_cast<const char*>(encoded.data()), encoded.size());
+                    report.BytesOut += encoded.size();
+                    if (task.Type == TaskType::End)
+                    {
+                        if (!header.empty())
+                        {
+                            file.seekp(0);
+                            file.write(reinterpret_cast<const char*>(header.data()), header.size());
+                        }
+                        file.close();
+                        if (file.fail())
+                        {
+                            throw std::runtime_error("Cannot write " + report.FileName);
+                        }
+                    }
+                    else if (file.fail())
+                    {
+                        throw std::runtime_error("Cannot write " + report.FileName);
+                    }
+                }
+                report.WriteMilliseconds += std::chrono::duration<double, std::milli>(Clock::now() - encodedTime).count();
+            }
+            catch (const std::exception& e)
+            {
+                // The rest of the request is dropped for this output, the other outputs go on.
+                if (report.Error.empty())
+                {
+                    report.Error = e.what();
+                }
+                file.close();
+                file.clear();
+            }
+
+            if (task.Type == TaskType::End)
+            {
+                file.clear();
+                task.Done->set_value(report);
+            }
+        }
+    }
+
+    uint32_t m_sampleRate;
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    bool m_hasOddByte = false;
+    uint8_t m_oddByte = 0;
+};
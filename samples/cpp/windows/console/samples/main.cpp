@@ -37,6 +37,13 @@ extern void SpeechSynthesisEvents();
 extern void SpeechSynthesisWordBoundaryEvent();
 extern void SpeechSynthesisWithSourceLanguageAutoDetection();
 extern void SpeechSynthesisUsingCustomVoice();
+extern void SpeechSynthesisWithStreamingMetrics();
+extern void SpeechSynthesisWithWordBoundaryIndex();
+extern void SpeechSynthesisBatchRendering();
+extern void SpeechSynthesisToMultipleFormats();
+extern void SpeechSynthesisBatchedSsml();
+extern void SpeechSynthesisToPullAudioOutputStreamWithFileWriter();
+extern void SpeechSynthesisToSharedAudioBuffer();
 
 extern void ConversationWithPullAudioStream();
 extern void ConversationWithPushAudioStream();
@@ -177,6 +184,13 @@ void SpeechSynthesisSamples()
         cout << "B.) Speech synthesis word boundary event.\n";
         cout << "C.) Speech synthesis with source language auto detection\n";
         cout << "D.) Speech synthesis using Custom Voice\n";
+        cout << "E.) Speech synthesis with streaming metrics\n";
+        cout << "F.) Speech synthesis with word boundary index and subtitles\n";
+        cout << "G.) Speech synthesis of a batch of prompts to wave files\n";
+        cout << "H.) Speech synthesis encoded to multiple formats from one request\n";
+        cout << "I.) Speech synthesis of short texts batched into SSML requests\n";
+        cout << "J.) Speech synthesis to pull audio output stream drained to file while synthesizing\n";
+        cout << "K.) Speech synthesis to shared audio buffer read by concurrent consumers\n";
         cout << "\nChoice (0 for MAIN MENU): ";
         cout.flush();
 
@@ -227,6 +241,35 @@ void SpeechSynthesisSamples()
         case 'D':
         case 'd':
             SpeechSynthesisUsingCustomVoice();
+            break;
+        case 'E':
+        case 'e':
+            SpeechSynthesisWithStreamingMetrics();
+            break;
+        case 'F':
+        case 'f':
+            SpeechSynthesisWithWordBoundaryIndex();
+            break;
+        case 'G':
+        case 'g':
+            SpeechSynthesisBatchRendering();
+            break;
+        case 'H':
+        case 'h':
+            SpeechSynthesisToMultipleFormats();
+            break;
+        case 'I':
+        case 'i':
+            SpeechSynthesisBatchedSsml();
+            break;
+        case 'J':
+        case 'j':
+            SpeechSynthesisToPullAudioOutputStreamWithFileWriter();
+            break;
+        case 'K':
+        case 'k':
+            SpeechSynthesisToSharedAudioBuffer();
+            break;
         case '0':
             break;
         }
@@ -0,0 +1,247 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#pragma once
+
+#include <speechapi_cxx.h>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#include <malloc.h>
+#include <sys/stat.h>
+#else
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+#endif
+
+// Drains a pull audio output stream to a file on a worker thread while synthesis is running, instead of letting
+// the stream buffer all audio until the synthesizer is destroyed.
+// Audio is collected into one aligned block of blockSize bytes and written with a single system call per block.
+// With directIo the file is opened with O_DIRECT (Linux only), bypassing the page cache for large renders.
+// If sampleRate is not 0 the raw 16bit mono PCM is wrapped into a wave file, whose header is fixed up at the end.
+class PullStreamFileWriter final
+{
+public:
+    struct Statistics
+    {
+        uint64_t AudioBytes = 0;
+        uint64_t Blocks = 0;                // number of full block writes.
+        size_t BufferBytes = 0;             // memory held by the writer, independent of the audio length.
+        double FirstWriteMilliseconds = 0;  // from Start to the first block on disk.
+        double TotalMilliseconds = 0;       // from Start to the file being complete.
+        bool WriteFailed = false;
+    };
+
+    PullStreamFileWriter(std::shared_ptr<Microsoft::CognitiveServices::Speech::Audio::PullAudioOutputStream> stream,
+        const std::string& fileName, uint32_t sampleRate, size_t blockSize = 1 << 20, bool directIo = false) :
+        m_stream(stream),
+        m_sampleRate(sampleRate),
+        m_blockSize(RoundUp(blockSize < Alignment ? Alignment : blockSize, Alignment)),
+        m_directIo(false)
+    {
+#ifdef _WIN32
+        (void)directIo;
+        m_fd = _open(fileName.c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+        m_buffer = static_cast<uint8_t*>(_aligned_malloc(m_blockSize, Alignment));
+#else
+        int flags = O_WRONLY | O_CREAT | O_TRUNC;
+#ifdef O_DIRECT
+        if (directIo)
+        {
+            m_fd = open(fileName.c_str(), flags | O_DIRECT, 0644);
+            m_directIo = m_fd >= 0;
+        }
+#else
+        (void)directIo;
+#endif
+        if (!m_directIo)
+        {
+            m_fd = open(fileName.c_str(), flags, 0644);
+        }
+        void* buffer = nullptr;
+        m_buffer = posix_memalign(&buffer, Alignment, m_blockSize) == 0 ? static_cast<uint8_t*>(buffer) : nullptr;
+#endif
+        if (m_fd < 0 || m_buffer == nullptr)
+        {
+            Release();
+            throw std::runtime_error("Failed to open the output file.");
+        }
+        m_stats.BufferBytes = m_blockSize;
+    }
+
+    ~PullStreamFileWriter()
+    {
+        if (m_thread.joinable())
+        {
+            m_thread.join();
+        }
+        Release();
+    }
+
+    // Starts draining. Call it before the first synthesis request.
+    void Start()
+    {
+        m_startTime = std::chrono::steady_clock::now();
+        m_thread = std::thread(&PullStreamFileWriter::Run, this);
+    }
+
+    // Waits until the stream ends, which happens when the synthesizer is destroyed, and completes the file.
+    Statistics Wait()
+    {
+        if (m_thread.joinable())
+        {
+            m_thread.join();
+        }
+        return m_stats;
+    }
+
+    static constexpr size_t WavHeaderSize = 44;
+
+    // Fills the 44 byte header of a wave file holding dataSize bytes of 16bit mono PCM.
+    static void WriteWavHeader(uint8_t* header, uint32_t sampleRate, uint64_t dataSize)
+    {
+        auto size = static_cast<uint32_t>(dataSize);
+        auto put16 = [&header](size_t offset, uint16_t value) { header[offset] = value & 0xff; header[offset + 1] = value >> 8; };
+        auto put32 = [&put16](size_t offset, uint32_t value) { put16(offset, value & 0xffff); put16(offset + 2, value >> 16); };
+
+        memcpy(header, "RIFF", 4);
+        put32(4, 36 + size);
+        memcpy(header + 8, "WAVEfmt ", 8);
+        put32(16, 16);
+        put16(20, 1);                   // PCM
+        put16(22, 1);                   // mono
+        put32(24, sampleRate);
+        put32(28, sampleRate * 2);      // 16bit samples
+        put16(32, 2);
+        put16(34, 16);
+        memcpy(header + 36, "data", 4);
+        put32(40, size);
+    }
+
+private:
+    static constexpr size_t Alignment = 4096;
+
+    static size_t RoundUp(size_t value, size_t alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    void Release()
+    {
+#ifdef _WIN32
+        if (m_fd >= 0)
+        {
+            _close(m_fd);
+        }
+        _aligned_free(m_buffer);
+#else
+        if (m_fd >= 0)
+        {
+            close(m_fd);
+        }
+        free(m_buffer);
+#endif
+    }
+
+    void Run()
+    {
+        // The header is reserved at the start of the first block, so every block write stays aligned.
+        size_t filled = m_sampleRate != 0 ? WavHeaderSize : 0;
+        if (filled > 0)
+        {
+            WriteWavHeader(m_buffer, m_sampleRate, 0);
+        }
+
+        uint32_t read = 0;
+        while ((read = m_stream->Read(m_buffer + filled, static_cast<uint32_t>(m_blockSize - filled))) > 0)
+        {
+            filled += read;
+            m_stats.AudioBytes += read;
+            if (filled == m_blockSize)
+            {
+                WriteAll(m_buffer, m_blockSize);
+                if (m_stats.Blocks++ == 0)
+                {
+                    m_stats.FirstWriteMilliseconds = ElapsedMilliseconds();
+                }
+                filled = 0;
+            }
+        }
+
+        // The tail is not a multiple of the alignment, so it is written with buffered I/O.
+#if !defined(_WIN32) && defined(O_DIRECT)
+        if (m_directIo)
+        {
+            fcntl(m_fd, F_SETFL, fcntl(m_fd, F_GETFL) & ~O_DIRECT);
+        }
+#endif
+        WriteAll(m_buffer, filled);
+        if (m_stats.Blocks == 0)
+        {
+            m_stats.FirstWriteMilliseconds = ElapsedMilliseconds();
+        }
+
+        if (m_sampleRate != 0)
+        {
+            uint8_t header[WavHeaderSize];
+            WriteWavHeader(header, m_sampleRate, m_stats.AudioBytes);
+#ifdef _WIN32
+            if (_lseeki64(m_fd, 0, SEEK_SET) != 0 || _write(m_fd, header, WavHeaderSize) != static_cast<int>(WavHeaderSize))
+            {
+                m_failed = true;
+            }
+#else
+            if (pwrite(m_fd, header, WavHeaderSize, 0) != static_cast<ssize_t>(WavHeaderSize))
+            {
+                m_failed = true;
+            }
+#endif
+        }
+        m_stats.TotalMilliseconds = ElapsedMilliseconds();
+        m_stats.WriteFailed = m_failed;
+    }
+
+    void WriteAll(const uint8_t* data, size_t size)
+    {
+        while (size > 0 && !m_failed)
+        {
+#ifdef _WIN32
+            auto written = _write(m_fd, data, static_cast<unsigned int>(size));
+#else
+            auto written = write(m_fd, data, size);
+#endif
+            if (written <= 0)
+            {
+                // Stops writing but keeps draining, so the synthesizer is never blocked by a full stream.
+                m_failed = true;
+                break;
+            }
+            data += written;
+            size -= static_cast<size_t>(written);
+        }
+    }
+
+    double ElapsedMilliseconds() const
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_startTime).count();
+    }
+
+    std::shared_ptr<Microsoft::CognitiveServices::Speech::Audio::PullAudioOutputStream> m_stream;
+    uint32_t m_sampleRate;
+    size_t m_blockSize;
+    bool m_directIo;
+    bool m_failed = false;
+    int m_fd = -1;
+    uint8_t* m_buffer = nullptr;
+    std::thread m_thread;
+    std::chrono::steady_clock::time_point m_startTime;
+    Statistics m_stats;
+};
@@ -0,0 +1,92 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#pragma once
+
+#include <speechapi_cxx.h>
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+// An immutable, reference counted view of synthesized audio.
+// Copying or slicing a view never copies the audio, and the audio lives as long as any view of it does,
+// so it can be handed to several consumers (file writer, playback, cache, analytics) on different threads.
+class SharedAudioBuffer final
+{
+public:
+    SharedAudioBuffer() = default;
+
+    // Takes over the audio of a synthesis result without copying it.
+    static SharedAudioBuffer FromResult(std::shared_ptr<Microsoft::CognitiveServices::Speech::SpeechSynthesisResult> result)
+    {
+        return SharedAudioBuffer(result->GetAudioData());
+    }
+
+    explicit SharedAudioBuffer(std::shared_ptr<const std::vector<uint8_t>> data) :
+        m_data(std::move(data)),
+        m_offset(0),
+        m_size(m_data ? m_data->size() : 0)
+    {
+    }
+
+    const uint8_t* Data() const { return m_size == 0 ? nullptr : m_data->data() + m_offset; }
+    size_t Size() const { return m_size; }
+    bool Empty() const { return m_size == 0; }
+
+    // Gets a view of a part of this view, sharing the same audio.
+    SharedAudioBuffer Slice(size_t offset, size_t size) const
+    {
+        if (offset > m_size)
+        {
+            throw std::out_of_range("Slice offset is beyond the end of the audio buffer.");
+        }
+        SharedAudioBuffer slice(*this);
+        slice.m_offset += offset;
+        slice.m_size = std::min(size, m_size - offset);
+        return slice;
+    }
+
+    // Number of views sharing the audio, including this one.
+    long UseCount() const { return m_data.use_count(); }
+
+private:
+    std::shared_ptr<const std::vector<uint8_t>> m_data;
+    size_t m_offset = 0;
+    size_t m_size = 0;
+};
+
+// A read cursor over a shared audio buffer. Each consumer owns its own reader, so consumers never contend.
+class SharedAudioBufferReader final
+{
+public:
+    explicit SharedAudioBufferReader(SharedAudioBuffer buffer) : m_buffer(std::move(buffer)) {}
+
+    // Gets the next chunk of up to maxSize bytes as a view, without copying. Returns an empty view at the end.
+    SharedAudioBuffer Next(size_t maxSize)
+    {
+        auto chunk = m_buffer.Slice(m_position, maxSize);
+        m_position += chunk.Size();
+        return chunk;
+    }
+
+    // Copies the next bytes into dataBuffer, for consumers that need their own memory, e.g. audio device buffers.
+    uint32_t Read(uint8_t* dataBuffer, uint32_t size)
+    {
+        auto chunk = Next(size);
+        if (!chunk.Empty())
+        {
+            memcpy(dataBuffer, chunk.Data(), chunk.Size());
+        }
+        return static_cast<uint32_t>(chunk.Size());
+    }
+
+    size_t Position() const { return m_position; }
+    void SetPosition(size_t position) { m_position = std::min(position, m_buffer.Size()); }
+
+private:
+    SharedAudioBuffer m_buffer;
+    size_t m_position = 0;
+};
@@ -6,7 +6,18 @@
 #include "stdafx.h"
 
 #include <speechapi_cxx.h>
+#include <chrono>
 #include <fstream>
+#include <iomanip>
+#include <future>
+#include <map>
+#include "batch_synthesis_renderer.h"
+#include "fan_out_encoder.h"
+#include "pull_stream_file_writer.h"
+#include "shared_audio_buffer.h"
+#include "ssml_batch_synthesizer.h"
+#include "synthesis_metrics.h"
+#include "word_boundary_index.h"
 
 using namespace std;
 using namespace Microsoft::CognitiveServices::Speech;
@@ -369,6 +380,113 @@ void SpeechSynthesisToPullAudioOutputStream()
     cout << "Totally " << totalSize << " bytes received." << endl;
 }
 
+// Speech synthesis to pull audio output stream, drained to a wave file on a worker thread while synthesizing.
+// Compares it with reading the stream only once the synthesizer is destroyed, which synthesizes the texts twice.
+void SpeechSynthesisToPullAudioOutputStreamWithFileWriter()
+{
+    // Creates an instance of a speech config with specified subscription key and service region.
+    // Replace with your own subscription key and service region (e.g., "westus").
+    auto config = SpeechConfig::FromSubscription("YourSubscriptionKey", "YourServiceRegion");
+    config->SetSpeechSynthesisOutputFormat(SpeechSynthesisOutputFormat::Raw16Khz16BitMonoPcm);
+
+    // Creates an audio out stream.
+    auto stream = AudioOutputStream::CreatePullStream();
+
+    // Starts draining the stream to a file before the first request, in blocks of 1MB.
+    // Replace with your own audio file name. Set the last parameter to true to use O_DIRECT on Linux.
+    auto fileName = "outputaudio.wav";
+    PullStreamFileWriter writer(stream, fileName, 16000, 1 << 20, false);
+    writer.Start();
+
+    // Creates a speech synthesizer using audio stream output.
+    auto streamConfig = AudioConfig::FromStreamOutput(stream);
+    auto synthesizer = SpeechSynthesizer::FromConfig(config, streamConfig);
+
+    std::vector<std::string> texts;
+    while (true)
+    {
+        // Receives a text from console input and synthesize it to pull audio output stream.
+        cout << "Enter some text that you want to synthesize, or enter empty text to exit." << std::endl;
+        cout << "> ";
+        std::string text;
+        getline(cin, text);
+        if (text.empty())
+        {
+            break;
+        }
+
+        auto result = synthesizer->SpeakTextAsync(text).get();
+
+        // Checks result.
+        if (result->Reason == ResultReason::SynthesizingAudioCompleted)
+        {
+            texts.push_back(text);
+            cout << "Speech synthesized for text [" << text << "], and the audio is being written to [" << fileName << "]" << std::endl;
+        }
+        else if (result->Reason == ResultReason::Canceled)
+        {
+            auto cancellation = SpeechSynthesisCancellationDetails::FromResult(result);
+            cout << "CANCELED: Reason=" << (int)cancellation->Reason << std::endl;
+
+            if (cancellation->Reason == CancellationReason::Error)
+            {
+                cout << "CANCELED: ErrorCode=" << (int)cancellation->ErrorCode << std::endl;
+                cout << "CANCELED: ErrorDetails=[" << cancellation->ErrorDetails << "]" << std::endl;
+                cout << "CANCELED: Did you update the subscription info?" << std::endl;
+            }
+        }
+    }
+
+    // Destroys the synthesizer to end the stream, then waits for the writer to complete the file.
+    auto closeTime = std::chrono::steady_clock::now();
+    synthesizer = nullptr;
+    auto stats = writer.Wait();
+    auto completionMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - closeTime).count();
+
+    cout << "Totally " << stats.AudioBytes << " bytes written to [" << fileName << "] in " << stats.Blocks << " full blocks"
+        << (stats.WriteFailed ? ", with write errors." : ".") << endl;
+    if (texts.empty())
+    {
+        return;
+    }
+
+    // Baseline: synthesizes the same texts again, but reads the stream only after the synthesizer is destroyed, so
+    // all the audio is held in memory and the file is written only then.
+    cout << "Synthesizing the same texts again, reading the stream only after the synthesizer is destroyed..." << endl;
+    auto baselineStream = AudioOutputStream::CreatePullStream();
+    auto baselineSynthesizer = SpeechSynthesizer::FromConfig(config, AudioConfig::FromStreamOutput(baselineStream));
+    for (const auto& text : texts)
+    {
+        baselineSynthesizer->SpeakTextAsync(text).get();
+    }
+
+    auto baselineCloseTime = std::chrono::steady_clock::now();
+    baselineSynthesizer = nullptr;
+    std::vector<uint8_t> audio(PullStreamFileWriter::WavHeaderSize);
+    std::vector<uint8_t> buffer(32000);
+    uint32_t read = 0;
+    while ((read = baselineStream->Read(buffer.data(), static_cast<uint32_t>(buffer.size()))) > 0)
+    {
+        audio.insert(audio.end(), buffer.begin(), buffer.begin() + read);
+    }
+    auto baselineAudioBytes = audio.size() - PullStreamFileWriter::WavHeaderSize;
+    PullStreamFileWriter::WriteWavHeader(audio.data(), 16000, baselineAudioBytes);
+
+    // Replace with your own audio file name.
+    auto baselineFileName = "outputaudio_baseline.wav";
+    std::ofstream baselineFile(baselineFileName, std::ios_base::binary);
+    baselineFile.write(reinterpret_cast<const char*>(audio.data()), audio.size());
+    baselineFile.close();
+    auto baselineCompletionMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - baselineCloseTime).count();
+    cout << "Totally " << baselineAudioBytes << " bytes written to [" << baselineFileName << "]"
+        << (baselineFile.fail() ? ", with write errors." : ".") << endl;
+
+    cout << "                    memory held (bytes)   file completed after the synthesizer was destroyed (ms)" << endl;
+    cout << "  writer            " << std::setw(19) << stats.BufferBytes << "   " << completionMilliseconds << endl;
+    cout << "  read at the end   " << std::setw(19) << audio.capacity() + buffer.size() << "   " << baselineCompletionMilliseconds << endl;
+    cout << "The writer wrote its first block " << stats.FirstWriteMilliseconds << "ms after it started." << endl;
+}
+
 // Speech synthesis to push audio output stream.
 void SpeechSynthesisToPushAudioOutputStream()
 {
@@ -481,6 +599,81 @@ void SpeechSynthesisToPushAudioOutputStream()
     cout << "Totally " << callback->GetAudioSize() << " bytes received." << endl;
 }
 
+// Speech synthesis to push audio output stream, encoded to several formats from a single synthesis request.
+void SpeechSynthesisToMultipleFormats()
+{
+    // Creates an instance of a speech config with specified subscription key and service region.
+    // Replace with your own subscription key and service region (e.g., "westus").
+    auto config = SpeechConfig::FromSubscription("YourSubscriptionKey", "YourServiceRegion");
+
+    // Requests high quality raw PCM once, the encoders derive the other formats from it locally.
+    config->SetSpeechSynthesisOutputFormat(SpeechSynthesisOutputFormat::Raw24Khz16BitMonoPcm);
+
+    // Creates the encoders, each running on its own worker thread.
+    std::vector<std::shared_ptr<AudioEncoder>> encoders{ std::make_shared<WavEncoder>() };
+#ifdef FAN_OUT_ENCODER_MP3
+    encoders.push_back(std::make_shared<Mp3Encoder>());
+#endif
+#ifdef WITH_OPUS
+    encoders.push_back(std::make_shared<OggOpusEncoder>());
+#endif
+    auto callback = std::make_shared<FanOutEncoder>(encoders, 24000);
+
+    // Creates a speech synthesizer using the encoders as push audio output stream.
+    auto stream = AudioOutputStream::CreatePushStream(callback);
+    auto streamConfig = AudioConfig::FromStreamOutput(stream);
+    auto synthesizer = SpeechSynthesizer::FromConfig(config, streamConfig);
+
+    int requestCount = 0;
+    while (true)
+    {
+        // Receives a text from console input and synthesize it to push audio output stream.
+        cout << "Enter some text that you want to synthesize, or enter empty text to exit." << std::endl;
+        cout << "> ";
+        std::string text;
+        getline(cin, text);
+        if (text.empty())
+        {
+            break;
+        }
+
+        // Replace with your own output file name, the encoders append their file extension.
+        auto baseFileName = "outputaudio" + std::to_string(++requestCount);
+        callback->Begin(baseFileName);
+        auto result = synthesizer->SpeakTextAsync(text).get();
+        auto reports = callback->End();
+
+        // Checks result.
+        if (result->Reason == ResultReason::SynthesizingAudioCompleted)
+        {
+            cout << "Speech synthesized for text [" << text << "] with 1 request instead of " << reports.size() << "." << std::endl;
+            for (const auto& report : reports)
+            {
+                if (!report.Error.empty())
+                {
+                    cout << "  [" << report.Encoder << "] failed: " << report.Error << std::endl;
+                    continue;
+                }
+                cout << "  [" << report.Encoder << "] " << report.BytesIn << " bytes encoded to " << report.BytesOut
+                    << " bytes in " << report.EncodeMilliseconds << "ms, written in " << report.WriteMilliseconds
+                    << "ms to [" << report.FileName << "]" << std::endl;
+            }
+        }
+        else if (result->Reason == ResultReason::Canceled)
+        {
+            auto cancellation = SpeechSynthesisCancellationDetails::FromResult(result);
+            cout << "CANCELED: Reason=" << (int)cancellation->Reason << std::endl;
+
+            if (cancellation->Reason == CancellationReason::Error)
+            {
+                cout << "CANCELED: ErrorCode=" << (int)cancellation->ErrorCode << std::endl;
+                cout << "CANCELED: ErrorDetails=[" << cancellation->ErrorDetails << "]" << std::endl;
+                cout << "CANCELED: Did you update the subscription info?" << std::endl;
+            }
+        }
+    }
+}
+
 // Gets synthesized audio data from result.
 void SpeechSynthesisToResult()
 {
@@ -598,6 +791,91 @@ void SpeechSynthesisToAudioDataStream()
     }
 }
 
+// Speech synthesis to a shared audio buffer, read by several consumers concurrently without copying the audio.
+void SpeechSynthesisToSharedAudioBuffer()
+{
+    // Creates an instance of a speech config with specified subscription key and service region.
+    // Replace with your own subscription key and service region (e.g., "westus").
+    auto config = SpeechConfig::FromSubscription("YourSubscriptionKey", "YourServiceRegion");
+    config->SetSpeechSynthesisOutputFormat(SpeechSynthesisOutputFormat::Riff16Khz16BitMonoPcm);
+
+    // Creates a speech synthesizer with a null output stream.
+    // This means the audio output data will not be written to any stream.
+    // You can just get the audio from the result.
+    auto synthesizer = SpeechSynthesizer::FromConfig(config, nullptr);
+
+    // A cache of synthesized audio, holding views of the results.
+    std::map<std::string, SharedAudioBuffer> cache;
+
+    while (true)
+    {
+        // Receives a text from console input and synthesize it to result.
+        cout << "Enter some text that you want to synthesize, or enter empty text to exit." << std::endl;
+        cout << "> ";
+        std::string text;
+        getline(cin, text);
+        if (text.empty())
+        {
+            break;
+        }
+
+        auto result = synthesizer->SpeakTextAsync(text).get();
+
+        // Checks result.
+        if (result->Reason == ResultReason::SynthesizingAudioCompleted)
+        {
+            cout << "Speech synthesized for text [" << text << "]" << std::endl;
+            auto audio = SharedAudioBuffer::FromResult(result);
+
+            // The file writer writes the whole wave file directly from the shared audio.
+            auto fileName = "outputaudio.wav";
+            auto fileWriter = std::async(std::launch::async, [audio, fileName]()
+            {
+                std::ofstream file(fileName, std::ios_base::binary);
+                file.write(reinterpret_cast<const char*>(audio.Data()), audio.Size());
+            });
+
+            // The analytics consumer walks the PCM samples after the 44 byte wave header, with its own cursor.
+            auto analytics = std::async(std::launch::async, [audio]()
+            {
+                SharedAudioBufferReader reader(audio.Slice(44, audio.Size()));
+                int peak = 0;
+                for (auto chunk = reader.Next(3200); !chunk.Empty(); chunk = reader.Next(3200))
+                {
+                    auto samples = reinterpret_cast<const int16_t*>(chunk.Data());
+                    for (size_t i = 0; i < chunk.Size() / 2; i++)
+                    {
+                        peak = std::max(peak, std::abs(static_cast<int>(samples[i])));
+                    }
+                }
+                return peak;
+            });
+
+            // The cache keeps another view.
+            cache[text] = audio;
+
+            fileWriter.get();
+            auto peak = analytics.get();
+            cout << audio.Size() << " bytes of audio data saved to [" << fileName << "], peak amplitude " << peak << ", "
+                << audio.UseCount() << " views share the audio." << endl;
+        }
+        else if (result->Reason == ResultReason::Canceled)
+        {
+            auto cancellation = SpeechSynthesisCancellationDetails::FromResult(result);
+            cout << "CANCELED: Reason=" << (int)cancellation->Reason << std::endl;
+
+            if (cancellation->Reason == CancellationReason::Error)
+            {
+                cout << "CANCELED: ErrorCode=" << (int)cancellation->ErrorCode << std::endl;
+                cout << "CANCELED: ErrorDetails=[" << cancellation->ErrorDetails << "]" << std::endl;
+                cout << "CANCELED: Did you update the subscription info?" << std::endl;
+            }
+        }
+    }
+
+    cout << cache.size() << " results cached." << endl;
+}
+
 // Speech synthesis events.
 void SpeechSynthesisEvents()
 {
@@ -664,6 +942,102 @@ void SpeechSynthesisEvents()
     }
 }
 
+// Speech synthesis with streaming metrics collected from synthesis events.
+void SpeechSynthesisWithStreamingMetrics()
+{
+    // Creates an instance of a speech config with specified subscription key and service region.
+    // Replace with your own subscription key and service region (e.g., "westus").
+    auto config = SpeechConfig::FromSubscription("YourSubscriptionKey", "YourServiceRegion");
+
+    // The voices and output formats to compare, which are the dimensions the metrics are grouped by, with the audio
+    // byte rate of each format.
+    struct Profile
+    {
+        std::string Voice;
+        std::string FormatName;
+        SpeechSynthesisOutputFormat Format;
+        uint32_t BytesPerSecond;
+    };
+    std::vector<Profile> profiles{
+        { "Microsoft Server Speech Text to Speech Voice (en-US, AriaRUS)", "Riff16Khz16BitMonoPcm", SpeechSynthesisOutputFormat::Riff16Khz16BitMonoPcm, 32000 },
+        { "Microsoft Server Speech Text to Speech Voice (en-US, GuyRUS)", "Audio16Khz32KBitRateMonoMp3", SpeechSynthesisOutputFormat::Audio16Khz32KBitRateMonoMp3, 4000 },
+    };
+
+    // One metrics instance is shared by a synthesizer per profile, which are used one after the other.
+    auto metrics = std::make_shared<SynthesisMetrics>();
+    std::vector<std::shared_ptr<SpeechSynthesizer>> synthesizers;
+    for (const auto& profile : profiles)
+    {
+        config->SetSpeechSynthesisVoiceName(profile.Voice);
+        config->SetSpeechSynthesisOutputFormat(profile.Format);
+
+        // Creates a speech synthesizer with a null output stream.
+        // This means the audio output data will not be written to any stream.
+        // You can just get the audio from the result.
+        auto synthesizer = SpeechSynthesizer::FromConfig(config, nullptr);
+
+        // Subscribes to events
+        synthesizer->SynthesisStarted += [metrics](const SpeechSynthesisEventArgs& e)
+        {
+            UNUSED(e);
+            metrics->OnStarted();
+        };
+
+        synthesizer->Synthesizing += [metrics](const SpeechSynthesisEventArgs& e)
+        {
+            metrics->OnChunk(e.Result->GetAudioData()->size());
+        };
+
+        synthesizer->SynthesisCompleted += [metrics](const SpeechSynthesisEventArgs& e)
+        {
+            UNUSED(e);
+            metrics->OnCompleted();
+        };
+        synthesizers.push_back(synthesizer);
+    }
+
+    while (true)
+    {
+        // Receives a text from console input and synthesize it to result.
+        cout << "Enter some text that you want to synthesize, or enter empty text to exit." << std::endl;
+        cout << "> ";
+        std::string text;
+        getline(cin, text);
+        if (text.empty())
+        {
+            break;
+        }
+
+        for (size_t i = 0; i < profiles.size(); i++)
+        {
+            metrics->OnRequest(profiles[i].Voice, profiles[i].FormatName, profiles[i].BytesPerSecond);
+            auto result = synthesizers[i]->SpeakTextAsync(text).get();
+
+            // Checks result.
+            if (result->Reason == ResultReason::SynthesizingAudioCompleted)
+            {
+                cout << "Speech synthesized for text [" << text << "] in " << profiles[i].FormatName << std::endl;
+            }
+            else if (result->Reason == ResultReason::Canceled)
+            {
+                auto cancellation = SpeechSynthesisCancellationDetails::FromResult(result);
+                cout << "CANCELED: Reason=" << (int)cancellation->Reason << std::endl;
+
+                if (cancellation->Reason == CancellationReason::Error)
+                {
+                    cout << "CANCELED: ErrorCode=" << (int)cancellation->ErrorCode << std::endl;
+                    cout << "CANCELED: ErrorDetails=[" << cancellation->ErrorDetails << "]" << std::endl;
+                    cout << "CANCELED: Did you update the subscription info?" << std::endl;
+                }
+            }
+        }
+        metrics->WriteSummary(cout);
+    }
+
+    // Exports the histograms, e.g. to be scraped by a monitoring system.
+    metrics->WriteHistograms(cout);
+}
+
 // Speech synthesis word boundary event.
 void SpeechSynthesisWordBoundaryEvent()
 {
@@ -723,6 +1097,201 @@ void SpeechSynthesisWordBoundaryEvent()
     }
 }
 
+// Parses a non-negative number of milliseconds typed on the console, rejecting anything else instead of throwing.
+static bool ParseMilliseconds(const std::string& text, uint64_t* milliseconds)
+{
+    // Positions are converted to ticks of 100ns, which must not overflow.
+    const uint64_t maxMilliseconds = UINT64_MAX / 10000;
+    uint64_t value = 0;
+    for (auto c : text)
+    {
+        if (c < '0' || c > '9' || value > (maxMilliseconds - (c - '0')) / 10)
+        {
+            return false;
+        }
+        value = value * 10 + (c - '0');
+    }
+    *milliseconds = value;
+    return !text.empty();
+}
+
+// Speech synthesis with a word boundary index for seeking, and subtitles written while synthesizing.
+void SpeechSynthesisWithWordBoundaryIndex()
+{
+    // Creates an instance of a speech config with specified subscription key and service region.
+    // Replace with your own subscription key and service region (e.g., "westus").
+    auto config = SpeechConfig::FromSubscription("YourSubscriptionKey", "YourServiceRegion");
+
+    // Uses a raw PCM output format, so the audio duration can be derived from the audio size.
+    config->SetSpeechSynthesisOutputFormat(SpeechSynthesisOutputFormat::Raw16Khz16BitMonoPcm);
+
+    // Creates a speech synthesizer with a null output stream.
+    // This means the audio output data will not be written to any stream.
+    // You can just get the audio from the result.
+    auto synthesizer = SpeechSynthesizer::FromConfig(config, nullptr);
+
+    while (true)
+    {
+        // Receives a text from console input and synthesize it to result.
+        cout << "Enter some text that you want to synthesize, or enter empty text to exit." << std::endl;
+        cout << "> ";
+        std::string text;
+        getline(cin, text);
+        if (text.empty())
+        {
+            break;
+        }
+
+        // The index and the subtitle writer are filled by the word boundary event.
+        // Replace with your own subtitle file name.
+        auto fileName = "outputaudio.vtt";
+        std::ofstream subtitleFile(fileName);
+        auto index = std::make_shared<WordBoundaryIndex>();
+        auto subtitles = std::make_shared<SubtitleWriter>(subtitleFile, SubtitleWriter::Format::WebVtt, text);
+
+        synthesizer->WordBoundary.DisconnectAll();
+        synthesizer->WordBoundary += [index, subtitles](const SpeechSynthesisWordBoundaryEventArgs& e)
+        {
+            index->Add(e.AudioOffset, e.TextOffset, e.WordLength);
+            subtitles->AddWord(e.AudioOffset, e.TextOffset, e.WordLength);
+        };
+
+        auto result = synthesizer->SpeakTextAsync(text).get();
+
+        // Checks result.
+        if (result->Reason == ResultReason::SynthesizingAudioCompleted)
+        {
+            // 16kHz 16bit mono PCM is 32 bytes per millisecond, and 1 millisecond is 10,000 ticks.
+            uint64_t audioDuration = result->GetAudioData()->size() / 32 * 10000;
+            index->Finalize(audioDuration);
+            subtitles->Finish(audioDuration);
+            cout << "Speech synthesized for text [" << text << "], " << index->Size() << " words indexed, subtitles were saved to [" << fileName << "]" << std::endl;
+
+            // Looks up the words by audio position, e.g. to highlight the word being played after seeking.
+            while (true)
+            {
+                cout << "Enter an audio position in milliseconds to look up the word spoken, or enter empty text to continue." << std::endl;
+                cout << "> ";
+                std::string position;
+                getline(cin, position);
+                if (position.empty())
+                {
+                    break;
+                }
+
+                uint64_t milliseconds = 0;
+                if (!ParseMilliseconds(position, &milliseconds))
+                {
+                    cout << "[" << position << "] is not a position in milliseconds." << std::endl;
+                    continue;
+                }
+
+                auto word = index->FindByAudioOffset(milliseconds * 10000);
+                if (word == WordBoundaryIndex::npos)
+                {
+                    cout << "No word is spoken at this position." << std::endl;
+                    continue;
+                }
+
+                // Maps the text span back to the audio, e.g. to seek to the beginning of the word.
+                auto sameWord = index->FindByTextOffset(index->TextOffset(word));
+                cout << "Word [" << Utf16Substr(text, index->TextOffset(word), index->WordLength(word)) << "] is spoken from "
+                    << index->AudioOffset(sameWord) / 10000 << "ms to " << index->AudioEnd(sameWord) / 10000 << "ms." << std::endl;
+            }
+        }
+        else if (result->Reason == ResultReason::Canceled)
+        {
+            auto cancellation = SpeechSynthesisCancellationDetails::FromResult(result);
+            cout << "CANCELED: Reason=" << (int)cancellation->Reason << std::endl;
+
+            if (cancellation->Reason == CancellationReason::Error)
+            {
+                cout << "CANCELED: ErrorCode=" << (int)cancellation->ErrorCode << std::endl;
+                cout << "CANCELED: ErrorDetails=[" << cancellation->ErrorDetails << "]" << std::endl;
+                cout << "CANCELED: Did you update the subscription info?" << std::endl;
+            }
+        }
+    }
+}
+
+// Speech synthesis of a batch of prompts to wave files, using several synthesizers concurrently.
+void SpeechSynthesisBatchRendering()
+{
+    // Creates an instance of a speech config with specified subscription key and service region.
+    // Replace with your own subscription key and service region (e.g., "westus").
+    auto config = SpeechConfig::FromSubscription("YourSubscriptionKey", "YourServiceRegion");
+    config->SetSpeechSynthesisOutputFormat(SpeechSynthesisOutputFormat::Riff16Khz16BitMonoPcm);
+
+    // Replace with your own manifest, one text or SSML prompt per line, and an existing output directory.
+    auto manifestFileName = "prompts.txt";
+    auto outputDirectory = ".";
+
+    // Renders with 8 synthesizers at a time, trying each prompt up to 3 times.
+    // Run the sample again after an interruption to render only the remaining prompts.
+    BatchSynthesisRenderer renderer(config, 8, 3);
+    auto stats = renderer.Render(manifestFileName, outputDirectory);
+
+    cout << "Rendered " << stats.Succeeded << " of " << stats.Total << " prompts (" << stats.Skipped << " skipped from a previous run, "
+        << stats.Failed << " failed, " << stats.Retries << " retries) in " << stats.WallSeconds << " seconds." << endl;
+    cout << "Throughput: " << stats.UtterancesPerSecond() << " utterances/second, " << stats.AudioHoursPerHour() << " audio hours/hour." << endl;
+}
+
+// Speech synthesis of many short texts, batched into few SSML requests, compared with one request per text.
+void SpeechSynthesisBatchedSsml()
+{
+    // Creates an instance of a speech config with specified subscription key and service region.
+    // Replace with your own subscription key and service region (e.g., "westus").
+    auto config = SpeechConfig::FromSubscription("YourSubscriptionKey", "YourServiceRegion");
+    config->SetSpeechSynthesisOutputFormat(SpeechSynthesisOutputFormat::Raw16Khz16BitMonoPcm);
+
+    // Creates a speech synthesizer with a null output stream.
+    // This means the audio output data will not be written to any stream.
+    // You can just get the audio from the result.
+    auto synthesizer = SpeechSynthesizer::FromConfig(config, nullptr);
+
+    // Generates short prompts, typical for IVR menus. Replace with your own texts.
+    const size_t promptCount = 100;
+    std::vector<std::string> texts;
+    for (size_t i = 0; i < promptCount; i++)
+    {
+        texts.push_back("For option " + std::to_string(i + 1) + ", press " + std::to_string(i % 10) + ".");
+    }
+
+    // Synthesizes the prompts one request per prompt.
+    auto start = std::chrono::steady_clock::now();
+    size_t singleRequests = 0;
+    size_t singleBytes = 0;
+    for (const auto& text : texts)
+    {
+        auto result = synthesizer->SpeakTextAsync(text).get();
+        singleRequests++;
+        if (result->Reason == ResultReason::SynthesizingAudioCompleted)
+        {
+            singleBytes += result->GetAudioData()->size();
+        }
+    }
+    auto singleSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // Synthesizes the same prompts, 50 per SSML request.
+    SsmlBatchSynthesizer batchSynthesizer(synthesizer, "en-US", "en-US-AriaNeural", 50);
+    start = std::chrono::steady_clock::now();
+    auto clips = batchSynthesizer.Synthesize(texts);
+    auto batchSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    size_t batchBytes = 0;
+    for (const auto& clip : clips)
+    {
+        batchBytes += clip.size();
+    }
+
+    // Reports the cost per 1,000 prompts for both paths.
+    auto scale = 1000.0 / promptCount;
+    cout << "One request per prompt: " << singleRequests * scale << " requests and " << singleSeconds * scale
+        << " seconds per 1,000 prompts, " << singleBytes << " bytes of audio." << endl;
+    cout << "Batched SSML requests: " << batchSynthesizer.RequestCount() * scale << " requests and " << batchSeconds * scale
+        << " seconds per 1,000 prompts, " << batchBytes << " bytes of audio in " << clips.size() << " clips." << endl;
+}
+
 // Speech synthesis with auto detection for source language
 // Note: this is a preview feature, which might be updated in future versions.
 void SpeechSynthesisWithSourceLanguageAutoDetection()
@@ -0,0 +1,194 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#pragma once
+
+#include <speechapi_cxx.h>
+#include <algorithm>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "utf16_text.h"
+
+// Synthesizes many short texts with few requests, by packing them into one SSML document per request and cutting
+// the returned audio back into one clip per text.
+// Each text is preceded by a bookmark and a short break. The clips are cut in the middle of that break, right before
+// the first word of each text, as reported by the word boundary events.
+// The synthesizer's output format must be Raw16Khz16BitMonoPcm.
+class SsmlBatchSynthesizer final
+{
+public:
+    SsmlBatchSynthesizer(std::shared_ptr<Microsoft::CognitiveServices::Speech::SpeechSynthesizer> synthesizer,
+        const std::string& language, const std::string& voice, size_t maxTextsPerRequest = 50, uint32_t breakMilliseconds = 200) :
+        m_synthesizer(synthesizer),
+        m_language(language),
+        m_voice(voice),
+        m_maxTextsPerRequest(maxTextsPerRequest == 0 ? 1 : maxTextsPerRequest),
+        m_breakMilliseconds(breakMilliseconds),
+        m_words(std::make_shared<WordList>())
+    {
+    }
+
+    // Synthesizes the texts and returns one raw PCM clip per text, in the same order.
+    // A text whose request failed gets an empty clip.
+    // The word boundary handler is only connected during the call, so other requests of the synthesizer are not
+    // collected. EventSignal::Disconnect removes the handlers of the same type, i.e. only the one of this class.
+    std::vector<std::vector<uint8_t>> Synthesize(const std::vector<std::string>& texts)
+    {
+        auto words = m_words;
+        std::function<void(const Microsoft::CognitiveServices::Speech::SpeechSynthesisWordBoundaryEventArgs&)> handler =
+            [words](const Microsoft::CognitiveServices::Speech::SpeechSynthesisWordBoundaryEventArgs& e)
+        {
+            std::lock_guard<std::mutex> lock(words->Mutex);
+            words->Words.push_back(std::make_pair(e.TextOffset, e.AudioOffset));
+        };
+        m_synthesizer->WordBoundary.Connect(handler);
+
+        std::vector<std::vector<uint8_t>> clips;
+        try
+        {
+            clips.reserve(texts.size());
+            for (size_t first = 0; first < texts.size(); first += m_maxTextsPerRequest)
+            {
+                auto count = std::min(m_maxTextsPerRequest, texts.size() - first);
+                SynthesizeBatch(texts, first, count, clips);
+            }
+        }
+        catch (...)
+        {
+            m_synthesizer->WordBoundary.Disconnect(handler);
+            throw;
+        }
+        m_synthesizer->WordBoundary.Disconnect(handler);
+
+        std::lock_guard<std::mutex> lock(m_words->Mutex);
+        m_words->Words.clear();
+        m_words->Words.shrink_to_fit();
+        return clips;
+    }
+
+    size_t RequestCount() const { return m_requestCount; }
+
+private:
+    struct WordList
+    {
+        std::mutex Mutex;
+        std::vector<std::pair<uint32_t, uint64_t>> Words;   // text offset in characters and audio offset of each word.
+    };
+
+    void SynthesizeBatch(const std::vector<std::string>& texts, size_t first, size_t count, std::vector<std::vector<uint8_t>>& clips)
+    {
+        using namespace Microsoft::CognitiveServices::Speech;
+
+        // Builds the SSML and remembers where in it each text starts. The word boundaries count characters rather than
+        // the bytes of the UTF-8 SSML, so the positions are counted in characters too.
+        std::string ssml = "<speak version='1.0' xmlns='http://www.w3.org/2001/10/synthesis' xml:lang='";
+        AppendEscaped(ssml, m_language);
+        ssml += "'><voice name='";
+        AppendEscaped(ssml, m_voice);
+        ssml += "'>";
+        uint32_t characters = Utf16Length(ssml);
+        std::vector<uint32_t> textBegins;
+        for (size_t i = first; i < first + count; i++)
+        {
+            std::string marker = "<bookmark mark='" + std::to_string(i) + "'/><break time='" + std::to_string(m_breakMilliseconds) + "ms'/>";
+            ssml += marker;
+            characters += Utf16Length(marker);
+            textBegins.push_back(characters);
+            std::string text;
+            AppendEscaped(text, texts[i]);
+            ssml += text;
+            characters += Utf16Length(text);
+        }
+        textBegins.push_back(characters);
+        ssml += "</voice></speak>";
+
+        {
+            std::lock_guard<std::mutex> lock(m_words->Mutex);
+            m_words->Words.clear();
+        }
+
+        m_requestCount++;
+        auto result = m_synthesizer->SpeakSsmlAsync(ssml).get();
+        if (result->Reason != ResultReason::SynthesizingAudioCompleted)
+        {
+            clips.resize(clips.size() + count);
+            return;
+        }
+        auto audio = result->GetAudioData();
+
+        // Finds the first word of each text. The bookmark event is not available in this SDK version,
+        // so the word boundaries, which report their offset in the SSML document, locate the texts instead.
+        std::vector<uint64_t> firstWords(count, UINT64_MAX);
+        {
+            std::lock_guard<std::mutex> lock(m_words->Mutex);
+            for (const auto& word : m_words->Words)
+            {
+                auto it = std::upper_bound(textBegins.begin(), textBegins.end(), word.first);
+                if (it == textBegins.begin() || it == textBegins.end())
+                {
+                    continue;
+                }
+                auto text = static_cast<size_t>(it - textBegins.begin()) - 1;
+                firstWords[text] = std::min(firstWords[text], word.second);
+            }
+        }
+
+        // Cuts in the middle of the break before each first word. A text without words gets an empty clip.
+        std::vector<size_t> cuts(count + 1, audio->size());
+        cuts[0] = 0;
+        for (size_t i = count; i-- > 1;)
+        {
+            if (firstWords[i] == UINT64_MAX)
+            {
+                cuts[i] = cuts[i + 1];
+                continue;
+            }
+            auto breakTicks = static_cast<uint64_t>(m_breakMilliseconds) * 10000;
+            auto cutTicks = firstWords[i] > breakTicks / 2 ? firstWords[i] - breakTicks / 2 : 0;
+            cuts[i] = std::min(cuts[i + 1], TicksToBytes(cutTicks));
+        }
+        for (size_t i = 1; i <= count; i++)
+        {
+            cuts[i] = std::max(cuts[i], cuts[i - 1]);
+        }
+
+        for (size_t i = 0; i < count; i++)
+        {
+            clips.emplace_back(audio->begin() + cuts[i], audio->begin() + cuts[i + 1]);
+        }
+    }
+
+    // Converts ticks (100 nanoseconds) to a byte offset of 16kHz 16bit mono PCM, i.e. 32 bytes per millisecond.
+    static size_t TicksToBytes(uint64_t ticks)
+    {
+        return static_cast<size_t>(ticks / 10000 * 32);
+    }
+
+    static void AppendEscaped(std::string& ssml, const std::string& text)
+    {
+        for (auto c : text)
+        {
+            switch (c)
+            {
+            case '&': ssml += "&amp;"; break;
+            case '<': ssml += "&lt;"; break;
+            case '>': ssml += "&gt;"; break;
+            case '\'': ssml += "&apos;"; break;
+            case '"': ssml += "&quot;"; break;
+            default: ssml += c; break;
+            }
+        }
+    }
+
+    std::shared_ptr<Microsoft::CognitiveServices::Speech::SpeechSynthesizer> m_synthesizer;
+    std::string m_language;
+    std::string m_voice;
+    size_t m_maxTextsPerRequest;
+    uint32_t m_breakMilliseconds;
+    std::shared_ptr<WordList> m_words;
+    size_t m_requestCount = 0;
+};
@@ -0,0 +1,258 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <utility>
+
+// A fixed-size histogram with exponentially growing bucket bounds.
+// Recording a value is O(number of buckets) at worst and never allocates, so it is safe to call from SDK event callbacks.
+class LatencyHistogram final
+{
+public:
+    static constexpr size_t BucketCount = 20;
+
+    // Creates a histogram whose first bucket holds values up to firstBound, each next bucket doubling the bound.
+    explicit LatencyHistogram(double firstBound = 1.0)
+    {
+        double bound = firstBound;
+        for (auto& b : m_bounds)
+        {
+            b = bound;
+            bound *= 2;
+        }
+    }
+
+    void Record(double value)
+    {
+        auto it = std::lower_bound(m_bounds.begin(), m_bounds.end(), value);
+        auto index = it == m_bounds.end() ? BucketCount : static_cast<size_t>(it - m_bounds.begin());
+        m_counts[index]++;
+        m_count++;
+        m_sum += value;
+        m_min = m_count == 1 ? value : std::min(m_min, value);
+        m_max = m_count == 1 ? value : std::max(m_max, value);
+    }
+
+    uint64_t Count() const { return m_count; }
+    double Mean() const { return m_count == 0 ? 0 : m_sum / m_count; }
+    double Min() const { return m_min; }
+    double Max() const { return m_max; }
+
+    // Gets an upper estimate of the given percentile (0-100), i.e. the bound of the bucket that contains it.
+    double Percentile(double percentile) const
+    {
+        if (m_count == 0)
+        {
+            return 0;
+        }
+
+        auto rank = static_cast<uint64_t>(percentile / 100.0 * m_count + 0.5);
+        rank = std::max<uint64_t>(1, std::min(rank, m_count));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < BucketCount; i++)
+        {
+            seen += m_counts[i];
+            if (seen >= rank)
+            {
+                return std::min(m_bounds[i], m_max);
+            }
+        }
+        return m_max;
+    }
+
+    // Writes the buckets in the Prometheus text exposition format: the cumulative count of every bucket, the last one
+    // with le="+Inf", then the sum and the count. The "# TYPE" line is written once per name by the caller.
+    void Write(std::ostream& os, const std::string& name, const std::string& labels) const
+    {
+        uint64_t cumulative = 0;
+        for (size_t i = 0; i <= BucketCount; i++)
+        {
+            cumulative += m_counts[i];
+            os << name << "_bucket{" << labels << ",le=\"";
+            if (i < BucketCount)
+            {
+                os << m_bounds[i];
+            }
+            else
+            {
+                os << "+Inf";
+            }
+            os << "\"} " << cumulative << std::endl;
+        }
+        os << name << "_sum{" << labels << "} " << m_sum << std::endl;
+        os << name << "_count{" << labels << "} " << m_count << std::endl;
+    }
+
+private:
+    std::array<double, BucketCount> m_bounds;
+    // The last counter collects the values above the largest bound.
+    std::array<uint64_t, BucketCount + 1> m_counts{};
+    uint64_t m_count = 0;
+    double m_sum = 0;
+    double m_min = 0;
+    double m_max = 0;
+};
+
+// Collects streaming metrics of speech synthesis requests, grouped by voice and output format.
+// Call OnRequest with the voice and output format of the request right before SpeakTextAsync/SpeakSsmlAsync, then
+// forward the SynthesisStarted, Synthesizing and SynthesisCompleted events to OnStarted, OnChunk and OnCompleted.
+// Only one request per instance may be in flight at a time, which matches how a single synthesizer processes requests;
+// several synthesizers with different voices or formats can share an instance if they are used one after the other.
+class SynthesisMetrics final
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // Metrics of one voice and output format pair.
+    struct Series
+    {
+        LatencyHistogram FirstChunkLatencyMs{ 10 };   // from request to first audio chunk.
+        LatencyHistogram InterChunkGapMs{ 1 };        // between consecutive audio chunks.
+        LatencyHistogram TotalBytes{ 1024 };          // audio bytes per request.
+        LatencyHistogram RealTimeFactor{ 0.01 };      // wall clock time divided by audio duration.
+    };
+
+    // Starts a request. bytesPerSecond is the audio byte rate of the output format, used to derive the audio duration
+    // from byte counts, e.g. 32000 for Riff16Khz16BitMonoPcm or 4000 for Audio16Khz32KBitRateMonoMp3.
+    void OnRequest(const std::string& voice, const std::string& outputFormat, uint32_t bytesPerSecond)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_key = std::make_pair(voice, outputFormat);
+        m_bytesPerSecond = bytesPerSecond;
+        m_requestTime = Clock::now();
+        m_lastChunkTime = m_requestTime;
+        m_chunkCount = 0;
+        m_bytes = 0;
+    }
+
+    void OnStarted()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_started++;
+    }
+
+    void OnChunk(size_t size)
+    {
+        auto now = Clock::now();
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto& series = m_series[m_key];
+        if (m_chunkCount == 0)
+        {
+            series.FirstChunkLatencyMs.Record(ToMilliseconds(now - m_requestTime));
+        }
+        else
+        {
+            series.InterChunkGapMs.Record(ToMilliseconds(now - m_lastChunkTime));
+        }
+        m_lastChunkTime = now;
+        m_chunkCount++;
+        m_bytes += size;
+    }
+
+    void OnCompleted()
+    {
+        auto now = Clock::now();
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto& series = m_series[m_key];
+        series.TotalBytes.Record(static_cast<double>(m_bytes));
+        if (m_bytesPerSecond > 0 && m_bytes > 0)
+        {
+            auto audioSeconds = static_cast<double>(m_bytes) / m_bytesPerSecond;
+            series.RealTimeFactor.Record(ToMilliseconds(now - m_requestTime) / 1000.0 / audioSeconds);
+        }
+        m_completed++;
+    }
+
+    // Writes a short human readable summary per voice and output format.
+    void WriteSummary(std::ostream& os) const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        os << "Synthesis requests started: " << m_started << ", completed: " << m_completed << std::endl;
+        for (const auto& entry : m_series)
+        {
+            const auto& s = entry.second;
+            os << "[" << entry.first.first << ", " << entry.first.second << "]" << std::endl
+                << "  first chunk latency: mean " << s.FirstChunkLatencyMs.Mean() << "ms, p50 <= " << s.FirstChunkLatencyMs.Percentile(50)
+                << "ms, p95 <= " << s.FirstChunkLatencyMs.Percentile(95) << "ms, max " << s.FirstChunkLatencyMs.Max() << "ms" << std::endl
+                << "  inter-chunk gap: mean " << s.InterChunkGapMs.Mean() << "ms, p95 <= " << s.InterChunkGapMs.Percentile(95)
+                << "ms, max " << s.InterChunkGapMs.Max() << "ms" << std::endl
+                << "  bytes per request: mean " << s.TotalBytes.Mean() << ", max " << s.TotalBytes.Max() << std::endl
+                << "  real time factor: mean " << s.RealTimeFactor.Mean() << ", p95 <= " << s.RealTimeFactor.Percentile(95) << std::endl;
+        }
+    }
+
+    // Writes all histograms in the Prometheus text exposition format, labeled with voice and output format.
+    void WriteHistograms(std::ostream& os) const
+    {
+        static const std::pair<const char*, LatencyHistogram Series::*> histograms[] = {
+            { "speech_synthesis_first_chunk_latency_ms", &Series::FirstChunkLatencyMs },
+            { "speech_synthesis_inter_chunk_gap_ms", &Series::InterChunkGapMs },
+            { "speech_synthesis_audio_bytes", &Series::TotalBytes },
+            { "speech_synthesis_real_time_factor", &Series::RealTimeFactor },
+        };
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (const auto& histogram : histograms)
+        {
+            os << "# TYPE " << histogram.first << " histogram" << std::endl;
+            for (const auto& entry : m_series)
+            {
+                auto labels = "voice=\"" + EscapeLabel(entry.first.first) + "\",format=\"" + EscapeLabel(entry.first.second) + "\"";
+                (entry.second.*histogram.second).Write(os, histogram.first, labels);
+            }
+        }
+    }
+
+private:
+    static double ToMilliseconds(Clock::duration d)
+    {
+        return std::chrono::duration<double, std::milli>(d).count();
+    }
+
+    // Label values escape backslashes, double quotes and line feeds.
+    static std::string EscapeLabel(const std::string& value)
+    {
+        std::string escaped;
+        for (auto c : value)
+        {
+            if (c == '\\' || c == '"')
+            {
+                escaped += '\\';
+                escaped += c;
+            }
+            else if (c == '\n')
+            {
+                escaped += "\\n";
+            }
+            else
+            {
+                escaped += c;
+            }
+        }
+        return escaped;
+    }
+
+    mutable std::mutex m_mutex;
+    std::map<std::pair<std::string, std::string>, Series> m_series;
+
+    // State of the request in flight.
+    std::pair<std::string, std::string> m_key;
+    uint32_t m_bytesPerSecond = 0;
+    Clock::time_point m_requestTime;
+    Clock::time_point m_lastChunkTime;
+    uint64_t m_chunkCount = 0;
+    uint64_t m_bytes = 0;
+
+    uint64_t m_started = 0;
+    uint64_t m_completed = 0;
+};
@@ -0,0 +1,53 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// The text offsets and lengths of the word boundary events count UTF-16 code units, while the samples keep text in
+// UTF-8. These helpers convert between the two, so a word can be cut out of the text it was synthesized from.
+
+// Counts the characters of UTF-8 text as UTF-16 code units: every byte that starts a sequence is one, and a four byte
+// sequence, outside the basic multilingual plane, is two.
+inline uint32_t Utf16Length(const std::string& text)
+{
+    uint32_t count = 0;
+    for (auto c : text)
+    {
+        auto byte = static_cast<uint8_t>(c);
+        if ((byte & 0xc0) != 0x80)
+        {
+            count += byte >= 0xf0 ? 2 : 1;
+        }
+    }
+    return count;
+}
+
+// Gets the byte offset in UTF-8 text of a UTF-16 offset, or the size of the text if the offset is past its end.
+// An offset between the two halves of a surrogate pair rounds up to the character after it.
+inline size_t Utf8Offset(const std::string& text, uint32_t utf16Offset)
+{
+    uint32_t units = 0;
+    size_t offset = 0;
+    while (offset < text.size() && units < utf16Offset)
+    {
+        auto byte = static_cast<uint8_t>(text[offset]);
+        units += byte >= 0xf0 ? 2 : 1;
+        offset++;
+        while (offset < text.size() && (static_cast<uint8_t>(text[offset]) & 0xc0) == 0x80)
+        {
+            offset++;
+        }
+    }
+    return offset;
+}
+
+// Cuts the span of a word boundary, in UTF-16 code units, out of UTF-8 text.
+inline std::string Utf16Substr(const std::string& text, uint32_t utf16Offset, uint32_t utf16Length)
+{
+    auto begin = Utf8Offset(text, utf16Offset);
+    return text.substr(begin, Utf8Offset(text, utf16Offset + utf16Length) - begin);
+}
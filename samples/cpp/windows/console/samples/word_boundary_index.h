@@ -0,0 +1,207 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <numeric>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "utf16_text.h"
+
+// An index over the word boundary events of one synthesis result.
+// Words are kept as a structure of arrays sorted by audio offset, so a player can map an audio position to the spoken
+// text span and a text position back to the audio, both in O(log n).
+// Audio offsets are in ticks (1 tick = 100 nanoseconds), text offsets and lengths count UTF-16 code units of the
+// synthesized text, as the WordBoundary event does; Utf16Substr cuts a word out of the UTF-8 text.
+class WordBoundaryIndex final
+{
+public:
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    // Adds a word boundary, e.g. from the WordBoundary event. Events normally arrive in order; Finalize handles the rest.
+    void Add(uint64_t audioOffset, uint32_t textOffset, uint32_t wordLength)
+    {
+        if (!m_audioOffsets.empty() && audioOffset < m_audioOffsets.back())
+        {
+            m_sorted = false;
+        }
+        m_audioOffsets.push_back(audioOffset);
+        m_textOffsets.push_back(textOffset);
+        m_wordLengths.push_back(wordLength);
+        m_byText.clear();
+    }
+
+    // Sorts the index if needed and builds the text lookup table. Must be called after the last Add.
+    // audioDuration is the duration of the whole result in ticks and closes the time span of the last word.
+    void Finalize(uint64_t audioDuration)
+    {
+        if (!m_sorted)
+        {
+            std::vector<uint32_t> order(Size());
+            std::iota(order.begin(), order.end(), 0);
+            std::stable_sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) { return m_audioOffsets[a] < m_audioOffsets[b]; });
+            Permute(m_audioOffsets, order);
+            Permute(m_textOffsets, order);
+            Permute(m_wordLengths, order);
+            m_sorted = true;
+        }
+
+        m_byText.resize(Size());
+        std::iota(m_byText.begin(), m_byText.end(), 0);
+        std::stable_sort(m_byText.begin(), m_byText.end(), [this](uint32_t a, uint32_t b) { return m_textOffsets[a] < m_textOffsets[b]; });
+
+        m_audioDuration = std::max(audioDuration, m_audioOffsets.empty() ? 0 : m_audioOffsets.back());
+    }
+
+    size_t Size() const { return m_audioOffsets.size(); }
+    uint64_t AudioOffset(size_t word) const { return m_audioOffsets[word]; }
+    uint32_t TextOffset(size_t word) const { return m_textOffsets[word]; }
+    uint32_t WordLength(size_t word) const { return m_wordLengths[word]; }
+
+    // Gets the audio offset where the word ends, i.e. where the next word starts.
+    uint64_t AudioEnd(size_t word) const
+    {
+        return word + 1 < Size() ? m_audioOffsets[word + 1] : m_audioDuration;
+    }
+
+    // Gets the word being spoken at the given audio offset, or npos if the offset is before the first word.
+    size_t FindByAudioOffset(uint64_t audioOffset) const
+    {
+        auto it = std::upper_bound(m_audioOffsets.begin(), m_audioOffsets.end(), audioOffset);
+        return it == m_audioOffsets.begin() ? npos : static_cast<size_t>(it - m_audioOffsets.begin()) - 1;
+    }
+
+    // Gets the word whose text span contains the given text offset, or the closest word before it.
+    // Returns npos if the offset is before the first word. Requires Finalize.
+    size_t FindByTextOffset(uint32_t textOffset) const
+    {
+        auto it = std::upper_bound(m_byText.begin(), m_byText.end(), textOffset,
+            [this](uint32_t offset, uint32_t word) { return offset < m_textOffsets[word]; });
+        return it == m_byText.begin() ? npos : *(it - 1);
+    }
+
+private:
+    template<class T>
+    static void Permute(std::vector<T>& values, const std::vector<uint32_t>& order)
+    {
+        std::vector<T> permuted(values.size());
+        for (size_t i = 0; i < order.size(); i++)
+        {
+            permuted[i] = values[order[i]];
+        }
+        values.swap(permuted);
+    }
+
+    std::vector<uint64_t> m_audioOffsets;
+    std::vector<uint32_t> m_textOffsets;
+    std::vector<uint32_t> m_wordLengths;
+    // Word indices ordered by text offset.
+    std::vector<uint32_t> m_byText;
+    uint64_t m_audioDuration = 0;
+    bool m_sorted = true;
+};
+
+// Writes word boundaries as SRT or WebVTT subtitles while synthesis is still running.
+// Words are grouped into cues of limited length; a cue is written as soon as the word after it arrives,
+// since a word ends where the next one starts.
+class SubtitleWriter final
+{
+public:
+    enum class Format { Srt, WebVtt };
+
+    SubtitleWriter(std::ostream& os, Format format, const std::string& text, size_t maxCueLength = 42, uint64_t maxCueDuration = 50000000) :
+        m_os(os),
+        m_format(format),
+        m_text(text),
+        m_maxCueLength(maxCueLength),
+        m_maxCueDuration(maxCueDuration)
+    {
+        if (m_format == Format::WebVtt)
+        {
+            m_os << "WEBVTT" << std::endl << std::endl;
+        }
+    }
+
+    // Adds a word boundary, in the same units as WordBoundaryIndex::Add.
+    // A word that starts before the pending cue, in the audio or in the text, ends the cue and starts a new one.
+    // If the word starts before the cue in the audio, the cue ends where its own last word starts, as the end of that
+    // word is not known; a cue of a single word gets the duration that the longest cue allows for its length.
+    void AddWord(uint64_t audioOffset, uint32_t textOffset, uint32_t wordLength)
+    {
+        if (m_hasCue)
+        {
+            if (audioOffset < m_cueAudioBegin || textOffset < m_cueTextBegin)
+            {
+                auto audioEnd = std::max(audioOffset, m_cueLastAudioOffset);
+                if (audioEnd == m_cueAudioBegin)
+                {
+                    audioEnd += m_maxCueDuration * std::max<uint64_t>(m_cueTextEnd - m_cueTextBegin, 1) / std::max<size_t>(m_maxCueLength, 1);
+                }
+                WriteCue(audioEnd);
+            }
+            else if (textOffset + wordLength - m_cueTextBegin > m_maxCueLength || audioOffset - m_cueAudioBegin > m_maxCueDuration)
+            {
+                WriteCue(audioOffset);
+            }
+        }
+
+        if (!m_hasCue)
+        {
+            m_hasCue = true;
+            m_cueAudioBegin = audioOffset;
+            m_cueLastAudioOffset = audioOffset;
+            m_cueTextBegin = textOffset;
+            m_cueTextEnd = textOffset;
+        }
+        m_cueTextEnd = std::max(m_cueTextEnd, textOffset + wordLength);
+        m_cueLastAudioOffset = std::max(m_cueLastAudioOffset, audioOffset);
+    }
+
+    // Writes the pending cue. audioDuration is the end of the audio in ticks.
+    void Finish(uint64_t audioDuration)
+    {
+        if (m_hasCue)
+        {
+            WriteCue(std::max(audioDuration, m_cueAudioBegin));
+        }
+        m_os.flush();
+    }
+
+private:
+    void WriteCue(uint64_t audioEnd)
+    {
+        m_os << ++m_cueCount << std::endl
+            << FormatTime(m_cueAudioBegin) << " --> " << FormatTime(audioEnd) << std::endl
+            << Utf16Substr(m_text, m_cueTextBegin, m_cueTextEnd - m_cueTextBegin) << std::endl << std::endl;
+        m_hasCue = false;
+    }
+
+    std::string FormatTime(uint64_t ticks) const
+    {
+        auto ms = (ticks + 5000) / 10000;
+        char buffer[32];
+        snprintf(buffer, sizeof(buffer), "%02u:%02u:%02u%c%03u",
+            static_cast<unsigned>(ms / 3600000), static_cast<unsigned>(ms / 60000 % 60), static_cast<unsigned>(ms / 1000 % 60),
+            m_format == Format::Srt ? ',' : '.', static_cast<unsigned>(ms % 1000));
+        return buffer;
+    }
+
+    std::ostream& m_os;
+    Format m_format;
+    std::string m_text;
+    size_t m_maxCueLength;
+    uint64_t m_maxCueDuration;
+
+    bool m_hasCue = false;
+    uint64_t m_cueAudioBegin = 0;
+    uint64_t m_cueLastAudioOffset = 0;
+    uint32_t m_cueTextBegin = 0;
+    uint32_t m_cueTextEnd = 0;
+    uint32_t m_cueCount = 0;
+};
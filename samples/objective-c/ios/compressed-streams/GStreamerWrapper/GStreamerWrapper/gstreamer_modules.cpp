@@ -7,27 +7,92 @@
 
 #include "gstreamer_modules.h"
 
+#include <initializer_list>
+#include <mutex>
+
 namespace Microsoft {
 namespace CognitiveServices {
 namespace Speech {
 namespace Impl {
 
-void spx_gst_init() {
-#if defined(TARGET_OS_IPHONE)
-    GST_PLUGIN_STATIC_REGISTER(coreelements);
-    GST_PLUGIN_STATIC_REGISTER(app);
-    GST_PLUGIN_STATIC_REGISTER(audioconvert);
-    GST_PLUGIN_STATIC_REGISTER(mpg123);
-    GST_PLUGIN_STATIC_REGISTER(audioresample);
-    GST_PLUGIN_STATIC_REGISTER(audioparsers);
-    GST_PLUGIN_STATIC_REGISTER(ogg);
-    GST_PLUGIN_STATIC_REGISTER(opusparse);
-    GST_PLUGIN_STATIC_REGISTER(opus);
-    GST_PLUGIN_STATIC_REGISTER(wavparse);
-    GST_PLUGIN_STATIC_REGISTER(alaw);
-    GST_PLUGIN_STATIC_REGISTER(mulaw);
-    GST_PLUGIN_STATIC_REGISTER(flac);
+namespace {
+
+enum Plugin
+{
+    CoreElements, App, AudioConvert, Mpg123, AudioResample, AudioParsers, Ogg, OpusParse, Opus, WavParse, Alaw, Mulaw, Flac,
+    PluginCount
+};
+
+// Values of AudioStreamContainerFormat, the wrapper does not depend on the Speech SDK headers.
+enum ContainerFormat
+{
+    OggOpus = 0x101, Mp3 = 0x102, FlacFormat = 0x103, AlawFormat = 0x104, MulawFormat = 0x105
+};
+
+void RegisterPlugin(Plugin plugin)
+{
+#if defined(TARGET_OS_IPHONE) || defined(SPX_GST_STATIC_PLUGINS)
+    static std::once_flag registered[PluginCount];
+    std::call_once(registered[plugin], [plugin]()
+    {
+        switch (plugin)
+        {
+        case CoreElements: GST_PLUGIN_STATIC_REGISTER(coreelements); break;
+        case App: GST_PLUGIN_STATIC_REGISTER(app); break;
+        case AudioConvert: GST_PLUGIN_STATIC_REGISTER(audioconvert); break;
+        case Mpg123: GST_PLUGIN_STATIC_REGISTER(mpg123); break;
+        case AudioResample: GST_PLUGIN_STATIC_REGISTER(audioresample); break;
+        case AudioParsers: GST_PLUGIN_STATIC_REGISTER(audioparsers); break;
+        case Ogg: GST_PLUGIN_STATIC_REGISTER(ogg); break;
+        case OpusParse: GST_PLUGIN_STATIC_REGISTER(opusparse); break;
+        case Opus: GST_PLUGIN_STATIC_REGISTER(opus); break;
+        case WavParse: GST_PLUGIN_STATIC_REGISTER(wavparse); break;
+        case Alaw: GST_PLUGIN_STATIC_REGISTER(alaw); break;
+        case Mulaw: GST_PLUGIN_STATIC_REGISTER(mulaw); break;
+        case Flac: GST_PLUGIN_STATIC_REGISTER(flac); break;
+        default: break;
+        }
+    });
+#else
+    // Plugins are loaded on demand from the system plugin directory.
+    (void)plugin;
 #endif
 }
 
+void RegisterPlugins(std::initializer_list<Plugin> plugins)
+{
+    // Every decode pipeline reads from an app source or file, converts and resamples the PCM.
+    for (auto plugin : { CoreElements, App, AudioConvert, AudioResample })
+    {
+        RegisterPlugin(plugin);
+    }
+    for (auto plugin : plugins)
+    {
+        RegisterPlugin(plugin);
+    }
+}
+
+} // anonymous namespace
+
+void spx_gst_init() {
+    for (int plugin = 0; plugin < PluginCount; plugin++)
+    {
+        RegisterPlugin(static_cast<Plugin>(plugin));
+    }
+}
+
+void spx_gst_init_for_format(int containerFormat) {
+    // The plugins of each format are registered at most once, later calls for the same format return right away.
+    static std::once_flag opus, mp3, flac, alaw, mulaw, all;
+    switch (containerFormat)
+    {
+    case OggOpus: std::call_once(opus, []() { RegisterPlugins({ Ogg, OpusParse, Opus }); }); break;
+    case Mp3: std::call_once(mp3, []() { RegisterPlugins({ AudioParsers, Mpg123 }); }); break;
+    case FlacFormat: std::call_once(flac, []() { RegisterPlugins({ AudioParsers, Flac }); }); break;
+    case AlawFormat: std::call_once(alaw, []() { RegisterPlugins({ WavParse, Alaw }); }); break;
+    case MulawFormat: std::call_once(mulaw, []() { RegisterPlugins({ WavParse, Mulaw }); }); break;
+    default: std::call_once(all, []() { spx_gst_init(); }); break;
+    }
+}
+
 } } } } // Microsoft::CognitiveServices::Speech::Impl
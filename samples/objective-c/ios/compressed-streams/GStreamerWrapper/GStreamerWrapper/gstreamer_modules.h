@@ -13,7 +13,7 @@
 
 #include <gst/gst.h>
 
-#if defined(TARGET_OS_IPHONE)
+#if defined(TARGET_OS_IPHONE) || defined(SPX_GST_STATIC_PLUGINS)
 extern "C"
 {
 #define GST_G_IO_MODULE_DECLARE(name) \
@@ -43,6 +43,12 @@ namespace CognitiveServices {
 namespace Speech {
 namespace Impl {
 
+// Registers all plugins.
 __attribute__((visibility ("default"))) void spx_gst_init();
 
+// Registers only the plugins needed to decode the given container format, on first use.
+// containerFormat is a value of AudioStreamContainerFormat (OGG_OPUS, MP3, FLAC, ALAW or MULAW); any other value
+// registers all plugins. Thread-safe, and may be mixed with spx_gst_init(), every plugin is registered once.
+__attribute__((visibility ("default"))) void spx_gst_init_for_format(int containerFormat);
+
 } } } } // Microsoft::CognitiveServices::Speech::Impl